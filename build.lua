@@ -13,5 +13,51 @@ demo 'kiview' {
          'cli',
          'util-string'
       }
+   },
+   app '-perf' {
+      icon 'icon/bengine.ico',
+      src {
+         'perf/*.cpp',
+         'src/board_model.cpp',
+         'src/mapped_file.cpp',
+         'src/parse_lazy.cpp',
+         'src/parse_parallel.cpp',
+         'src/pcb_helper.cpp',
+         'src/pick_grid.cpp',
+         'src/sexpr_index.cpp'
+      },
+      define 'GLM_ENABLE_EXPERIMENTAL',
+      link_project {
+         'core',
+         'core-id',
+         'util-string'
+      }
+   },
+   app '-test' {
+      icon 'icon/bengine.ico',
+      src {
+         'test/*.cpp',
+         'src/board_cache.cpp',
+         'src/board_model.cpp',
+         'src/circle.cpp',
+         'src/indexed_mesh.cpp',
+         'src/mapped_file.cpp',
+         'src/parse_lazy.cpp',
+         'src/parse_parallel.cpp',
+         'src/pcb_helper.cpp',
+         'src/pick_grid.cpp',
+         'src/polygon.cpp',
+         'src/render_layer.cpp',
+         'src/sexpr_index.cpp',
+         'src/shape_instances.cpp',
+         'src/transform.cpp'
+      },
+      define 'GLM_ENABLE_EXPERIMENTAL',
+      link_project {
+         'testing',
+         'core',
+         'core-id',
+         'util-string'
+      }
    }
 }
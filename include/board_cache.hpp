@@ -0,0 +1,47 @@
+#pragma once
+#ifndef KIVIEW_BOARD_CACHE_HPP_
+#define KIVIEW_BOARD_CACHE_HPP_
+
+#include "node.hpp"
+#include "mapped_file.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// A parsed board saved beside its source as <source>.kvcache.  The file holds
+// the tree's arena followed by the text it refers to.  Nodes locate children
+// and text relative to themselves, so the mapped file is used as the tree
+// directly.  A cache is only used while the source's size, modification time
+// and content hash match the ones it was written with.
+class BoardCache final {
+public:
+   // Increment when Node's layout or the keywords assigned by classify_node change.
+   static constexpr be::U32 version = 2;
+
+   struct Key {
+      be::U64 size;
+      be::I64 mtime;
+      be::U64 hash;
+   };
+
+   static Key key(const be::S& source_path, be::SV source);
+   static be::S path(const be::S& source_path);
+
+   // Writes to a temporary file and renames it into place, so readers never
+   // see a partial cache.  Throws on failure, or if the tree was parsed with
+   // parse_lazy() and has deferred subtrees.
+   static void write(const be::S& source_path, const Key& key, const NodeTree& tree);
+
+   // Returns false (leaving this cache empty) if there is no cache for the
+   // source, if it doesn't match key, or if its nodes refer outside it.
+   bool open(const be::S& source_path, const Key& key);
+
+   // The tree stored in the cache; it must not outlive this object.
+   NodeTree tree();
+
+private:
+   static bool valid_(const char* data, std::size_t node_count, std::size_t text_size) noexcept;
+
+   MappedFile file_;
+   std::size_t node_count_ = 0;
+};
+
+#endif
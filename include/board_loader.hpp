@@ -0,0 +1,187 @@
+#pragma once
+#ifndef KIVIEW_BOARD_LOADER_HPP_
+#define KIVIEW_BOARD_LOADER_HPP_
+
+#include "node.hpp"
+#include "mapped_file.hpp"
+#include "board_cache.hpp"
+#include "board_meshes.hpp"
+#include "pick_grid.hpp"
+
+#include <be/core/extents.hpp>
+#include <be/util/string_interner.hpp>
+#include <glm/vec2.hpp>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Everything read from a board file.  Members are declared so that the tree
+// goes before the text, cache and interner it refers to.
+struct Board {
+   std::unique_ptr<be::util::StringInterner> si; // owned by the board, since its LazySubtrees refer to it
+   MappedFile file;   // text nodes are slices of the mapping
+   BoardCache cache;  // holds the nodes when the tree was loaded from the cache
+   NodeTree tree;
+   std::shared_ptr<const BoardModel> model = std::make_shared<BoardModel>(); // refers to tree's nodes
+   PickGrid pick_grid; // indexes model
+   be::S title;
+   be::S cache_error; // why the cache couldn't be written, if it couldn't
+   be::rect bounds;
+   std::vector<be::U64> item_hashes; // source text hash of each board item; empty if unknown
+   std::vector<be::U32> reused; // for each board item, the previous board's item it copies, or none; empty unless reloading
+
+   Board() = default;
+   Board(Board&&) = default;
+
+   // Releases the old tree before the text it refers to.
+   Board& operator=(Board&& other);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// What a reload keeps of the board it replaces.  Unchanged items are copied
+// from its model rather than read, and the meshes which were valid are
+// patched rather than rebuilt.
+struct PreviousBoard {
+   std::vector<be::U64> item_hashes;
+   std::shared_ptr<const BoardModel> model;
+   std::vector<std::size_t> highlight_items; // board items of the highlighted modules
+   bool patchable[(std::size_t)layer_mesh::count][2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Reads and tessellates a board on a worker thread.  The board's bounds and
+// a preview of its outline are handed over first, then the board once it
+// has been parsed, then the meshes for the visible face and the far face, a
+// chunk of items at a time, and finally its pick grid; the main thread
+// collects them with poll().  A reload keeps the view and hands over the
+// board along with patches for the meshes, holding just the changed items.
+// Destroying the loader cancels it.
+class BoardLoader final {
+public:
+   // The app's state when the load started.  Meshes built for it are only
+   // installed if their generation hasn't changed since.
+   struct View {
+      bool back;
+      bool skip_zones;
+      be::F32 lod_pixels;
+      be::F32 scale; // 0 to fit the board to viewport
+      glm::vec2 center;
+      bool autocenter;
+      glm::ivec2 viewport;
+      std::set<be::U32> highlight_nets;
+      std::set<const Node*> highlight_modules;
+      be::U32 generations[(std::size_t)layer_mesh::count][2];
+      SegmentDensities densities; // when reloading, those of the current meshes
+      BoardModel::Bounds region;  // likewise
+   };
+
+   struct Mesh {
+      layer_mesh type;
+      bool back;
+      be::U32 generation;
+      CachedMesh mesh;
+      bool replace; // else appended to what was delivered before
+      bool last;    // the mesh is complete
+      bool patch = false; // only changed items; the rest are spliced in from the current mesh
+   };
+
+   // Everything handed over since the last poll().
+   struct Delivery {
+      bool view_ready = false; // set when the members below it are
+      be::rect bounds;
+      be::F32 lod_error = 0; // that the meshes are built with
+      BoardModel::Bounds mesh_region;
+      std::unique_ptr<Board> board; // without its pick grid
+      std::unique_ptr<PickGrid> pick_grid;
+      std::vector<Mesh> meshes;
+      std::exception_ptr error;
+      be::S status;
+      bool done = false;
+   };
+
+   // notify is called from the worker thread whenever there is something
+   // new to poll().  previous is set when reloading.
+   BoardLoader(be::S filename, bool use_cache, View view, std::unique_ptr<PreviousBoard> previous,
+               std::function<void()> notify);
+   BoardLoader(const BoardLoader&) = delete;
+   BoardLoader& operator=(const BoardLoader&) = delete;
+   ~BoardLoader();
+
+   Delivery poll();
+
+   const PreviousBoard* previous() const noexcept {
+      return previous_.get();
+   }
+
+   std::chrono::steady_clock::duration elapsed() const {
+      return std::chrono::steady_clock::now() - start_;
+   }
+
+   // The generation meshes of type for face back are built for; those
+   // invalidated since the load started are never delivered.
+   be::U32 generation(layer_mesh type, bool back) const noexcept {
+      return view_.generations[(std::size_t)type][back ? 1 : 0];
+   }
+
+   // Of a reloaded board, once poll() has handed it over.
+   std::size_t changed_items() const noexcept {
+      return changed_items_;
+   }
+
+private:
+   void run_();
+   void load_();
+   void reload_();
+   void set_status_(be::S status);
+   bool build_(const BoardModel& model, std::initializer_list<layer_mesh> types, bool back, const MeshSettings& settings,
+               std::size_t begin, std::size_t end, bool replace, bool last);
+   bool stream_(const BoardModel& model, std::initializer_list<layer_mesh> types, bool back, const MeshSettings& settings);
+
+   be::S filename_;
+   bool use_cache_;
+   View view_;
+   std::unique_ptr<PreviousBoard> previous_;
+   std::function<void()> notify_;
+   std::chrono::steady_clock::time_point start_;
+   std::size_t changed_items_ = 0;
+   std::atomic<bool> cancel_ { false };
+
+   std::mutex mutex_; // guards delivery_
+   Delivery delivery_;
+
+   std::thread thread_; // last, so that it starts once everything else is set up
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Puts a delivered mesh in place of, or after, what mesh holds, or splices a
+// patch into it; reused and n_previous are those of the reloaded board and
+// the board it replaced.  Returns false if mesh has changed since the load
+// started and was left alone.
+bool install_mesh(CachedMesh& mesh, BoardLoader::Mesh& delivered, const std::vector<be::U32>& reused, std::size_t n_previous);
+
+///////////////////////////////////////////////////////////////////////////////
+// For each of the previous board's items, the item which takes over its
+// selection: its copy, or else the changed item it pairs up with, in order.
+std::vector<std::size_t> carry_items(const std::vector<be::U32>& reused, std::size_t n_previous);
+
+///////////////////////////////////////////////////////////////////////////////
+// The board items of modules, so they can be found again with carry_modules().
+std::vector<std::size_t> module_items(const std::set<const Node*>& modules, const NodeTree& tree);
+
+///////////////////////////////////////////////////////////////////////////////
+// The modules which take over from the previous board's module items.
+std::set<const Node*> carry_modules(const std::vector<std::size_t>& previous_items, const std::vector<std::size_t>& carried, const NodeTree& tree);
+
+///////////////////////////////////////////////////////////////////////////////
+// The nets of model matching nets of previous.  Nets which weren't declared
+// have no name, so are matched by number.
+std::set<be::U32> remap_nets(const std::set<be::U32>& nets, const BoardModel& previous, const BoardModel& model);
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef KIVIEW_BOARD_MESHES_HPP_
+#define KIVIEW_BOARD_MESHES_HPP_
+
+#include "render_layer.hpp"
+#include <be/core/extents.hpp>
+#include <glm/vec2.hpp>
+#include <atomic>
+#include <set>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// The meshes kiview draws, each built for one face (holes and edge cuts are
+// always built for the front).
+enum class layer_mesh {
+   copper,
+   pads,
+   highlighted_copper,
+   highlighted_pads,
+   silk,
+   holes,
+   edge_cuts,
+   count
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct CachedMesh {
+   IndexedMesh mesh;
+   std::vector<be::U32> item_ends;     // mesh's triangles from board item i end at item_ends[i]
+   InstancedShapes shapes;             // pads, vias and holes
+   std::vector<be::U32> instance_ends; // likewise for shapes' instances
+   be::U64 revision = 0;           // new whenever mesh changes, so MeshBuffers can tell
+   be::U32 generation = 0;         // incremented whenever the mesh is invalidated
+   bool valid = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A mesh to be filled in by build_meshes().
+struct MeshTarget {
+   layer_mesh type;
+   bool back;
+   CachedMesh* mesh;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct MeshSettings {
+   bool skip_zones;
+   std::set<be::U32>* highlight_nets;
+   std::set<const Node*>* highlight_modules;
+   SegmentDensities densities;
+   BoardModel::Bounds region; // items outside are left out
+   const std::vector<bool>* items = nullptr; // if set, board items i without items[i] are left out
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Never repeats, even across meshes, so a MeshBuffers can't mistake one mesh
+// for another.  Safe to call from any thread.
+be::U64 new_mesh_revision();
+
+///////////////////////////////////////////////////////////////////////////////
+RenderItemPredicate mesh_predicate(layer_mesh type, bool back, const MeshSettings& settings);
+
+///////////////////////////////////////////////////////////////////////////////
+// Renders item by item, recording where each item's triangles end so that
+// reloads can reuse those of unchanged items, and makes a single pass over
+// board items [begin, end) for all the targets, spread across worker threads.
+// Highlighted copper is the exception; it only visits the highlighted nets'
+// items, whatever the range.  Stops early, leaving the meshes incomplete, if
+// cancel is set.
+void build_meshes(const BoardModel& model, const std::vector<MeshTarget>& targets, const MeshSettings& settings,
+                  const std::atomic<bool>* cancel = nullptr, bool parallel = true,
+                  std::size_t begin = 0, std::size_t end = BoardModel::none);
+
+///////////////////////////////////////////////////////////////////////////////
+// The scale that fits the board to the viewport, leaving room for the
+// status lines.
+be::F32 fit_scale(glm::ivec2 viewport, const be::rect& bounds);
+
+///////////////////////////////////////////////////////////////////////////////
+// SegmentDensities::max_error for curves within pixels of true at scale,
+// rounded down to a power of two so that meshes suit a range of zoom levels.
+be::F32 lod_max_error(be::F32 pixels, be::F32 scale);
+
+///////////////////////////////////////////////////////////////////////////////
+// The part of the board in the viewport.
+BoardModel::Bounds view_bounds(glm::vec2 center, be::F32 scale, glm::ivec2 viewport);
+
+///////////////////////////////////////////////////////////////////////////////
+// Meshes are built for the visible part of the board and a view's width and
+// height around it, so that panning doesn't rebuild them every frame; or for
+// everything, if that covers the board anyway.
+BoardModel::Bounds mesh_region(const BoardModel::Bounds& visible, const be::rect& board);
+
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+#ifndef KIVIEW_BOARD_MODEL_HPP_
+#define KIVIEW_BOARD_MODEL_HPP_
+
+#include "pcb_helper.hpp"
+#include <glm/mat3x3.hpp>
+#include <glm/vec2.hpp>
+#include <limits>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class model_item : be::U8 {
+   graphic,
+   pad,
+   pad_hole,
+   segment,
+   via,
+   via_hole,
+   zone
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class graphic_shape : be::U8 {
+   line,
+   arc,
+   circle
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// The drawable contents of a board, extracted from its tree once after
+// parsing so that rendering and selection don't have to search nodes.  Each
+// kind of item is stored as a set of parallel arrays, in file order.  Every
+// entry refers back to the node it was read from and to the index of the
+// board item (a child of kicad_pcb) that contains it, and holds the layers it
+// is on as a mask.  Nets are referred to by dense ids, in declaration order,
+// rather than by the numbers in the file.  Names and text are copied, so the
+// model can be read after the source text has changed.
+struct BoardModel {
+   static constexpr be::U32 none = ~(be::U32)0;
+
+   struct Span {
+      be::U32 begin = 0;
+      be::U32 count = 0;
+   };
+
+   // An axis aligned box in board space.  The default is empty and overlaps
+   // nothing; everything() overlaps every Bounds.
+   struct Bounds {
+      glm::vec2 lo = glm::vec2(std::numeric_limits<be::F32>::infinity());
+      glm::vec2 hi = glm::vec2(-std::numeric_limits<be::F32>::infinity());
+
+      static Bounds everything() noexcept {
+         return Bounds { glm::vec2(-std::numeric_limits<be::F32>::infinity()), glm::vec2(std::numeric_limits<be::F32>::infinity()) };
+      }
+
+      void add(glm::vec2 center, be::F32 radius = 0) noexcept;
+      bool overlaps(const Bounds& other) const noexcept;
+      bool contains(const Bounds& other) const noexcept;
+   };
+
+   struct Modules {
+      std::vector<const Node*> node;
+      std::vector<be::U32> item;
+      std::vector<glm::vec2> at;
+      std::vector<glm::mat3> transform; // module space to board space
+      std::vector<layer_mask> layers;
+      std::vector<be::U32> footprint;   // modules with the same footprint have identical graphics and pads in module space
+      std::vector<be::S> name;          // the footprint's library name, as in the file
+      std::vector<be::S> reference;     // from fp_text; empty if there is none
+      std::vector<be::S> value;         // likewise
+   } modules;
+
+   // Each distinct module body, by id.  Text, nets and the modules' own
+   // positions don't count.
+   struct Footprints {
+      std::vector<be::U64> hash;  // of the graphics and pads, stable across loads
+      std::vector<be::U32> count; // modules using it
+   } footprints;
+
+   // gr_line, gr_arc and gr_circle, and the fp_ versions inside modules
+   struct Graphics {
+      std::vector<const Node*> node; // null for fp_ items copied by build_board_model()
+      std::vector<be::U32> item;
+      std::vector<be::U32> module; // none for gr_ items
+      std::vector<graphic_shape> shape;
+      std::vector<glm::vec2> start; // the center of arcs and circles
+      std::vector<glm::vec2> end;   // a point on arcs and circles
+      std::vector<be::F32> angle;
+      std::vector<be::F32> width;
+      std::vector<layer_mask> layers;
+   } graphics;
+
+   struct Pads {
+      std::vector<const Node*> node; // null if copied by build_board_model()
+      std::vector<be::U32> item;
+      std::vector<be::U32> module;
+      std::vector<pad_shape> shape;
+      std::vector<glm::mat3> transform;       // pad space to board space, including the module's
+      std::vector<glm::mat3> local_transform; // pad space to module space
+      std::vector<glm::vec2> size;
+      std::vector<glm::vec2> rect_delta;
+      std::vector<glm::vec2> drill; // zero if there is no hole
+      std::vector<be::U32> net;
+      std::vector<layer_mask> layers;
+   } pads;
+
+   struct Segments {
+      std::vector<const Node*> node;
+      std::vector<be::U32> item;
+      std::vector<glm::vec2> start;
+      std::vector<glm::vec2> end;
+      std::vector<be::F32> width;
+      std::vector<layer_mask> layers;
+      std::vector<be::U32> net;
+   } segments;
+
+   struct Vias {
+      std::vector<const Node*> node;
+      std::vector<be::U32> item;
+      std::vector<glm::vec2> at;
+      std::vector<be::F32> size;
+      std::vector<glm::vec2> drill; // zero if there is no hole
+      std::vector<be::U32> net;
+      std::vector<layer_mask> layers;
+   } vias;
+
+   struct Zones {
+      std::vector<const Node*> node;
+      std::vector<be::U32> item;
+      std::vector<be::F32> width; // min_thickness, used to stroke the outlines
+      std::vector<be::U32> net;
+      std::vector<layer_mask> layers;
+      std::vector<Span> polygons; // filled polygons, in polygons
+   } zones;
+
+   // Every net, by id, with the segments, vias, pads and zones in it as
+   // spans of net_members.
+   struct Nets {
+      std::vector<be::U32> number; // as in the file
+      std::vector<be::S> name;
+      std::vector<Span> segments;
+      std::vector<Span> vias;
+      std::vector<Span> pads;
+      std::vector<Span> zones;
+   } nets;
+
+   std::vector<Span> polygons; // spans of points
+   std::vector<glm::vec2> points;
+   std::vector<be::U32> net_members; // indices into segments, vias, pads or zones
+
+   // Where each board item's entries start in each array.  There is one
+   // extra entry at the end, so item i's entries end where item i + 1's begin.
+   struct ItemStart {
+      be::U32 graphics = 0;
+      be::U32 pads = 0;
+      be::U32 segments = 0;
+      be::U32 vias = 0;
+      be::U32 zones = 0;
+   };
+
+   std::vector<ItemStart> items = std::vector<ItemStart>(1);
+   std::vector<Bounds> item_bounds; // of everything drawn for each board item
+
+   // number of board items
+   std::size_t size() const noexcept {
+      return items.size() - 1;
+   }
+
+   const Node* node(model_item type, std::size_t i) const;
+   be::U32 item(model_item type, std::size_t i) const;
+   be::U32 net(model_item type, std::size_t i) const;    // none if the item has no net
+   be::U32 module(model_item type, std::size_t i) const; // none if the item isn't part of a module
+   layer_mask layers(model_item type, std::size_t i) const; // holes aren't on any layer
+
+   bool check_layer(model_item type, std::size_t i, face_type face, layer_type layer) const {
+      return ::check_layer(layers(type, i), face, layer);
+   }
+
+   be::U32 find_module(const Node* node) const; // none if node isn't a module's
+   be::U32 find_net(be::SV name) const; // none if there is no such net
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// board is the kicad_pcb node; its children are the board items.
+BoardModel build_board_model(const Node& board);
+
+///////////////////////////////////////////////////////////////////////////////
+// As above, but when reused[i] isn't none, board item i is a copy of board
+// item reused[i] of old, so its entries are copied rather than read and its
+// children needn't be parsed.  Copied pads and fp_ graphics have no node.
+BoardModel build_board_model(const Node& board, const BoardModel& old, const std::vector<be::U32>& reused);
+
+#endif
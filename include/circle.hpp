@@ -8,18 +8,31 @@
 #include <glm/gtc/constants.hpp>
 #include <cmath>
 
+//////////////////////////////////////////////////////////////////////////////
+// The unit circle in steps of half a segment: cos[k] and sin[k] are the
+// cosine and sine of k * pi / segments, for k in [0, 2 * segments).
+struct UnitCircle {
+   const be::F32* cos;
+   const be::F32* sin;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Tables for the default densities are built at compile time, and others
+// the first time they're used.  segments must not be 0.
+UnitCircle unit_circle(be::U32 segments);
+
 //////////////////////////////////////////////////////////////////////////////
 template <typename Consumer>
 void discretize_circle(glm::vec2 center, be::F32 radius, be::U32 segments, Consumer&& out) {
-   const be::F32 omega = glm::two_pi<be::F32>() / segments;
-   const be::F32 adj_radius = 2.f * radius / (1.f + std::cos(omega / 2.f));
-
-   const glm::vec2 first_point = center + glm::vec2(adj_radius, 0);
-   out(first_point);
-   
-   for (be::U32 s = 1; s < segments; ++s) {
-      const be::F32 theta = omega * s;
-      const glm::vec2 point = center + adj_radius * glm::vec2(std::cos(theta), std::sin(theta));
+   if (segments == 0) {
+      return;
+   }
+
+   const UnitCircle unit = unit_circle(segments);
+   const be::F32 adj_radius = 2.f * radius / (1.f + unit.cos[1]);
+
+   for (be::U32 s = 0; s < segments; ++s) {
+      const glm::vec2 point = center + adj_radius * glm::vec2(unit.cos[2 * s], unit.sin[2 * s]);
       out(point);
    }
 }
@@ -33,19 +46,44 @@ void discretize_arc(glm::vec2 center, glm::vec2 tangent, be::F32 radians, be::U3
    const be::U32 segments = (be::U32)(0.5f + radians / target_omega);
    const be::F32 omega = radians / segments;
    const glm::vec2 tangent_delta = tangent - center;
-   const glm::vec2 adj_tangent_delta = 2.f * tangent_delta / (1.f + std::cos(omega / 2.f));
-   const glm::mat2 cob = glm::mat2(adj_tangent_delta, glm::vec2(-adj_tangent_delta.y, adj_tangent_delta.x));
-   
+   const glm::mat2 edge_cob = glm::mat2(tangent_delta, glm::vec2(-tangent_delta.y, tangent_delta.x));
+
    out(tangent);
-   
+
+   // Endcaps and oval pads are half circles of whole segments, so their
+   // points are in the table; other arcs rotate by omega from one point to
+   // the next.
+   const be::F32 half_steps = radians * segments_per_circle / glm::pi<be::F32>();
+   if (segments > 0 && std::abs(half_steps - 2.f * segments) < 1e-3f) {
+      const UnitCircle unit = unit_circle(segments_per_circle);
+      const be::U32 n = 2 * segments_per_circle;
+      const glm::vec2 adj_tangent_delta = 2.f * tangent_delta / (1.f + unit.cos[1]);
+      const glm::mat2 cob = glm::mat2(adj_tangent_delta, glm::vec2(-adj_tangent_delta.y, adj_tangent_delta.x));
+
+      for (be::U32 s = 0; s < segments; ++s) {
+         const be::U32 k = (2 * s + 1) % n;
+         const glm::vec2 point = center + cob * glm::vec2(unit.cos[k], sign * unit.sin[k]);
+         out(point);
+      }
+
+      const be::U32 k = 2 * segments % n;
+      const glm::vec2 last_point = center + edge_cob * glm::vec2(unit.cos[k], sign * unit.sin[k]);
+      out(last_point);
+      return;
+   }
+
+   const glm::vec2 step = glm::vec2(std::cos(omega), sign * std::sin(omega));
+   glm::vec2 unit = glm::vec2(std::cos(omega / 2.f), sign * std::sin(omega / 2.f));
+   const glm::vec2 adj_tangent_delta = 2.f * tangent_delta / (1.f + unit.x);
+   const glm::mat2 cob = glm::mat2(adj_tangent_delta, glm::vec2(-adj_tangent_delta.y, adj_tangent_delta.x));
+
    for (be::U32 s = 0; s < segments; ++s) {
-      const be::F32 theta = sign * omega * (s + 0.5f);
-      const glm::vec2 point = center + cob * glm::vec2(std::cos(theta), std::sin(theta));
+      const glm::vec2 point = center + cob * unit;
       out(point);
+      unit = glm::vec2(unit.x * step.x - unit.y * step.y, unit.y * step.x + unit.x * step.y);
    }
 
-   const glm::mat2 edge_cob = glm::mat2(tangent_delta, glm::vec2(-tangent_delta.y, tangent_delta.x));
-   const glm::vec2 last_point = center + edge_cob * glm::vec2(cos(sign * radians), sin(sign * radians));
+   const glm::vec2 last_point = center + edge_cob * glm::vec2(std::cos(sign * radians), std::sin(sign * radians));
    out(last_point);
 }
 
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef KIVIEW_FILE_WATCH_HPP_
+#define KIVIEW_FILE_WATCH_HPP_
+
+#include <be/core/be.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////////////
+// Calls on_change from a background thread after a file is rewritten or
+// replaced and has then been left alone for settle_time.  On Linux this
+// uses inotify on the file's directory, so that saves which rename a new
+// file into place are seen.  Elsewhere, or if inotify isn't available, the
+// file's size and modification time are polled instead.
+class FileWatch final {
+public:
+   static constexpr be::U32 settle_time_ms = 100;
+   static constexpr be::U32 poll_interval_ms = 500;
+
+   FileWatch() = default;
+   FileWatch(const FileWatch&) = delete;
+   FileWatch& operator=(const FileWatch&) = delete;
+   ~FileWatch();
+
+   void start(const be::S& path, std::function<void()> on_change);
+   void stop();
+
+   bool polling() const noexcept {
+      return polling_;
+   }
+
+private:
+   bool start_inotify_();
+   void inotify_loop_(be::S filename);
+   void poll_loop_();
+
+   be::S path_;
+   std::function<void()> on_change_;
+   std::thread thread_;
+   bool polling_ = false;
+
+   std::mutex mutex_;
+   std::condition_variable stop_cv_;
+   bool stopping_ = false;
+
+   int inotify_fd_ = -1;
+   int wake_fds_[2] = { -1, -1 }; // written to by stop() to interrupt the inotify thread
+};
+
+#endif
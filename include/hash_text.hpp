@@ -0,0 +1,71 @@
+#pragma once
+#ifndef KIVIEW_HASH_TEXT_HPP_
+#define KIVIEW_HASH_TEXT_HPP_
+
+#include <be/core/be.hpp>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+inline be::U64 hash_rotl(be::U64 x, int r) noexcept {
+   return (x << r) | (x >> (64 - r));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline be::U64 hash_load_u64(const char* ptr) noexcept {
+   be::U64 v;
+   std::memcpy(&v, ptr, sizeof(v));
+   return v;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Four independent multiply-rotate lanes in the style of xxHash64, so hashing
+// runs at memory speed.  Only used to detect changes, not for security.
+inline be::U64 hash_text(be::SV text) noexcept {
+   constexpr be::U64 p1 = 0x9E3779B185EBCA87ull;
+   constexpr be::U64 p2 = 0xC2B2AE3D27D4EB4Full;
+   constexpr be::U64 p3 = 0x165667B19E3779F9ull;
+
+   auto round = [=](be::U64 acc, be::U64 input) {
+      return hash_rotl(acc + input * p2, 31) * p1;
+   };
+
+   const char* it = text.data();
+   const char* end = it + text.size();
+
+   be::U64 h;
+   if (text.size() >= 32) {
+      be::U64 v1 = p1 + p2;
+      be::U64 v2 = p2;
+      be::U64 v3 = 0;
+      be::U64 v4 = 0 - p1;
+      for (; end - it >= 32; it += 32) {
+         v1 = round(v1, hash_load_u64(it));
+         v2 = round(v2, hash_load_u64(it + 8));
+         v3 = round(v3, hash_load_u64(it + 16));
+         v4 = round(v4, hash_load_u64(it + 24));
+      }
+      h = hash_rotl(v1, 1) + hash_rotl(v2, 7) + hash_rotl(v3, 12) + hash_rotl(v4, 18);
+      for (be::U64 v : { v1, v2, v3, v4 }) {
+         h = (h ^ round(0, v)) * p1 + p3;
+      }
+   } else {
+      h = p3;
+   }
+
+   h += text.size();
+   for (; end - it >= 8; it += 8) {
+      h = hash_rotl(h ^ round(0, hash_load_u64(it)), 27) * p1 + p3;
+   }
+   for (; it != end; ++it) {
+      h = hash_rotl(h ^ ((be::U8)*it * p3), 11) * p1;
+   }
+
+   h ^= h >> 33;
+   h *= p2;
+   h ^= h >> 29;
+   h *= p3;
+   h ^= h >> 32;
+   return h;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef KIVIEW_INDEXED_MESH_HPP_
+#define KIVIEW_INDEXED_MESH_HPP_
+
+#include <be/core/be.hpp>
+#include <glm/vec2.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Triangles as a vertex array and three indices per triangle.  Tessellators
+// add each vertex of a fan or strip once and index it from every triangle
+// that uses it.  Each board item's triangles only index its own vertices,
+// which come after those of the items before it.
+struct IndexedMesh {
+   std::vector<glm::vec2> vertices;
+   std::vector<be::U32> indices;
+
+   std::size_t triangles() const noexcept {
+      return indices.size() / 3;
+   }
+
+   // Returns the new vertex's index.
+   be::U32 add_vertex(glm::vec2 v) {
+      vertices.push_back(v);
+      return (be::U32)(vertices.size() - 1);
+   }
+
+   void add_triangle(be::U32 a, be::U32 b, be::U32 c) {
+      indices.push_back(a);
+      indices.push_back(b);
+      indices.push_back(c);
+   }
+
+   // Appends other's triangles [begin, end), along with the vertices they
+   // index.
+   void append(const IndexedMesh& other, std::size_t begin, std::size_t end);
+
+   void append(const IndexedMesh& other) {
+      append(other, 0, other.triangles());
+   }
+
+   void clear() noexcept {
+      vertices.clear();
+      indices.clear();
+   }
+};
+
+#endif
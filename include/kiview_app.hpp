@@ -3,16 +3,23 @@
 #define KIVIEW_APP_HPP_
 
 #include "node.hpp"
+#include "board_loader.hpp"
+#include "board_meshes.hpp"
+#include "file_watch.hpp"
+#include "shape_renderer.hpp"
+#include "mesh_buffers.hpp"
 
 #include <be/core/lifecycle.hpp>
 #include <be/core/extents.hpp>
-#include <be/util/string_interner.hpp>
 #include <be/platform/lifecycle.hpp>
 #include <be/platform/glfw_window.hpp>
 #include <glm/vec2.hpp>
-#include <functional>
+#include <glm/vec4.hpp>
+#include <atomic>
+#include <memory>
 #include <random>
 #include <set>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 class KiViewApp final {
@@ -22,14 +29,30 @@ public:
 
 private:
    void run_();
-   void load_(be::SV filename);
+   void install_board_(Board&& board);
+   void start_load_(std::unique_ptr<PreviousBoard> previous = nullptr);
+   void poll_load_();
+   void cancel_load_();
+   void reload_();
    void autoscale_();
+   void update_mesh_view_();
    void select_at_(glm::vec2 pos);
-   void select_all_like_(const Node& mod);
+   void select_all_like_(be::U32 module);
    void process_command_(be::SV cmd);
    void set_segment_density_(be::SV params, void(*fp)(be::U32), be::SV label);
+   void set_lod_(be::SV params);
    void render_();
 
+   MeshSettings mesh_settings_();
+   void build_visible_meshes_();
+   const CachedMesh& mesh_(layer_mesh type, bool back);
+   void draw_mesh_(layer_mesh type, bool back, glm::vec4 color, bool skip_hidden = false);
+   static void invalidate_mesh_(CachedMesh& mesh);
+   void invalidate_meshes_(layer_mesh type);
+   void invalidate_meshes_();
+   void hide_net_(be::U32 net, bool hidden);
+   void update_hidden_items_();
+
    be::CoreInitLifecycle init_;
    be::CoreLifecycle core_;
    be::platform::PlatformLifecycle platform_;
@@ -37,11 +60,15 @@ private:
    be::I8 status_ = 0;
 
    be::S filename_;
+   bool use_cache_ = false;
 
-   be::util::StringInterner si_;
-   Node root_;
+   Board board_;
    be::rect board_bounds_;
-   be::U32 ground_net_ = 0;
+   be::U32 ground_net_ = BoardModel::none;
+
+   std::atomic<bool> reload_pending_ { false };
+   FileWatch watch_;
+   std::unique_ptr<BoardLoader> loader_; // refers to board_, so must be destroyed first
 
    GLFWwindow* wnd_;
    glm::ivec2 viewport_ = glm::ivec2(640, 480);
@@ -50,6 +77,10 @@ private:
    be::F32 scale_ = 1;
    bool enable_autoscale_ = true;
    bool enable_autocenter_ = true;
+   be::F32 lod_pixels_ = 0.5f; // how far curves may stray, in pixels; 0 for fixed segment densities
+   be::F32 lod_error_ = 0;     // the same in board units, for the current meshes
+   BoardModel::Bounds mesh_region_ = BoardModel::Bounds::everything(); // the current meshes leave out items outside it
+   be::F32 mesh_scale_ = 0;    // scale_ when mesh_region_ was chosen
 
    glm::vec2 relative_cursor_;
    glm::vec2 cursor_;
@@ -68,8 +99,15 @@ private:
    bool skip_silk_ = false;
    bool skip_zones_ = false;
    std::set<be::U32> skip_nets_;
+   std::vector<bool> hidden_items_; // board items in skip_nets_, which are left out when drawing copper
+   be::U32 hidden_version_ = 0;     // incremented whenever hidden_items_ changes
    std::set<be::U32> highlight_nets_;
    std::set<const Node*> highlight_modules_;
+
+   CachedMesh meshes_[(std::size_t)layer_mesh::count][2];
+   std::unique_ptr<ShapeRenderer> shape_renderer_;
+   MeshBuffers mesh_buffers_[(std::size_t)layer_mesh::count][2];   // uploaded from meshes_
+   ShapeBuffers shape_buffers_[(std::size_t)layer_mesh::count][2]; // likewise
 };
 
 #endif
@@ -2,98 +2,74 @@
 #ifndef KIVIEW_LAYER_CONFIG_HPP_
 #define KIVIEW_LAYER_CONFIG_HPP_
 
-#include "pcb_helper.hpp"
+#include "board_model.hpp"
 #include <set>
 
 struct StandardConfig {
-   face_type face;
-   layer_type layer;
+   layer_mask layers;
 
-   std::pair<bool, bool> operator()(const Node& node, const std::vector<const Node*>& stack) {
-      return std::make_pair(check_layer(node, face, layer), true);
+   StandardConfig(face_type face, layer_type layer)
+      : layers(layer_query_mask(face, layer)) { }
+
+   bool operator()(const BoardModel& model, model_item type, std::size_t i) {
+      return (model.layers(type, i) & layers) != 0;
    }
 };
 
 struct CopperConfig {
-   face_type face;
+   layer_mask layers;
    bool skip_zones;
-   std::set<be::U32>* skip_nets;
-   std::set<be::U32>* include_nets;
+   bool skip_pads;
 
-   std::pair<bool, bool> operator()(const Node& node, const std::vector<const Node*>& stack) {
-      using namespace std::string_view_literals;
+   CopperConfig(face_type face, bool skip_zones, bool skip_pads)
+      : layers(layer_query_mask(face, layer_type::l_copper)),
+        skip_zones(skip_zones),
+        skip_pads(skip_pads) { }
 
-      node_type type = get_node_type(node);
-      if (skip_zones && type == node_type::n_zone) {
-         return std::make_pair(false, false);
+   bool operator()(const BoardModel& model, model_item type, std::size_t i) {
+      if ((skip_zones && type == model_item::zone) || (skip_pads && type == model_item::pad)) {
+         return false;
       }
 
-      if (skip_nets || include_nets) {
-         auto it = find(node, "net"sv);
-         if (it != node.end()) {
-            auto& child = *it;
-            if (child.size() >= 2) {
-               be::U32 net = (be::U32)child[1].value();
-               if (skip_nets && skip_nets->count(net) > 0) {
-                  return std::make_pair(false, false);
-               }
-               if (include_nets && include_nets->count(net) <= 0) {
-                  return std::make_pair(false, false);
-               }
-            }
-         } else if (include_nets) {
-            return std::make_pair(false, true);
-         }
-      }
-
-      return std::make_pair(check_layer(node, face, layer_type::l_copper), true);
+      return (model.layers(type, i) & layers) != 0;
    }
 };
 
 struct ModuleConfig {
-   face_type face;
-   bool include_court;
+   layer_mask copper_layers;
+   layer_mask court_layers; // none unless courtyards are included
    std::set<const Node*>* include_nodes;
 
-   std::pair<bool, bool> operator()(const Node& node, const std::vector<const Node*>& stack) {
-      using namespace std::string_view_literals;
-
-      if (check_layer(node, face, layer_type::l_copper) && get_node_type(node) == node_type::n_pad ||
-          include_court && check_layer(node, face, layer_type::l_court)) {
+   ModuleConfig(face_type face, bool include_court, std::set<const Node*>* include_nodes)
+      : copper_layers(layer_query_mask(face, layer_type::l_copper)),
+        court_layers(include_court ? layer_query_mask(face, layer_type::l_court) : 0),
+        include_nodes(include_nodes) { }
 
-         if (stack.size() < 2) {
-            return std::make_pair(false, true);
-         }
-
-         const Node* module_node = nullptr;
-         for (auto it = stack.rbegin() + 1, end = stack.rend(); it != end; ++it) {
-            auto n = *it;
-            if (get_node_type(*n) == node_type::n_module) {
-               module_node = n;
-            }
-         }
-
-         if (!module_node) {
-            return std::make_pair(false, true);
-         }
+   bool operator()(const BoardModel& model, model_item type, std::size_t i) {
+      be::U32 module = model.module(type, i);
+      if (module == BoardModel::none) {
+         return false;
+      }
 
+      layer_mask layers = type == model_item::pad ? copper_layers | court_layers : court_layers;
+      if ((model.layers(type, i) & layers) != 0) {
          if (include_nodes) {
-            if (include_nodes->count(module_node) <= 0) {
-               return std::make_pair(false, false);
+            if (include_nodes->count(model.modules.node[module]) <= 0) {
+               return false;
             }
          }
 
-         return std::make_pair(true, true);
+         return true;
       }
 
-      return std::make_pair(false, true);
+      return false;
    }
 };
 
 
 struct HoleConfig {
-   std::pair<bool, bool> operator()(const Node& node, const std::vector<const Node*>& stack) {
-      return std::make_pair(get_node_type(node) == node_type::n_drill, true);
+   bool operator()(const BoardModel&, model_item type, std::size_t) {
+      return type == model_item::pad_hole || type == model_item::via_hole;
    }
 };
 
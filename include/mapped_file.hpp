@@ -0,0 +1,43 @@
+#pragma once
+#ifndef KIVIEW_MAPPED_FILE_HPP_
+#define KIVIEW_MAPPED_FILE_HPP_
+
+#include <be/core/be.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+class MappedFile final {
+public:
+   MappedFile() noexcept = default;
+   // If copy_on_write is true, the view may be modified through data(); such
+   // changes are private to this process and are never written to the file.
+   explicit MappedFile(const be::S& path, bool copy_on_write = false);
+   MappedFile(const MappedFile&) = delete;
+   MappedFile(MappedFile&& other) noexcept;
+   MappedFile& operator=(const MappedFile&) = delete;
+   MappedFile& operator=(MappedFile&& other) noexcept;
+   ~MappedFile();
+
+   be::SV text() const noexcept {
+      return be::SV(data_, size_);
+   }
+
+   char* data() noexcept {
+      return data_;
+   }
+
+   std::size_t size() const noexcept {
+      return size_;
+   }
+
+   bool empty() const noexcept {
+      return size_ == 0;
+   }
+
+private:
+   void close_() noexcept;
+
+   char* data_ = nullptr;
+   std::size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef KIVIEW_MESH_BUFFERS_HPP_
+#define KIVIEW_MESH_BUFFERS_HPP_
+
+#include "indexed_mesh.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// A copy of an IndexedMesh uploaded to buffer objects, and drawn with
+// glDrawElements.  So that indices fit in 16 bits, triangles are split into
+// batches, each indexing the vertices from its own first vertex on.  Needs
+// GL 1.5; if supported() is false, draw the mesh from client memory instead.
+// Must be destroyed with the GL context current.
+class MeshBuffers final {
+public:
+   MeshBuffers() = default;
+   ~MeshBuffers();
+   MeshBuffers(MeshBuffers&& other) noexcept;
+   MeshBuffers& operator=(MeshBuffers&& other) noexcept;
+
+   static bool supported() noexcept;
+
+   // Uploads mesh if revision has changed since the last update.  If
+   // item_ends says where each board item's triangles end (as in CachedMesh)
+   // and is the same size as hidden_items, the triangles of hidden items are
+   // left out; hidden_version must change whenever hidden_items does.
+   void update(const IndexedMesh& mesh, const std::vector<be::U32>& item_ends,
+               const std::vector<bool>& hidden_items, be::U64 revision, be::U32 hidden_version);
+
+   // Draws in the current color.
+   void draw(bool wireframe) const;
+
+private:
+   struct Batch {
+      be::U32 first_triangle; // the batch ends where the next one begins
+      be::U32 first_vertex;
+   };
+
+   struct Draw {
+      be::U32 first_vertex;
+      be::U32 first_index;
+      be::U32 indices;
+   };
+
+   void release_() noexcept;
+
+   be::U32 vertex_buffer_ = 0;
+   be::U32 index_buffer_ = 0;
+   std::vector<Batch> batches_;
+   be::U32 triangles_ = 0;
+   be::U32 index_size_ = 0; // 32 bit only if a triangle spans too many vertices
+   std::vector<Draw> draws_;
+   be::U64 revision_ = 0;
+   be::U32 hidden_version_ = 0;
+};
+
+#endif
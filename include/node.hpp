@@ -5,147 +5,457 @@
 #include <be/core/be.hpp>
 #include <be/core/console.hpp>
 #include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
 #include <be/util/string_interner.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "sexpr_index.hpp"
+#include "sexpr_scan.hpp"
+#include "parse_decimal.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
+// Nodes live in a NodeTree's arena and are 16 bytes each.  A sexpr's children
+// are a contiguous range of the arena and a text node's characters live in
+// the source text or interner; both are located relative to the node itself,
+// so nodes must not be copied out of the tree that owns them.  A sexpr may
+// instead refer to a LazySubtree, which is parsed when its children are
+// first accessed.
 class Node {
 public:
-   using child_list = std::vector<Node>;
-   using iterator = child_list::iterator;
-   using const_iterator = child_list::const_iterator;
-   using reverse_iterator = child_list::reverse_iterator;
-   using const_reverse_iterator = child_list::const_reverse_iterator;
+   using iterator = Node*;
+   using const_iterator = const Node*;
+   using reverse_iterator = std::reverse_iterator<iterator>;
+   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-   enum class node_type {
+   enum class node_type : be::U8 {
       sexpr,
       text,
       value
    };
 
    Node() noexcept
-      : type_(node_type::sexpr),
-        value_(0) { }
-
-   explicit Node(std::initializer_list<Node> il)
-      : type_(node_type::sexpr),
-        value_(0),
-        children_(il) { }
-
-   template <typename I>
-   explicit Node(I begin, I end)
-      : type_(node_type::sexpr),
-        value_(0),
-        children_(begin, end) {
-   }
-
-   explicit Node(be::SV text) noexcept
-      : type_(node_type::text),
-        text_(text),
-        value_(0) { }
-
-   explicit Node(be::F64 value) noexcept
-      : type_(node_type::value),
-        value_(value) { }
+      : offset_(0),
+        size_(0),
+        type_(node_type::sexpr),
+        keyword_(0),
+        lazy_(false) { }
 
    node_type type() const noexcept {
       return type_;
    }
 
    be::SV text() const noexcept {
-      return text_;
+      if (type_ != node_type::text) {
+         return be::SV();
+      }
+      return be::SV(reinterpret_cast<const char*>(reinterpret_cast<std::intptr_t>(this) + offset_), size_);
    }
 
    be::F64 value() const noexcept {
-      return value_;
+      return type_ == node_type::value ? value_ : 0;
    }
 
-   std::size_t size() const noexcept {
-      return children_.size();
+   // The classification of a sexpr's first atom, as determined by the
+   // NodeClassifier passed to parse().  Zero if there was none.
+   be::U8 keyword() const noexcept {
+      return keyword_;
    }
 
-   bool empty() const noexcept {
-      return children_.empty();
-   }
+   // The text of a sexpr's first child, or an empty string if there is no
+   // such text.  Unlike (*this)[0].text(), doesn't parse a LazySubtree.
+   be::SV car() const noexcept;
 
-   iterator begin() {
-      return children_.begin();
+   std::size_t size() const noexcept {
+      if (type_ != node_type::sexpr) {
+         return 0;
+      }
+      return lazy_ ? lazy_root_().size_ : size_;
    }
 
-   const_iterator begin() const {
-      return children_.begin();
+   bool empty() const noexcept {
+      if (type_ != node_type::sexpr) {
+         return true;
+      }
+      return lazy_ ? lazy_empty_() : size_ == 0;
    }
 
-   const_iterator cbegin() const {
-      return children_.cbegin();
+   iterator begin() noexcept {
+      if (type_ != node_type::sexpr) {
+         return this;
+      }
+      return lazy_ ? lazy_root_().begin() : this + offset_;
    }
 
-   reverse_iterator rbegin() {
-      return children_.rbegin();
+   const_iterator begin() const noexcept {
+      return const_cast<Node*>(this)->begin();
    }
 
-   const_reverse_iterator rbegin() const {
-      return children_.rbegin();
+   const_iterator cbegin() const noexcept {
+      return begin();
    }
 
-   const_reverse_iterator crbegin() const {
-      return children_.crbegin();
+   reverse_iterator rbegin() noexcept {
+      return reverse_iterator(end());
    }
 
-   iterator end() {
-      return children_.end();
+   const_reverse_iterator rbegin() const noexcept {
+      return const_reverse_iterator(end());
    }
 
-   const_iterator end() const {
-      return children_.end();
+   const_reverse_iterator crbegin() const noexcept {
+      return rbegin();
    }
 
-   const_iterator cend() const {
-      return children_.cend();
+   iterator end() noexcept {
+      return begin() + size();
    }
 
-   reverse_iterator rend() {
-      return children_.rend();
+   const_iterator end() const noexcept {
+      return begin() + size();
    }
 
-   const_reverse_iterator rend() const {
-      return children_.rend();
+   const_iterator cend() const noexcept {
+      return end();
    }
 
-   const_reverse_iterator crend() const {
-      return children_.crend();
+   reverse_iterator rend() noexcept {
+      return reverse_iterator(begin());
    }
 
-   Node& add(const Node& node) {
-      children_.push_back(node);
-      return children_.back();
+   const_reverse_iterator rend() const noexcept {
+      return const_reverse_iterator(begin());
    }
 
-   Node& add(Node&& node) {
-      children_.push_back(std::move(node));
-      return children_.back();
+   const_reverse_iterator crend() const noexcept {
+      return rend();
    }
 
-   Node& operator[](std::size_t index) {
-      return children_[index];
+   Node& operator[](std::size_t index) noexcept {
+      return begin()[index];
    }
 
-   const Node& operator[](std::size_t index) const {
-      return children_[index];
+   const Node& operator[](std::size_t index) const noexcept {
+      return begin()[index];
    }
 
    Node& at(std::size_t index) {
-      return children_.at(index);
+      if (index >= size()) {
+         throw std::out_of_range("Node child index out of range");
+      }
+      return begin()[index];
    }
 
    const Node& at(std::size_t index) const {
-      return children_.at(index);
+      if (index >= size()) {
+         throw std::out_of_range("Node child index out of range");
+      }
+      return begin()[index];
    }
 
 private:
+   friend class NodeTreeBuilder;
+   friend class NodeTreeSplicer;
+   friend class BoardCache;
+
+   Node& lazy_root_() const noexcept;
+   bool lazy_empty_() const noexcept;
+
+   union {
+      be::F64 value_;
+      std::ptrdiff_t offset_; // sexpr: nodes from this to the first child (or LazySubtree address); text: bytes from this to the first char
+   };
+   be::U32 size_; // sexpr: number of children; text: length
    node_type type_;
+   be::U8 keyword_;
+   bool lazy_;
+};
+
+static_assert(sizeof(Node) == 16, "Node should be 16 bytes");
+
+///////////////////////////////////////////////////////////////////////////////
+using NodeClassifier = be::U8(*)(be::SV car);
+using LazyPredicate = bool(*)(be::U8 keyword);
+
+class LazySubtree;
+
+///////////////////////////////////////////////////////////////////////////////
+class NodeTree final {
+public:
+   NodeTree()
+      : nodes_(1),
+        data_(nodes_.data()),
+        size_(1) { }
+
+   NodeTree(const NodeTree&) = delete;
+   NodeTree(NodeTree&&) noexcept = default;
+   NodeTree& operator=(const NodeTree&) = delete;
+   NodeTree& operator=(NodeTree&&) noexcept = default;
+
+   // Wraps an arena owned by something else (e.g. a mapped BoardCache),
+   // which must outlive the tree.
+   static NodeTree view(Node* nodes, std::size_t size) noexcept {
+      NodeTree tree(std::vector<Node>{});
+      tree.data_ = nodes;
+      tree.size_ = size;
+      return tree;
+   }
+
+   Node& root() noexcept {
+      return data_[size_ - 1];
+   }
+
+   const Node& root() const noexcept {
+      return data_[size_ - 1];
+   }
+
+   // total number of nodes, including the root
+   std::size_t size() const noexcept {
+      return size_;
+   }
+
+private:
+   friend class NodeTreeBuilder;
+   friend class NodeTreeSplicer;
+   friend class BoardCache;
+
+   explicit NodeTree(std::vector<Node>&& nodes) noexcept
+      : nodes_(std::move(nodes)),
+        data_(nodes_.data()),
+        size_(nodes_.size()) { }
+
+   std::vector<Node> nodes_; // empty if the arena is owned elsewhere
+   Node* data_;              // post-order; the root is always last
+   std::size_t size_;
+   std::vector<std::unique_ptr<LazySubtree>> deferred_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Shared by all of a tree's LazySubtrees.  Subtrees are parsed while holding
+// the mutex, since the interner isn't thread safe.
+struct LazyContext {
+   be::util::StringInterner& si;
+   NodeClassifier classifier;
+   std::mutex mutex;
+
+   LazyContext(be::util::StringInterner& si, NodeClassifier classifier)
+      : si(si),
+        classifier(classifier) { }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A sexpr whose parsing has been deferred by parse_lazy().  The source text
+// must outlive it.
+class LazySubtree final {
+public:
+   LazySubtree(be::SV text, be::SV car, std::shared_ptr<LazyContext> context) noexcept
+      : text_(text),
+        car_(car),
+        context_(std::move(context)) { }
+
+   be::SV car() const noexcept {
+      return car_;
+   }
+
+   // Deferred sexprs always have a car, so this is only true once parsing
+   // has failed.  Doesn't parse the subtree.
+   bool empty() const noexcept {
+      Node* root = root_.load(std::memory_order_acquire);
+      return root == &empty_;
+   }
+
+   // Parses the subtree on first use and returns the sexpr.  If parsing
+   // fails, a warning is logged and the sexpr is left empty.
+   Node& root() noexcept {
+      Node* root = root_.load(std::memory_order_acquire);
+      return root ? *root : materialize_();
+   }
+
+private:
+   Node& materialize_() noexcept;
+   void report_failure_(const char* what) const noexcept;
+
    be::SV text_;
-   be::F64 value_;
-   child_list children_;
+   be::SV car_;
+   std::shared_ptr<LazyContext> context_;
+   std::atomic<Node*> root_ { nullptr };
+   NodeTree tree_;
+   Node empty_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline Node& Node::lazy_root_() const noexcept {
+   return reinterpret_cast<LazySubtree*>(offset_)->root();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline bool Node::lazy_empty_() const noexcept {
+   return reinterpret_cast<const LazySubtree*>(offset_)->empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline be::SV Node::car() const noexcept {
+   if (type_ != node_type::sexpr) {
+      return be::SV();
+   } else if (lazy_) {
+      return reinterpret_cast<const LazySubtree*>(offset_)->car();
+   } else if (size_ == 0) {
+      return be::SV();
+   }
+   return begin()->text();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds a NodeTree by post-order compaction: children are buffered until
+// their sexpr closes, then moved into the arena as one contiguous range.
+class NodeTreeBuilder final {
+public:
+   explicit NodeTreeBuilder(NodeClassifier classifier = nullptr)
+      : classifier_(classifier),
+        defer_(nullptr),
+        frames_ { Frame { 0, no_keyword } } { }
+
+   // Sexprs whose keyword satisfies defer will become LazySubtrees which
+   // share context.  The text passed to the parser must outlive the tree.
+   void set_lazy(std::shared_ptr<LazyContext> context, LazyPredicate defer) {
+      context_ = std::move(context);
+      defer_ = context_ && context_->classifier ? defer : nullptr;
+   }
+
+   bool lazy() const noexcept {
+      return defer_ != nullptr;
+   }
+
+   void reserve(std::size_t nodes) {
+      nodes_.reserve(nodes);
+   }
+
+   void add(be::SV text) {
+      // offset_ holds the absolute address until finish() makes it relative
+      Node leaf;
+      leaf.type_ = Node::node_type::text;
+      leaf.offset_ = reinterpret_cast<std::intptr_t>(text.data());
+      leaf.size_ = (be::U32)text.size();
+      pending_.push_back(leaf);
+   }
+
+   void add(be::F64 value) {
+      Node leaf;
+      leaf.type_ = Node::node_type::value;
+      leaf.value_ = value;
+      pending_.push_back(leaf);
+   }
+
+   void open() {
+      frames_.push_back(Frame { pending_.size(), no_keyword });
+   }
+
+   // Called when lazy() with the first atom of the innermost open sexpr,
+   // before adding it.  If this returns true, the parser must skip the rest
+   // of the sexpr and pass its text (including parens) to defer().
+   bool should_defer(be::SV car) {
+      Frame& frame = frames_.back();
+      if (frames_.size() <= 1 || frame.begin != pending_.size()) {
+         return false;
+      }
+      frame.keyword = classifier_(car);
+      return defer_((be::U8)frame.keyword);
+   }
+
+   void defer(be::SV text, be::SV car) {
+      Frame frame = frames_.back();
+      frames_.pop_back();
+      deferred_.push_back(std::make_unique<LazySubtree>(text, car, context_));
+
+      Node sexpr;
+      sexpr.offset_ = reinterpret_cast<std::intptr_t>(deferred_.back().get());
+      sexpr.keyword_ = (be::U8)frame.keyword;
+      sexpr.lazy_ = true;
+      pending_.push_back(sexpr);
+   }
+
+   // Returns false if there is no open sexpr other than the root.
+   bool close() {
+      if (frames_.size() <= 1) {
+         return false;
+      }
+
+      Node sexpr = place_(frames_.back());
+      frames_.pop_back();
+      pending_.push_back(sexpr);
+      return true;
+   }
+
+   // Implicitly closes any sexprs which are still open.
+   NodeTree finish() {
+      while (close()) { }
+
+      Node root = place_(frames_.back());
+      nodes_.push_back(root);
+      nodes_.back().offset_ -= (std::ptrdiff_t)(nodes_.size() - 1);
+
+      // the arena won't move again, so text can now be located relative to each node
+      for (Node& node : nodes_) {
+         if (node.type_ == Node::node_type::text) {
+            node.offset_ -= reinterpret_cast<std::intptr_t>(&node);
+         }
+      }
+
+      NodeTree tree(std::move(nodes_));
+      tree.deferred_ = std::move(deferred_);
+      nodes_.clear();
+      deferred_.clear();
+      return tree;
+   }
+
+private:
+   static constexpr int no_keyword = -1;
+
+   struct Frame {
+      std::size_t begin; // index in pending_ of the sexpr's first child
+      int keyword;
+   };
+
+   // Moves pending_[frame.begin, end) into the arena and returns a sexpr whose
+   // offset_ holds the absolute arena index of the first child; it becomes
+   // relative when the sexpr itself is placed.
+   Node place_(Frame frame) {
+      Node sexpr;
+      sexpr.offset_ = (std::ptrdiff_t)nodes_.size();
+      sexpr.size_ = (be::U32)(pending_.size() - frame.begin);
+
+      if (frame.keyword != no_keyword) {
+         sexpr.keyword_ = (be::U8)frame.keyword; // already classified by should_defer()
+      } else if (classifier_ && sexpr.size_ > 0) {
+         const Node& car = pending_[frame.begin];
+         if (car.type_ == Node::node_type::text) {
+            // car.offset_ is still the absolute address of its text
+            sexpr.keyword_ = classifier_(be::SV(reinterpret_cast<const char*>(car.offset_), car.size_));
+         }
+      }
+
+      for (std::size_t i = frame.begin, n = pending_.size(); i < n; ++i) {
+         nodes_.push_back(pending_[i]);
+         Node& placed = nodes_.back();
+         if (placed.type_ == Node::node_type::sexpr && !placed.lazy_) {
+            placed.offset_ -= (std::ptrdiff_t)(nodes_.size() - 1);
+         }
+      }
+
+      pending_.resize(frame.begin);
+      return sexpr;
+   }
+
+   NodeClassifier classifier_;
+   LazyPredicate defer_;
+   std::shared_ptr<LazyContext> context_;
+   std::vector<Node> nodes_;
+   std::vector<Node> pending_;
+   std::vector<Frame> frames_;
+   std::vector<std::unique_ptr<LazySubtree>> deferred_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -153,11 +463,8 @@ inline Node::iterator find(Node& node, be::SV car) {
    using iterator = Node::iterator;
    for (iterator it = node.begin(), end = node.end(); it != end; ++it) {
       const Node& child = *it;
-      if (child.type() == Node::node_type::sexpr && !child.empty()) {
-         const Node& child_car = child[0];
-         if (child_car.type() == Node::node_type::text && child_car.text() == car) {
-            return it;
-         }
+      if (child.type() == Node::node_type::sexpr && !child.empty() && child.car() == car) {
+         return it;
       }
    }
    return node.end();
@@ -168,11 +475,8 @@ inline Node::const_iterator find(const Node& node, be::SV car) {
    using iterator = Node::const_iterator;
    for (iterator it = node.begin(), end = node.end(); it != end; ++it) {
       const Node& child = *it;
-      if (child.type() == Node::node_type::sexpr && !child.empty()) {
-         const Node& child_car = child[0];
-         if (child_car.type() == Node::node_type::text && child_car.text() == car) {
-            return it;
-         }
+      if (child.type() == Node::node_type::sexpr && !child.empty() && child.car() == car) {
+         return it;
       }
    }
    return node.end();
@@ -209,33 +513,66 @@ inline Node::const_iterator find(const Node& node, be::F64 car) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-inline Node parse(be::SV text, be::util::StringInterner& si) {
-   using iterator = be::SV::const_iterator;
+// True if both nodes have the same type, keyword, text or value, and
+// equivalent children.
+inline bool equivalent(const Node& a, const Node& b) noexcept {
+   if (a.type() != b.type() || a.keyword() != b.keyword()) {
+      return false;
+   }
+
+   switch (a.type()) {
+      case Node::node_type::text:
+         return a.text() == b.text();
+
+      case Node::node_type::value:
+      {
+         be::F64 av = a.value();
+         be::F64 bv = b.value();
+         return std::memcmp(&av, &bv, sizeof(be::F64)) == 0;
+      }
 
-   Node root = Node();
-   std::vector<Node*> stack { &root };
+      default:
+         if (a.size() != b.size()) {
+            return false;
+         }
+         for (std::size_t i = 0, n = a.size(); i < n; ++i) {
+            if (!equivalent(a[i], b[i])) {
+               return false;
+            }
+         }
+         return true;
+   }
+}
 
+///////////////////////////////////////////////////////////////////////////////
+inline void parse_scalar_into(be::SV text, be::util::StringInterner& si, bool text_outlives_tree, NodeTreeBuilder& builder) {
    bool in_number = false;
    bool in_fraction = false;
    bool in_string = false; // non-quoted; includes numbers
    bool in_quote = false;
+   bool in_escaped_quote = false;
    bool in_escape = false;
 
    be::S work;
 
-   iterator begin = text.begin();
-   iterator end = text.end();
-   iterator it = begin;
+   auto atom = [&](const char* begin, const char* end) {
+      be::SV token(begin, (std::size_t)(end - begin));
+      return text_outlives_tree ? token : si(token);
+   };
+
+   const char* token_begin = nullptr;
+   const char* car_open = nullptr; // the '(' of a sexpr whose first child hasn't been parsed yet
+   const char* begin = text.data();
+   const char* end = begin + text.size();
+   const char* it = begin;
    while (it != end) {
       char c = *it;
       ++it;
 
       if (in_number) {
          if (c >= '0' && c <= '9') {
-            work.append(1, c);
             continue;
          } else if (!in_fraction && c == '.') {
-            work.append(1, c);
             in_fraction = true;
             continue;
          } else {
@@ -248,8 +585,8 @@ inline Node parse(be::SV text, be::util::StringInterner& si) {
                case '\n':
                case '(':
                case ')':
-                  stack.back()->add(Node(std::strtod(work.c_str(), nullptr)));
-                  work.clear();
+                  builder.add(parse_decimal(token_begin, it - 1));
+                  car_open = nullptr;
                   in_string = false;
                   --it; // so that we can reprocess '(' or ')' outside of a value state
                   continue;
@@ -268,13 +605,25 @@ inline Node parse(be::SV text, be::util::StringInterner& si) {
             case '\n':
             case '(':
             case ')':
-               stack.back()->add(Node(si(work)));
-               work.clear();
+            {
+               be::SV token = atom(token_begin, it - 1);
                in_string = false;
+               if (car_open && builder.lazy() && builder.should_defer(token)) {
+                  std::size_t open = (std::size_t)(car_open - begin);
+                  std::size_t close = match_bracket(text, open);
+                  if (close != be::SV::npos) {
+                     builder.defer(text.substr(open, close + 1 - open), token);
+                     car_open = nullptr;
+                     it = begin + close + 1;
+                     continue;
+                  }
+               }
+               builder.add(token);
+               car_open = nullptr;
                --it; // so that we can reprocess '(' or ')' outside of a string state
                continue;
+            }
             default:
-               work.append(1, c);
                continue;
          }
       }
@@ -295,46 +644,217 @@ inline Node parse(be::SV text, be::util::StringInterner& si) {
             continue;
          } else if (c == '"') {
             if (it != end && *it == '"') {
+               if (!in_escaped_quote) {
+                  work.assign(token_begin, it - 1);
+                  in_escaped_quote = true;
+               }
                in_escape = true;
+               continue;
             } else {
-               stack.back()->add(Node(si(work)));
-               work.clear();
+               if (in_escaped_quote) {
+                  builder.add(si(work));
+                  work.clear();
+                  in_escaped_quote = false;
+               } else {
+                  builder.add(atom(token_begin, it - 1));
+               }
+               car_open = nullptr;
                in_quote = false;
                continue;
             }
          } else {
-            work.append(1, c);
+            if (in_escaped_quote) {
+               work.append(1, c);
+            }
             continue;
          }
       }
 
       if ((c >= '0' && c <= '9') || c == '+' || c == '-') {
-         work.append(1, c);
+         token_begin = it - 1;
          in_number = true;
          in_string = true;
       } else if (c == '.') {
-         work.append(1, c);
+         token_begin = it - 1;
          in_number = true;
          in_fraction = true;
          in_string = true;
       } else if (c == '"') {
+         token_begin = it;
          in_quote = true;
       } else if (c == '(') {
-         Node& sexpr = stack.back()->add(Node());
-         stack.push_back(&sexpr);
+         builder.open();
+         car_open = it - 1;
       } else if (c == ')') {
-         if (stack.size() > 1) {
-            stack.pop_back();
-         } else {
-            work.append(1, c);
+         car_open = nullptr;
+         if (!builder.close()) {
+            token_begin = it - 1;
             in_string = true;
          }
       } else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
-         work.append(1, c);
+         token_begin = it - 1;
          in_string = true;
       }
    }
-   return root;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline NodeTree parse_scalar(be::SV text, be::util::StringInterner& si, bool text_outlives_tree = false, NodeClassifier classifier = nullptr) {
+   NodeTreeBuilder builder(classifier);
+   builder.reserve(text.size() / 8);
+   parse_scalar_into(text, si, text_outlives_tree, builder);
+   return builder.finish();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds the same tree as parse_scalar() from the positions found by
+// SexprIndexer.  Returns false if the text can't be parsed this way.
+inline bool parse_indexed(be::SV text, be::util::StringInterner& si, bool text_outlives_tree, NodeTreeBuilder& builder) {
+   if (text.size() > SexprIndexer::max_size) {
+      return false;
+   }
+
+   std::vector<be::U32> index;
+   index.reserve(SexprIndexer::chunk_size / 4);
+
+   be::S work;
+
+   auto atom = [&](const char* begin, const char* end) {
+      be::SV token(begin, (std::size_t)(end - begin));
+      return text_outlives_tree ? token : si(token);
+   };
+
+   const char* begin = text.data();
+   const char* end = begin + text.size();
+   std::size_t resume = 0; // positions before this are inside an atom already consumed
+   std::size_t car_open = be::SV::npos; // the '(' of a sexpr whose first child hasn't been parsed yet
+
+   SexprIndexer indexer(text);
+   bool more = true;
+   while (more) {
+      index.clear();
+      more = indexer.next(index);
+      if (indexer.irregular()) {
+         return false;
+      }
+
+      for (be::U32 pos : index) {
+         if (pos < resume) {
+            continue;
+         }
+
+         const char* it = begin + pos;
+         switch (*it) {
+            case '(':
+               builder.open();
+               car_open = pos;
+               break;
+
+            case ')':
+               if (!builder.close()) {
+                  return false;
+               }
+               car_open = be::SV::npos;
+               break;
+
+            case '"':
+            {
+               const char* token_begin = it + 1;
+               const char* close = token_begin;
+               bool escaped = false;
+               for (;;) {
+                  close = static_cast<const char*>(std::memchr(close, '"', (std::size_t)(end - close)));
+                  if (!close) {
+                     return true; // unterminated quotes are discarded
+                  } else if (close + 1 != end && close[1] == '"') {
+                     escaped = true;
+                     close += 2;
+                  } else {
+                     break;
+                  }
+               }
+
+               if (escaped) {
+                  work.clear();
+                  for (const char* c = token_begin; c != close; ++c) {
+                     work.append(1, *c);
+                     if (*c == '"') {
+                        ++c; // "" is an escaped "
+                     }
+                  }
+                  builder.add(si(work));
+               } else {
+                  builder.add(atom(token_begin, close));
+               }
+
+               car_open = be::SV::npos;
+               resume = (std::size_t)(close - begin) + 1;
+               break;
+            }
+
+            default:
+            {
+               char c = *it;
+               bool in_number = (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.';
+               bool in_fraction = c == '.';
+
+               const char* token_end = it + 1;
+               for (; token_end != end; ++token_end) {
+                  c = *token_end;
+                  if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '(' || c == ')') {
+                     break;
+                  } else if (in_number) {
+                     if (c == '.' && !in_fraction) {
+                        in_fraction = true;
+                     } else if (c < '0' || c > '9') {
+                        in_number = false;
+                     }
+                  }
+               }
+
+               if (token_end == end) {
+                  return true; // unterminated atoms are discarded
+               }
+
+               resume = (std::size_t)(token_end - begin);
+               if (in_number) {
+                  builder.add(parse_decimal(it, token_end));
+               } else {
+                  be::SV token = atom(it, token_end);
+                  if (car_open != be::SV::npos && builder.lazy() && builder.should_defer(token)) {
+                     std::size_t close = match_bracket(text, car_open);
+                     if (close != be::SV::npos) {
+                        builder.defer(text.substr(car_open, close + 1 - car_open), token);
+                        resume = close + 1;
+                        car_open = be::SV::npos;
+                        break;
+                     }
+                  }
+                  builder.add(token);
+               }
+
+               car_open = be::SV::npos;
+               break;
+            }
+         }
+      }
+   }
+
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// If text_outlives_tree is true, atoms are returned as slices of text and only
+// quoted strings containing escapes are copied into the interner.  If a
+// classifier is provided, it is called once for the first atom of each sexpr
+// and the result is available from Node::keyword().
+inline NodeTree parse(be::SV text, be::util::StringInterner& si, bool text_outlives_tree = false, NodeClassifier classifier = nullptr) {
+   NodeTreeBuilder builder(classifier);
+   builder.reserve(text.size() / 8);
+   if (parse_indexed(text, si, text_outlives_tree, builder)) {
+      return builder.finish();
+   }
+   return parse_scalar(text, si, text_outlives_tree, classifier);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
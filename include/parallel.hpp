@@ -0,0 +1,66 @@
+#pragma once
+#ifndef KIVIEW_PARALLEL_HPP_
+#define KIVIEW_PARALLEL_HPP_
+
+#include <be/core/be.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t worker_count() noexcept {
+   return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Calls func(i) for each i in [0, count), spread across up to worker_count()
+// threads (including the calling thread).  Indices are handed out in order,
+// one at a time, so uneven tasks balance themselves.  The first exception
+// thrown by func is rethrown once all threads have finished.
+template <typename F>
+void parallel_for(std::size_t count, F&& func) {
+   std::size_t threads = std::min(count, worker_count());
+   if (threads <= 1) {
+      for (std::size_t i = 0; i < count; ++i) {
+         func(i);
+      }
+      return;
+   }
+
+   std::atomic<std::size_t> next { 0 };
+   std::exception_ptr error;
+   std::mutex error_mutex;
+
+   auto work = [&]() {
+      for (std::size_t i; (i = next++) < count; ) {
+         try {
+            func(i);
+         } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+               error = std::current_exception();
+            }
+            next = count;
+         }
+      }
+   };
+
+   std::vector<std::thread> pool;
+   pool.reserve(threads - 1);
+   for (std::size_t t = 1; t < threads; ++t) {
+      pool.emplace_back(work);
+   }
+   work();
+   for (std::thread& thread : pool) {
+      thread.join();
+   }
+
+   if (error) {
+      std::rethrow_exception(error);
+   }
+}
+
+#endif
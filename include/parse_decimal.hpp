@@ -0,0 +1,71 @@
+#pragma once
+#ifndef KIVIEW_PARSE_DECIMAL_HPP_
+#define KIVIEW_PARSE_DECIMAL_HPP_
+
+#include <be/core/be.hpp>
+#include <charconv>
+
+///////////////////////////////////////////////////////////////////////////////
+// Converts an atom matching [+-]?[0-9]*(\.[0-9]*)? to the same value
+// std::strtod would produce, without copying it or consulting the locale.
+// Atoms with no digits (e.g. "-") produce 0, as strtod does.
+inline be::F64 parse_decimal(const char* begin, const char* end) noexcept {
+   static constexpr be::F64 powers_of_ten[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+   };
+   constexpr be::U64 max_exact_mantissa = 1ull << 53;
+
+   const char* it = begin;
+   bool negative = false;
+   if (it != end && (*it == '+' || *it == '-')) {
+      negative = *it == '-';
+      ++it;
+   }
+
+   const char* digits_begin = it;
+   be::U64 mantissa = 0;
+   be::U32 digits = 0;
+   be::U32 fraction_digits = 0;
+   bool in_fraction = false;
+   bool any_digits = false;
+   bool exact = true;
+
+   for (; it != end; ++it) {
+      const char c = *it;
+      if (c >= '0' && c <= '9') {
+         any_digits = true;
+         if (mantissa != 0 || c != '0') {
+            if (++digits > 19) {
+               exact = false;
+               break;
+            }
+         }
+         mantissa = mantissa * 10 + (be::U64)(c - '0');
+         if (in_fraction) {
+            ++fraction_digits;
+         }
+      } else if (c == '.' && !in_fraction) {
+         in_fraction = true;
+      } else {
+         break;
+      }
+   }
+
+   if (!any_digits) {
+      return 0;
+   }
+
+   if (exact && mantissa <= max_exact_mantissa && fraction_digits <= 22) {
+      // both operands are exactly representable, so the IEEE division is
+      // correctly rounded, matching strtod
+      be::F64 value = (be::F64)mantissa / powers_of_ten[fraction_digits];
+      return negative ? -value : value;
+   }
+
+   be::F64 value = 0;
+   std::from_chars(digits_begin, end, value, std::chars_format::fixed);
+   return negative ? -value : value;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef KIVIEW_PARSE_LAZY_HPP_
+#define KIVIEW_PARSE_LAZY_HPP_
+
+#include "node.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds the same tree as parse(text, si, true, classifier), except that any
+// sexpr whose first atom is unquoted and has a keyword satisfying defer
+// becomes a LazySubtree, which is parsed the first time its children are
+// accessed.  The parser skips a deferred sexpr by matching its brackets
+// rather than building nodes for it.  text and si must outlive the tree.
+NodeTree parse_lazy(be::SV text, be::util::StringInterner& si, NodeClassifier classifier, LazyPredicate defer);
+
+///////////////////////////////////////////////////////////////////////////////
+// As above, but the non-deferred parts of text are interned in si, while
+// subtrees are parsed later using context.  Used by parse_parallel().
+NodeTree parse_lazy(be::SV text, be::util::StringInterner& si, const std::shared_ptr<LazyContext>& context, LazyPredicate defer);
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+#ifndef KIVIEW_PARSE_PARALLEL_HPP_
+#define KIVIEW_PARSE_PARALLEL_HPP_
+
+#include "node.hpp"
+#include "parse_lazy.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds the same tree as parse(), but when the text is a single large sexpr
+// (as board files are) its top-level children are split into chunks which
+// are parsed on worker_count() threads and then spliced back together.
+// Falls back to parse() when the text is small or can't be split safely.
+// If text_outlives_tree and defer is provided, chunks are parsed with
+// parse_lazy() instead.
+NodeTree parse_parallel(be::SV text, be::util::StringInterner& si, bool text_outlives_tree = false, NodeClassifier classifier = nullptr, LazyPredicate defer = nullptr);
+
+#endif
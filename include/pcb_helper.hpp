@@ -6,7 +6,8 @@
 #include <be/util/keyword_parser.hpp>
 
 //////////////////////////////////////////////////////////////////////////////
-enum class node_type {
+// Stored in Node::keyword(); changing the values invalidates BoardCache files.
+enum class node_type : be::U8 {
    ignored,
    n_kicad_pcb,
    n_net,
@@ -41,7 +42,12 @@ enum class node_type {
    n_fp_line,
    n_fp_arc,
    n_fp_circle,
-   n_fp_text
+   n_fp_text,
+   n_model,
+   n_setup,
+   n_page,
+   n_net_class,
+   n_dimension // last; BoardCache rejects keywords past it
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -81,6 +87,37 @@ enum class layer_type {
    l_cuts,
 };
 
+//////////////////////////////////////////////////////////////////////////////
+// KiCad's own layer numbering.
+enum class layer_id : be::U8 {
+   f_cu,
+   in1_cu, in2_cu, in3_cu, in4_cu, in5_cu, in6_cu, in7_cu, in8_cu, in9_cu, in10_cu,
+   in11_cu, in12_cu, in13_cu, in14_cu, in15_cu, in16_cu, in17_cu, in18_cu, in19_cu, in20_cu,
+   in21_cu, in22_cu, in23_cu, in24_cu, in25_cu, in26_cu, in27_cu, in28_cu, in29_cu, in30_cu,
+   b_cu,
+   b_adhes,
+   f_adhes,
+   b_paste,
+   f_paste,
+   b_silks,
+   f_silks,
+   b_mask,
+   f_mask,
+   dwgs_user,
+   cmts_user,
+   eco1_user,
+   eco2_user,
+   edge_cuts,
+   margin,
+   b_crtyd,
+   f_crtyd,
+   b_fab,
+   f_fab,
+   count,
+   unknown = count, // a name which isn't one of the above
+   none             // the item has no layer
+};
+
 //////////////////////////////////////////////////////////////////////////////
 const be::util::ExactKeywordParser<node_type>& node_type_parser();
 
@@ -91,9 +128,53 @@ const be::util::ExactKeywordParser<pad_type>& pad_type_parser();
 const be::util::ExactKeywordParser<pad_shape>& pad_shape_parser();
 
 //////////////////////////////////////////////////////////////////////////////
-node_type get_node_type(const Node& node);
+// NodeClassifier for parse(); get_node_type() only works on trees parsed with it.
+be::U8 classify_node(be::SV car);
+
+//////////////////////////////////////////////////////////////////////////////
+// LazyPredicate for parse_lazy(); defers subtrees which aren't rendered.
+bool defer_node(be::U8 keyword);
+
+//////////////////////////////////////////////////////////////////////////////
+inline node_type get_node_type(const Node& node) {
+   return (node_type)node.keyword();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Returns layer_id::unknown for names which aren't a single layer, including
+// wildcards such as "*.Cu".
+layer_id parse_layer_id(be::SV name);
+
+//////////////////////////////////////////////////////////////////////////////
+// One bit for each layer_id, including unknown.
+using layer_mask = be::U64;
+
+//////////////////////////////////////////////////////////////////////////////
+inline constexpr layer_mask layer_bit(layer_id id) {
+   return id == layer_id::none ? 0 : (layer_mask)1 << (be::U8)id;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// F.Cu, In1.Cu through In30.Cu, and B.Cu.
+constexpr layer_mask copper_layers = ((layer_mask)1 << ((be::U8)layer_id::b_cu + 1)) - layer_bit(layer_id::f_cu);
+
+//////////////////////////////////////////////////////////////////////////////
+// The layers a layer or layers entry refers to, expanding wildcards.  *.Cu
+// and F&B.Cu are every copper layer, inner ones included.
+layer_mask parse_layer_mask(be::SV name);
+
+//////////////////////////////////////////////////////////////////////////////
+// A via's layers entry names the copper layers it goes between; this adds
+// those in between.
+layer_mask copper_span(layer_mask layers);
+
+//////////////////////////////////////////////////////////////////////////////
+// The layers which are on face and of the given type.
+layer_mask layer_query_mask(face_type face, layer_type layer);
 
 //////////////////////////////////////////////////////////////////////////////
-bool check_layer(const Node& node, face_type face, layer_type layer);
+inline bool check_layer(layer_mask layers, face_type face, layer_type layer) {
+   return (layers & layer_query_mask(face, layer)) != 0;
+}
 
 #endif
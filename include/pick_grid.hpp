@@ -0,0 +1,106 @@
+#pragma once
+#ifndef KIVIEW_PICK_GRID_HPP_
+#define KIVIEW_PICK_GRID_HPP_
+
+#include "board_model.hpp"
+#include <glm/common.hpp>
+#include <set>
+
+///////////////////////////////////////////////////////////////////////////////
+// A uniform grid over the pickable items of a BoardModel, one per face, so
+// that finding the item closest to a click only looks at nearby cells.
+// Modules, vias and pads are entered at their positions and segments along
+// their centerlines, since that's what selection measures distance to.
+class PickGrid final {
+public:
+   enum class entry_type : be::U8 {
+      module,
+      segment,
+      via,
+      pad
+   };
+
+   struct Entry {
+      be::U32 index; // into the model's array for type
+      entry_type type;
+   };
+
+   PickGrid() = default;
+
+   // Only items from the first item_limit board items are entered.
+   explicit PickGrid(const BoardModel& model, be::U32 item_limit = BoardModel::none);
+
+   // Calls visit(const Entry&) for every entry on face (f_front or f_back)
+   // in a cell overlapping the square of half-size radius around center.
+   // This includes every entry within radius of center, along with some
+   // further away.  Segments spanning several cells may be visited more
+   // than once.
+   template <typename F>
+   void query(face_type face, glm::vec2 center, be::F32 radius, F&& visit) const;
+
+   std::size_t cells() const noexcept;
+   std::size_t size() const noexcept; // number of entries, counting each cell's separately
+
+private:
+   struct Grid {
+      glm::vec2 origin;
+      be::F32 inv_cell_size = 0;
+      be::U32 cols = 0;
+      be::U32 rows = 0;
+      std::vector<be::U32> cell_start; // cell c's entries are [cell_start[c], cell_start[c + 1])
+      std::vector<Entry> entries;
+   };
+
+   const Grid& grid_(face_type face) const noexcept {
+      return grids_[face == face_type::f_back ? 1 : 0];
+   }
+
+   Grid grids_[2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+void PickGrid::query(face_type face, glm::vec2 center, be::F32 radius, F&& visit) const {
+   const Grid& grid = grid_(face);
+   if (grid.entries.empty()) {
+      return;
+   }
+
+   // widened slightly so that rounding can't miss an entry right at a cell
+   // edge; clamped rather than rejected, since the border cells also hold
+   // everything beyond them
+   be::F32 half = radius * grid.inv_cell_size + 1e-3f;
+   glm::vec2 pos = (center - grid.origin) * grid.inv_cell_size;
+   glm::vec2 last = glm::vec2((be::F32)grid.cols - 1.f, (be::F32)grid.rows - 1.f);
+   glm::vec2 lo = glm::clamp(pos - half, glm::vec2(0.f), last);
+   glm::vec2 hi = glm::clamp(pos + half, glm::vec2(0.f), last);
+
+   be::U32 col_begin = (be::U32)lo.x;
+   be::U32 col_end = (be::U32)hi.x + 1;
+   for (be::U32 row = (be::U32)lo.y, row_end = (be::U32)hi.y + 1; row < row_end; ++row) {
+      const be::U32* starts = grid.cell_start.data() + (std::size_t)row * grid.cols;
+      const Entry* it = grid.entries.data() + starts[col_begin];
+      const Entry* end = grid.entries.data() + starts[col_end];
+      for (; it != end; ++it) {
+         visit(*it);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Finds the module on side whose position is closest to target and within
+// max_distance, which is updated to its distance.  If grid is null, every
+// module is checked.  Only items from the first item_limit board items are
+// considered.
+const Node* find_closest_module(const BoardModel& model, const PickGrid* grid, glm::vec2 target, be::F32& max_distance,
+                                face_type side, be::U32 item_limit = BoardModel::none);
+
+///////////////////////////////////////////////////////////////////////////////
+// As above, but finds the closest segment or via, or with include_pads, pad,
+// that belongs to a net not in skip_nets, and returns that net, or
+// BoardModel::none.
+be::U32 find_closest_copper(const BoardModel& model, const PickGrid* grid, glm::vec2 target, be::F32& max_distance,
+                            face_type side, const std::set<be::U32>& skip_nets, bool include_pads,
+                            be::U32 item_limit = BoardModel::none);
+
+#endif
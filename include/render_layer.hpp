@@ -2,12 +2,15 @@
 #ifndef KIVIEW_RENDER_LAYER_HPP_
 #define KIVIEW_RENDER_LAYER_HPP_
 
-#include "node.hpp"
-#include "triangle.hpp"
+#include "board_model.hpp"
+#include "indexed_mesh.hpp"
+#include "shape_instances.hpp"
+#include <atomic>
 #include <functional>
 #include <vector>
 
-using RenderNodePredicate = std::function<std::pair<bool, bool>(const Node&, const std::vector<const Node*>&)>;
+// Decides whether the i'th entry of the model's array for an item type is drawn.
+using RenderItemPredicate = std::function<bool(const BoardModel& model, model_item type, std::size_t i)>;
 
 //////////////////////////////////////////////////////////////////////////////
 be::U32 pad_segment_density();
@@ -26,6 +29,95 @@ be::U32 zone_perimeter_endcap_segment_density();
 void zone_perimeter_endcap_segment_density(be::U32 segments_per_circle);
 
 //////////////////////////////////////////////////////////////////////////////
-std::vector<triangle> render_layer(const Node& node, const RenderNodePredicate& pred);
+// The densities above, as read at the start of a pass over the board.  Each
+// pass renders with a single snapshot, so changing a density while another
+// thread is tessellating only affects later passes.
+//
+// If max_error is set, they're only upper limits: each curve gets the fewest
+// segments, from a few fixed levels, that keep it within max_error (in board
+// units) of the true curve.
+struct SegmentDensities {
+   be::U32 pads;
+   be::U32 endcaps;
+   be::U32 arcs;
+   be::U32 zone_endcaps;
+   be::F32 max_error = 0;
+
+   // The segments per circle for a curve of the given radius.
+   be::U32 fit(be::U32 max_segments, be::F32 radius) const noexcept;
+};
+
+SegmentDensities segment_densities();
+
+//////////////////////////////////////////////////////////////////////////////
+IndexedMesh render_layer(const BoardModel& model, const RenderItemPredicate& pred);
+
+//////////////////////////////////////////////////////////////////////////////
+// Appends the triangles render_layer() produces for one board item.
+void render_layer_item(const BoardModel& model, std::size_t item, const RenderItemPredicate& pred, IndexedMesh& out);
+
+//////////////////////////////////////////////////////////////////////////////
+// Appends the triangles render_layer() produces for the segments, vias, pads
+// and zones of one net, leaving out those of board items outside region.
+void render_layer_net(const BoardModel& model, be::U32 net, const RenderItemPredicate& pred, IndexedMesh& out,
+                      const SegmentDensities& densities = segment_densities(),
+                      const BoardModel::Bounds& region = BoardModel::Bounds::everything());
+
+//////////////////////////////////////////////////////////////////////////////
+// The outputs of a single pass over the board for several layers at once.
+class LayerBuckets final {
+public:
+   struct Bucket {
+      RenderItemPredicate pred;
+      IndexedMesh* mesh;
+      InstancedShapes* shapes; // may be null
+      std::vector<be::U32>* item_ends; // may be null
+      std::vector<be::U32>* instance_ends; // may be null
+   };
+
+   // Board items outside region are left out, as if they had no triangles.
+   explicit LayerBuckets(SegmentDensities densities = segment_densities(),
+                         const BoardModel::Bounds& region = BoardModel::Bounds::everything())
+      : densities_(densities),
+        region_(region) { }
+
+   // Triangles accepted by pred are appended to mesh.  If shapes isn't null,
+   // pads, vias and holes are added to it as instances instead.  render_layers()
+   // also records where each item's triangles and instances end in item_ends
+   // and instance_ends, if they aren't null.  All must outlive this.
+   void add(RenderItemPredicate pred, IndexedMesh& mesh, InstancedShapes* shapes = nullptr,
+            std::vector<be::U32>* item_ends = nullptr, std::vector<be::U32>* instance_ends = nullptr);
+
+private:
+   friend void render_layers_item(const BoardModel& model, std::size_t item, LayerBuckets& buckets);
+   friend void render_layers(const BoardModel& model, LayerBuckets& buckets, std::size_t begin, std::size_t end,
+                             bool parallel, const std::atomic<bool>* cancel);
+
+   SegmentDensities densities_;
+   BoardModel::Bounds region_;
+   std::vector<Bucket> buckets_;
+   std::vector<const Bucket*> accepted_; // scratch space for render_layers_item()
+   IndexedMesh scratch_;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Appends the triangles render_layer_item() produces for each bucket's
+// predicate to that bucket.  Each shape is tessellated once, however many
+// buckets take it, and each bucket's triangles come in the same order as
+// rendering its layer alone.
+void render_layers_item(const BoardModel& model, std::size_t item, LayerBuckets& buckets);
+
+//////////////////////////////////////////////////////////////////////////////
+// Calls render_layers_item() for every item on the board.  If parallel, items
+// are split into chunks and rendered on worker threads, with the same result
+// as rendering them in order.  Stops early, leaving the buckets incomplete,
+// if cancel is set.
+void render_layers(const BoardModel& model, LayerBuckets& buckets, bool parallel, const std::atomic<bool>* cancel = nullptr);
+
+//////////////////////////////////////////////////////////////////////////////
+// As above, but only for items [begin, end).  Rendering consecutive ranges
+// into the same buckets gives the same result as rendering them all at once.
+void render_layers(const BoardModel& model, LayerBuckets& buckets, std::size_t begin, std::size_t end,
+                   bool parallel, const std::atomic<bool>* cancel = nullptr);
 
 #endif
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef KIVIEW_SEXPR_INDEX_HPP_
+#define KIVIEW_SEXPR_INDEX_HPP_
+
+#include <be/core/be.hpp>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Finds the structural positions of an s-expression 64 bytes at a time:
+// '(', ')', the '"' that opens each quoted string, and the first byte of each
+// unquoted atom.  Uses AVX2 or SSE2 when available, else a scalar classifier.
+class SexprIndexer final {
+public:
+   static constexpr std::size_t chunk_size = 0x10000;
+   static constexpr std::size_t max_size = 0xFFFFFFFFull;
+
+   // With force_scalar, the scalar classifier is used even when SIMD is
+   // available, so that the two can be compared.
+   explicit SexprIndexer(be::SV text, bool force_scalar = false) noexcept
+      : text_(text),
+        scalar_(force_scalar) { }
+
+   // True if AVX2 or SSE2 was available when this was compiled.
+   static bool simd() noexcept;
+
+   // Appends the positions found in the next chunk_size bytes to out.
+   // Returns false once the end of the text has been reached.
+   bool next(std::vector<be::U32>& out);
+
+   // True if a '"' was found that does not begin an atom.  The scalar parser
+   // treats such quotes as part of the preceding atom, so the index can't be
+   // used to reproduce its output.
+   bool irregular() const noexcept {
+      return irregular_;
+   }
+
+private:
+   be::SV text_;
+   std::size_t offset_ = 0;
+   be::U64 in_string_ = 0;  // all ones if the previous block ended inside a quoted string
+   be::U64 prev_delim_ = 1; // 1 if the last byte of the previous block was a delimiter
+   bool irregular_ = false;
+   bool scalar_;
+};
+
+#endif
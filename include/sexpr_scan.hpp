@@ -0,0 +1,152 @@
+#pragma once
+#ifndef KIVIEW_SEXPR_SCAN_HPP_
+#define KIVIEW_SEXPR_SCAN_HPP_
+
+#include <be/core/be.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class sexpr_event {
+   open,
+   close,
+   atom,
+   quote
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum char_class : be::U8 {
+   cc_atom,
+   cc_space,
+   cc_open,
+   cc_close,
+   cc_quote
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct CharClasses {
+   char_class table[256];
+
+   CharClasses() noexcept {
+      std::fill(std::begin(table), std::end(table), cc_atom);
+      table[(be::U8)' '] = cc_space;
+      table[(be::U8)'\t'] = cc_space;
+      table[(be::U8)'\r'] = cc_space;
+      table[(be::U8)'\n'] = cc_space;
+      table[(be::U8)'('] = cc_open;
+      table[(be::U8)')'] = cc_close;
+      table[(be::U8)'"'] = cc_quote;
+   }
+
+   char_class operator()(char c) const noexcept {
+      return table[(be::U8)c];
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline const CharClasses& char_classes() noexcept {
+   static const CharClasses classes;
+   return classes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Walks the structure of text without building anything, following the same
+// states as parse_scalar(), and calls visit(event, pos, depth) for each
+// paren, unquoted atom and quoted string.  depth is the number of sexprs
+// which were open before the event.  Stops early and returns false if visit
+// does.  An unterminated quote ends the scan without an event.
+template <typename F>
+bool scan_sexpr(be::SV text, F&& visit) {
+   const CharClasses& classify = char_classes();
+   const char* begin = text.data();
+   const char* end = begin + text.size();
+   const char* it = begin;
+   std::size_t depth = 0;
+
+   auto skip_atom = [&]() {
+      do {
+         ++it;
+      } while (it != end && (classify(*it) == cc_atom || classify(*it) == cc_quote));
+   };
+
+   while (it != end) {
+      std::size_t pos = (std::size_t)(it - begin);
+      switch (classify(*it)) {
+         case cc_space:
+            ++it;
+            break;
+
+         case cc_open:
+            if (!visit(sexpr_event::open, pos, depth)) {
+               return false;
+            }
+            ++depth;
+            ++it;
+            break;
+
+         case cc_close:
+            if (depth == 0) {
+               // parse_scalar() treats an unmatched ')' as the start of an atom
+               if (!visit(sexpr_event::atom, pos, depth)) {
+                  return false;
+               }
+               skip_atom();
+            } else {
+               --depth;
+               if (!visit(sexpr_event::close, pos, depth)) {
+                  return false;
+               }
+               ++it;
+            }
+            break;
+
+         case cc_quote:
+         {
+            const char* close = it + 1;
+            for (;;) {
+               close = static_cast<const char*>(std::memchr(close, '"', (std::size_t)(end - close)));
+               if (!close) {
+                  return true;
+               } else if (close + 1 != end && close[1] == '"') {
+                  close += 2; // "" is an escaped "
+               } else {
+                  break;
+               }
+            }
+            if (!visit(sexpr_event::quote, pos, depth)) {
+               return false;
+            }
+            it = close + 1;
+            break;
+         }
+
+         default:
+            // unquoted atoms (including any quotes inside them) end at whitespace or a paren
+            if (!visit(sexpr_event::atom, pos, depth)) {
+               return false;
+            }
+            skip_atom();
+            break;
+      }
+   }
+
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Returns the position of the ')' which closes the sexpr opened at
+// text[open], or be::SV::npos if it is never closed.
+inline std::size_t match_bracket(be::SV text, std::size_t open) {
+   std::size_t close = be::SV::npos;
+   scan_sexpr(text.substr(open), [&](sexpr_event event, std::size_t pos, std::size_t depth) {
+      if (event == sexpr_event::close && depth == 0) {
+         close = open + pos;
+         return false;
+      }
+      return true;
+   });
+   return close;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef KIVIEW_SHAPE_INSTANCES_HPP_
+#define KIVIEW_SHAPE_INSTANCES_HPP_
+
+#include "indexed_mesh.hpp"
+#include <be/core/be.hpp>
+#include <glm/mat3x3.hpp>
+#include <unordered_map>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+enum class instanced_shape : be::U8 {
+   circle,
+   oval,
+   rect,
+   trapezoid,
+   drill,
+   footprint
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Everything which determines the triangles of a pad, via, drill hole or
+// module before it's placed on the board.
+struct ShapeKey {
+   instanced_shape shape;
+   be::U32 segments; // per circle, or 0 for shapes without curves
+   glm::vec2 size;   // for footprints, the arc and endcap segments per circle
+   glm::vec2 rect_delta;
+   be::U64 footprint = 0; // hash of a module's footprint and which parts of it are drawn
+};
+
+bool operator==(const ShapeKey& a, const ShapeKey& b) noexcept;
+
+///////////////////////////////////////////////////////////////////////////////
+// Shapes which are tessellated once, around the origin, and the instances
+// placing them on the board.  Boards tend to have thousands of identical
+// pads and vias, so this is much smaller than their triangles.
+class InstancedShapes final {
+public:
+   struct Instance {
+      be::U32 shape;
+      glm::vec2 x_axis; // the columns of the instance's transform
+      glm::vec2 y_axis;
+      glm::vec2 origin;
+   };
+
+   InstancedShapes() = default;
+   InstancedShapes(InstancedShapes&& other) noexcept;
+   InstancedShapes& operator=(InstancedShapes&& other) noexcept;
+
+   // Returns the index of key's shape, calling tessellate(IndexedMesh&) to
+   // append its triangles if it hasn't been seen before.
+   template <typename F>
+   be::U32 shape(const ShapeKey& key, F&& tessellate);
+
+   void add(be::U32 shape, const glm::mat3& transform);
+
+   // Appends other's instances [begin, end), along with any of their shapes
+   // this doesn't have yet.
+   void append(const InstancedShapes& other, std::size_t begin, std::size_t end);
+
+   // Appends the triangles of instances [begin, end) as if they had been
+   // rendered in place.
+   void expand(std::size_t begin, std::size_t end, IndexedMesh& out) const;
+
+   void clear();
+
+   std::size_t shapes() const noexcept {
+      return keys_.size();
+   }
+
+   // shape s's triangles are [shape_starts()[s], shape_starts()[s + 1])
+   const std::vector<be::U32>& shape_starts() const noexcept {
+      return shape_starts_;
+   }
+
+   // and its vertices [vertex_starts()[s], vertex_starts()[s + 1])
+   const std::vector<be::U32>& vertex_starts() const noexcept {
+      return vertex_starts_;
+   }
+
+   const IndexedMesh& mesh() const noexcept {
+      return mesh_;
+   }
+
+   const std::vector<Instance>& instances() const noexcept {
+      return instances_;
+   }
+
+   // Changes whenever the shapes or instances do, and is never the same for
+   // two different InstancedShapes, so that copies uploaded elsewhere can
+   // tell when they're stale.
+   be::U64 revision() const noexcept;
+
+private:
+   struct KeyHash {
+      std::size_t operator()(const ShapeKey& key) const noexcept;
+   };
+
+   std::vector<ShapeKey> keys_;
+   std::unordered_map<ShapeKey, be::U32, KeyHash> ids_;
+   std::vector<be::U32> shape_starts_ = std::vector<be::U32>(1);
+   std::vector<be::U32> vertex_starts_ = std::vector<be::U32>(1);
+   IndexedMesh mesh_;
+   std::vector<Instance> instances_;
+   mutable be::U64 revision_ = 0; // assigned when first asked for after a change
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+be::U32 InstancedShapes::shape(const ShapeKey& key, F&& tessellate) {
+   auto result = ids_.emplace(key, (be::U32)keys_.size());
+   if (result.second) {
+      keys_.push_back(key);
+      tessellate(mesh_);
+      shape_starts_.push_back((be::U32)mesh_.triangles());
+      vertex_starts_.push_back((be::U32)mesh_.vertices.size());
+      revision_ = 0;
+   }
+   return result.first->second;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef KIVIEW_SHAPE_RENDERER_HPP_
+#define KIVIEW_SHAPE_RENDERER_HPP_
+
+#include "shape_instances.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// The shader program for drawing InstancedShapes with instanced arrays.
+// Without GL 3.3, or if the program doesn't build, instanced() is false and
+// ShapeBuffers expands instances into triangles instead.  Must be created
+// and destroyed with the GL context current.
+class ShapeRenderer final {
+public:
+   ShapeRenderer();
+   ~ShapeRenderer();
+   ShapeRenderer(const ShapeRenderer&) = delete;
+   ShapeRenderer& operator=(const ShapeRenderer&) = delete;
+
+   bool instanced() const noexcept {
+      return program_ != 0;
+   }
+
+private:
+   friend class ShapeBuffers;
+
+   be::U32 program_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// A copy of an InstancedShapes uploaded for drawing, with instances grouped
+// by shape so that each shape takes a single draw call.
+class ShapeBuffers final {
+public:
+   ShapeBuffers() = default;
+   ~ShapeBuffers();
+   ShapeBuffers(ShapeBuffers&& other) noexcept;
+   ShapeBuffers& operator=(ShapeBuffers&& other) noexcept;
+
+   // Brings the copy up to date with shapes if either has changed since the
+   // last update.  If instance_ends says where each board item's instances
+   // end (as in CachedMesh) and is the same size as hidden_items, the
+   // instances of hidden items are left out; hidden_version must change
+   // whenever hidden_items does.
+   void update(const ShapeRenderer& renderer, const InstancedShapes& shapes,
+               const std::vector<be::U32>& instance_ends, const std::vector<bool>& hidden_items, be::U32 hidden_version);
+
+   // Draws in the current color.
+   void draw(const ShapeRenderer& renderer, bool wireframe) const;
+
+   // The instances' triangles, when the renderer can't draw instances.
+   const IndexedMesh& expanded() const noexcept {
+      return expanded_;
+   }
+
+private:
+   struct Batch {
+      be::U32 first_index;
+      be::U32 indices;
+      be::U32 first_instance;
+      be::U32 instances;
+   };
+
+   void release_() noexcept;
+
+   be::U32 shape_buffer_ = 0;
+   be::U32 index_buffer_ = 0;
+   be::U32 instance_buffer_ = 0;
+   std::vector<Batch> batches_;
+   IndexedMesh expanded_;
+   be::U64 revision_ = 0;
+   be::U32 hidden_version_ = 0;
+};
+
+#endif
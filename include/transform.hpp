@@ -0,0 +1,34 @@
+#pragma once
+#ifndef KIVIEW_TRANSFORM_HPP_
+#define KIVIEW_TRANSFORM_HPP_
+
+#include <be/core/be.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/vec2.hpp>
+#include <cmath>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////
+inline glm::mat3 translation(const glm::vec2& v) {
+   return glm::mat3(1.f, 0.f, 0.f, 0.f, 1.f, 0.f, v.x, v.y, 1.f);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+inline glm::mat3 rotation(be::F32 radians) {
+   be::F32 s = std::sin(radians);
+   be::F32 c = std::cos(radians);
+   return glm::mat3(c, s, 0.f, -s, c, 0.f, 0.f, 0.f, 1.f);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+inline glm::mat3 scaling(const glm::vec2& v) {
+   return glm::mat3(v.x, 0.f, 0.f, 0.f, v.y, 0.f, 0.f, 0.f, 1.f);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Applies transform, which must be affine, to the vertices from first
+// onwards in place.  Uses AVX or SSE2 when available, else scalar math; all
+// give the same result as transform * glm::vec3(v, 1.f).
+void transform_vertices(const glm::mat3& transform, std::vector<glm::vec2>& vertices, std::size_t first);
+
+#endif
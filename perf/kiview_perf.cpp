@@ -0,0 +1,75 @@
+#include "perf.hpp"
+#include "mapped_file.hpp"
+#include "parse_parallel.hpp"
+#include "pcb_helper.hpp"
+#include <be/util/string_interner.hpp>
+#include <iostream>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+BoardModel::Bounds get_area(const Node& pcb) {
+   BoardModel::Bounds bounds;
+   Node::const_iterator it = find(pcb, "general"sv);
+   if (it != pcb.end()) {
+      Node::const_iterator area_it = find(*it, "area"sv);
+      if (area_it != it->end() && area_it->size() >= 5) {
+         const Node& area = *area_it;
+         bounds.add(glm::vec2((be::F32)area[1].value(), (be::F32)area[2].value()));
+         bounds.add(glm::vec2((be::F32)area[3].value(), (be::F32)area[4].value()));
+      }
+   }
+   return bounds;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+// Usage: kiview-perf <board.kicad_pcb>...
+// Runs every benchmark against each board and writes the results to stdout.
+int main(int argc, char** argv) {
+   using Benchmark = void(*)(const PerfBoard&, std::ostream&);
+   const Benchmark benchmarks[] = {
+      perf_node_types,
+      perf_select
+   };
+
+   if (argc < 2) {
+      std::cerr << "Usage: kiview-perf <board.kicad_pcb>..." << std::endl;
+      return 1;
+   }
+
+   int result = 0;
+   for (int a = 1; a < argc; ++a) {
+      PerfBoard board;
+      board.path = argv[a];
+      try {
+         be::util::StringInterner si;
+         MappedFile file(board.path);
+         NodeTree tree = parse_parallel(file.text(), si, true, classify_node);
+         Node::const_iterator it = find(tree.root(), "kicad_pcb"sv);
+         if (it == tree.root().end()) {
+            std::cerr << board.path << ": not a board file" << std::endl;
+            result = 1;
+            continue;
+         }
+
+         board.pcb = &*it;
+         board.area = get_area(*board.pcb);
+         board.model = build_board_model(*board.pcb);
+
+         std::cout << board.path << ":\n";
+         for (Benchmark benchmark : benchmarks) {
+            benchmark(board, std::cout);
+         }
+         std::cout << std::endl;
+      } catch (const std::exception& e) {
+         std::cerr << board.path << ": " << e.what() << std::endl;
+         result = 1;
+      }
+   }
+
+   return result;
+}
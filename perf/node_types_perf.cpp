@@ -0,0 +1,51 @@
+#include "perf.hpp"
+#include "pcb_helper.hpp"
+#include <chrono>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename F>
+std::size_t visit_sexprs(const Node& node, F&& func) {
+   std::size_t count = 1;
+   func(node);
+   for (const Node& child : node) {
+      if (child.type() == Node::node_type::sexpr) {
+         count += visit_sexprs(child, func);
+      }
+   }
+   return count;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+void perf_node_types(const PerfBoard& board, std::ostream& os) {
+   using clock = std::chrono::steady_clock;
+   using ms = std::chrono::duration<be::F64, std::milli>;
+   const Node& root = *board.pcb;
+   auto& parser = node_type_parser();
+   std::size_t parsed_hits = 0;
+   std::size_t cached_hits = 0;
+
+   auto t0 = clock::now();
+   std::size_t sexprs = visit_sexprs(root, [&](const Node& node) {
+      if (!node.empty() && parser.parse(node[0].text()) != node_type::ignored) {
+         ++parsed_hits;
+      }
+   });
+   auto t1 = clock::now();
+   visit_sexprs(root, [&](const Node& node) {
+      if (get_node_type(node) != node_type::ignored) {
+         ++cached_hits;
+      }
+   });
+   auto t2 = clock::now();
+
+   os << "  node types: " << sexprs << " sexprs: keyword lookup " << ms(t1 - t0).count()
+      << " ms, cached " << ms(t2 - t1).count() << " ms";
+   if (parsed_hits != cached_hits) {
+      os << " (MISMATCH: " << parsed_hits << " vs " << cached_hits << ")";
+   }
+   os << '\n';
+}
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef KIVIEW_PERF_HPP_
+#define KIVIEW_PERF_HPP_
+
+#include "node.hpp"
+#include "board_model.hpp"
+#include <ostream>
+
+///////////////////////////////////////////////////////////////////////////////
+// A board file as loaded by kiview-perf, shared by each benchmark.
+struct PerfBoard {
+   be::S path;
+   const Node* pcb = nullptr;
+   BoardModel::Bounds area; // from the board's general section
+   BoardModel model;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Compares looking up each sexpr's keyword with the cached classification.
+void perf_node_types(const PerfBoard& board, std::ostream& os);
+
+///////////////////////////////////////////////////////////////////////////////
+// Times picking at random points in the board's area, with and without a
+// PickGrid, for growing prefixes of the board's items.
+void perf_select(const PerfBoard& board, std::ostream& os);
+
+#endif
@@ -0,0 +1,78 @@
+#include "perf.hpp"
+#include "pick_grid.hpp"
+#include <chrono>
+#include <random>
+#include <tuple>
+
+///////////////////////////////////////////////////////////////////////////////
+void perf_select(const PerfBoard& board, std::ostream& os) {
+   using clock = std::chrono::steady_clock;
+   using us = std::chrono::duration<be::F64, std::micro>;
+   constexpr std::size_t n_points = 1000;
+   const BoardModel& model = board.model;
+
+   if (!(board.area.lo.x <= board.area.hi.x)) {
+      os << "  select: board has no area\n";
+      return;
+   }
+
+   std::mt19937 rng(1);
+   std::uniform_real_distribution<be::F32> unit;
+   std::vector<glm::vec2> points(n_points);
+   glm::vec2 dim = board.area.hi - board.area.lo;
+   for (glm::vec2& p : points) {
+      p = board.area.lo + dim * glm::vec2(unit(rng), unit(rng));
+   }
+
+   // roughly the selection radius when the whole board fits the window
+   be::F32 radius = std::max(dim.x, dim.y) / 50.f;
+   std::set<be::U32> no_nets;
+   std::size_t mismatches = 0;
+
+   auto pick = [&](const PickGrid* grid, glm::vec2 pos, face_type side, be::U32 limit) {
+      be::F32 distance = radius;
+      const Node* module = find_closest_module(model, grid, pos, distance, side, limit);
+      be::U32 net = find_closest_copper(model, grid, pos, distance, side, no_nets, true, limit);
+      return std::make_tuple(module, net, distance);
+   };
+
+   os << "  select (" << n_points << " points, both faces):\n";
+
+   std::size_t n_items = model.size();
+   std::size_t last = 0;
+   for (std::size_t div : { 8, 4, 2, 1 }) {
+      std::size_t limit = n_items / div;
+      if (limit == last) {
+         continue;
+      }
+      last = limit;
+
+      auto t0 = clock::now();
+      PickGrid grid(model, (be::U32)limit);
+      auto t1 = clock::now();
+      be::F64 linear_time = 0;
+      be::F64 grid_time = 0;
+      for (glm::vec2 pos : points) {
+         for (face_type side : { face_type::f_front, face_type::f_back }) {
+            auto t2 = clock::now();
+            auto expected = pick(nullptr, pos, side, (be::U32)limit);
+            auto t3 = clock::now();
+            auto actual = pick(&grid, pos, side, (be::U32)limit);
+            auto t4 = clock::now();
+            linear_time += us(t3 - t2).count();
+            grid_time += us(t4 - t3).count();
+            if (expected != actual) {
+               ++mismatches;
+            }
+         }
+      }
+
+      os << "    " << limit << " items: scan " << linear_time / (2 * n_points) << " us, grid "
+         << grid_time / (2 * n_points) << " us (" << grid.cells() << " cells, built in "
+         << us(t1 - t0).count() / 1000 << " ms)\n";
+   }
+
+   if (mismatches > 0) {
+      os << "    MISMATCHES: " << mismatches << '\n';
+   }
+}
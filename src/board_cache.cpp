@@ -0,0 +1,201 @@
+#include "board_cache.hpp"
+#include "hash_text.hpp"
+#include "pcb_helper.hpp"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+namespace {
+
+constexpr char cache_magic[8] = { 'K', 'V', 'C', 'A', 'C', 'H', 'E', '\0' };
+
+struct Header {
+   char magic[8];
+   be::U32 version;
+   be::U32 node_size;
+   be::F64 one; // catches byte order or floating point format mismatches
+   be::U64 source_size;
+   be::I64 source_mtime;
+   be::U64 source_hash;
+   be::U64 node_count;
+   be::U64 text_size;
+};
+
+static_assert(sizeof(Header) % alignof(Node) == 0, "Nodes must be aligned when the cache is mapped");
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+BoardCache::Key BoardCache::key(const be::S& source_path, be::SV source) {
+   Key key;
+   key.size = source.size();
+   key.mtime = (be::I64)std::filesystem::last_write_time(source_path).time_since_epoch().count();
+   key.hash = hash_text(source);
+   return key;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::S BoardCache::path(const be::S& source_path) {
+   return source_path + ".kvcache";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BoardCache::write(const be::S& source_path, const Key& key, const NodeTree& tree) {
+   if (!tree.deferred_.empty()) {
+      throw std::invalid_argument("Trees containing deferred subtrees can't be cached");
+   }
+
+   const std::size_t count = tree.size_;
+   const std::size_t text_begin = sizeof(Header) + count * sizeof(Node);
+
+   // each distinct string is stored once, after the arena
+   std::vector<Node> nodes(tree.data_, tree.data_ + count);
+   std::unordered_map<be::SV, std::size_t> offsets;
+   be::S text;
+   for (std::size_t i = 0; i < count; ++i) {
+      Node& node = nodes[i];
+      if (node.type_ == Node::node_type::text) {
+         be::SV str = tree.data_[i].text();
+         auto result = offsets.emplace(str, text.size());
+         if (result.second) {
+            text.append(str);
+         }
+         std::ptrdiff_t node_pos = (std::ptrdiff_t)(sizeof(Header) + i * sizeof(Node));
+         node.offset_ = (std::ptrdiff_t)(text_begin + result.first->second) - node_pos;
+      }
+   }
+
+   Header header;
+   std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+   header.version = version;
+   header.node_size = (be::U32)sizeof(Node);
+   header.one = 1.0;
+   header.source_size = key.size;
+   header.source_mtime = key.mtime;
+   header.source_hash = key.hash;
+   header.node_count = count;
+   header.text_size = text.size();
+
+   be::S final_path = path(source_path);
+   be::S temp_path = final_path + ".tmp";
+   {
+      std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+      ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      ofs.write(reinterpret_cast<const char*>(nodes.data()), (std::streamsize)(count * sizeof(Node)));
+      ofs.write(text.data(), (std::streamsize)text.size());
+      ofs.close();
+      if (!ofs) {
+         std::error_code ec;
+         std::filesystem::remove(temp_path, ec);
+         throw std::system_error(std::make_error_code(std::errc::io_error), "Could not write " + temp_path);
+      }
+   }
+   std::filesystem::rename(temp_path, final_path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool BoardCache::open(const be::S& source_path, const Key& key) {
+   file_ = MappedFile();
+   node_count_ = 0;
+
+   be::S cache_path = path(source_path);
+   std::error_code ec;
+   if (!std::filesystem::is_regular_file(cache_path, ec)) {
+      return false;
+   }
+
+   MappedFile file;
+   try {
+      file = MappedFile(cache_path, true);
+   } catch (const std::system_error&) {
+      return false;
+   }
+
+   if (file.size() < sizeof(Header)) {
+      return false;
+   }
+
+   Header header;
+   std::memcpy(&header, file.data(), sizeof(header));
+   if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+       header.version != version ||
+       header.node_size != sizeof(Node) ||
+       header.one != 1.0 ||
+       header.source_size != key.size ||
+       header.source_mtime != key.mtime ||
+       header.source_hash != key.hash ||
+       header.node_count == 0 ||
+       header.node_count > (file.size() - sizeof(Header)) / sizeof(Node) ||
+       header.text_size != file.size() - sizeof(Header) - header.node_count * sizeof(Node) ||
+       !valid_(file.data(), (std::size_t)header.node_count, (std::size_t)header.text_size)) {
+      return false;
+   }
+
+   file_ = std::move(file);
+   node_count_ = (std::size_t)header.node_count;
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A cache that matches its key can still be damaged, so each node is checked
+// before the arena is used as a tree: text must lie within the text section,
+// and children within the arena, before their sexpr as parse() leaves them,
+// so that walking the tree always terminates.  The bytes are read through
+// memcpy, since a bad type or lazy byte isn't a valid enum or bool.
+bool BoardCache::valid_(const char* data, std::size_t node_count, std::size_t text_size) noexcept {
+   const std::ptrdiff_t text_begin = (std::ptrdiff_t)(sizeof(Header) + node_count * sizeof(Node));
+   const std::ptrdiff_t text_end = text_begin + (std::ptrdiff_t)text_size;
+
+   be::U8 type = 0;
+   for (std::size_t i = 0; i < node_count; ++i) {
+      const std::ptrdiff_t pos = (std::ptrdiff_t)(sizeof(Header) + i * sizeof(Node));
+      const char* node = data + pos;
+      std::ptrdiff_t offset;
+      be::U32 size;
+      be::U8 keyword;
+      be::U8 lazy;
+      std::memcpy(&offset, node + offsetof(Node, offset_), sizeof(offset));
+      std::memcpy(&size, node + offsetof(Node, size_), sizeof(size));
+      std::memcpy(&type, node + offsetof(Node, type_), sizeof(type));
+      std::memcpy(&keyword, node + offsetof(Node, keyword_), sizeof(keyword));
+      std::memcpy(&lazy, node + offsetof(Node, lazy_), sizeof(lazy));
+
+      if (lazy != 0) {
+         return false;
+      }
+
+      switch ((Node::node_type)type) {
+         case Node::node_type::sexpr:
+            if (keyword > (be::U8)node_type::n_dimension || offset > 0 || (std::size_t)-offset > i || size > i - (std::size_t)(i + offset)) {
+               return false;
+            }
+            break;
+         case Node::node_type::text:
+            if (keyword != 0 || offset < text_begin - pos || offset > text_end - pos || size > text_end - (pos + offset)) {
+               return false;
+            }
+            break;
+         case Node::node_type::value:
+            if (keyword != 0) {
+               return false;
+            }
+            break;
+         default:
+            return false;
+      }
+   }
+
+   return type == (be::U8)Node::node_type::sexpr; // the root
+}
+
+///////////////////////////////////////////////////////////////////////////////
+NodeTree BoardCache::tree() {
+   if (node_count_ == 0) {
+      return NodeTree();
+   }
+   return NodeTree::view(reinterpret_cast<Node*>(file_.data() + sizeof(Header)), node_count_);
+}
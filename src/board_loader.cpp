@@ -0,0 +1,638 @@
+#include "board_loader.hpp"
+#include "parse_parallel.hpp"
+#include "hash_text.hpp"
+#include "sexpr_scan.hpp"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+be::rect get_area(const Node& pcb) {
+   Node::const_iterator it = find(pcb, "general");
+   if (it != pcb.end()) {
+      Node::const_iterator area_it = find(*it, "area");
+      if (area_it != it->end()) {
+         const Node& area = *area_it;
+         if (area.size() >= 5) {
+            be::rect r;
+            r.offset.x = (be::F32)area[1].value();
+            r.offset.y = (be::F32)area[2].value();
+            glm::vec2 b((be::F32)area[3].value(), (be::F32)area[4].value());
+            return r.union_bounds(be::rect { b, glm::vec2() });
+         }
+      }
+   }
+   return be::rect();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct BoardScan {
+   std::vector<be::U64> item_hashes;
+   be::S outline; // a board holding just the items scan_board() picked out
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// True for a board item which might be part of the outline: the general
+// section, which holds the board's area, and any graphics on Edge.Cuts.
+bool outline_item(be::SV item) {
+   be::SV keyword = item.substr(1, item.find_first_of(" \t\r\n()\"", 1) - 1);
+   return keyword == "general"sv || (keyword.substr(0, 3) == "gr_"sv && item.find("Edge.Cuts"sv) != be::SV::npos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Hashes the text of each sexpr inside the board's top-level sexpr, in
+// order, and collects those which make up the outline into a board of their
+// own, which parses far faster than the whole board does.
+BoardScan scan_board(be::SV text) {
+   BoardScan scan;
+   scan.outline = "(kicad_pcb";
+   std::size_t open = 0;
+   scan_sexpr(text, [&](sexpr_event event, std::size_t pos, std::size_t depth) {
+      if (depth == 1) {
+         if (event == sexpr_event::open) {
+            open = pos;
+         } else if (event == sexpr_event::close) {
+            be::SV item = text.substr(open, pos + 1 - open);
+            scan.item_hashes.push_back(hash_text(item));
+            if (outline_item(item)) {
+               scan.outline.push_back(' ');
+               scan.outline.append(item);
+            }
+         }
+      }
+      return true;
+   });
+   scan.outline.push_back(')');
+   return scan;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The path from the root to the node whose children are the board's items.
+std::vector<const Node*> board_path(const NodeTree& tree) {
+   std::vector<const Node*> path { &tree.root() };
+   Node::const_iterator it = find(tree.root(), "kicad_pcb"sv);
+   if (it != tree.root().end()) {
+      path.push_back(&*it);
+   }
+   return path;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Matches the hashes from scan_board() to the board's items.  Returns an
+// empty vector if the text doesn't match the tree's shape; reloads will then
+// start from scratch.
+std::vector<be::U64> hash_items(const std::vector<be::U64>& sexpr_hashes, const NodeTree& tree) {
+   std::vector<const Node*> parents = board_path(tree);
+   std::vector<be::U64> hashes;
+
+   std::size_t next = 0;
+   for (const Node& item : *parents.back()) {
+      if (item.type() != Node::node_type::sexpr) {
+         hashes.push_back(0); // atoms are never rendered
+      } else if (next < sexpr_hashes.size()) {
+         hashes.push_back(sexpr_hashes[next++]);
+      } else {
+         break;
+      }
+   }
+
+   if (parents.size() != 2 || next != sexpr_hashes.size() || hashes.size() != parents.back()->size()) {
+      hashes.clear();
+   }
+   return hashes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// True if at least half of the sexprs hashed by scan_board() are identical to
+// items of the previous board.
+bool mostly_unchanged(const std::vector<be::U64>& previous, const std::vector<be::U64>& sexpr_hashes) {
+   std::unordered_map<be::U64, std::size_t> counts;
+   for (be::U64 hash : previous) {
+      ++counts[hash];
+   }
+
+   std::size_t unchanged = 0;
+   for (be::U64 hash : sexpr_hashes) {
+      auto it = counts.find(hash);
+      if (it != counts.end() && it->second > 0) {
+         --it->second;
+         ++unchanged;
+      }
+   }
+   return unchanged * 2 >= sexpr_hashes.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LazyPredicate for reloads which copy most items from the previous board's
+// model.  Modules and zones make up most of a board's text, so they're only
+// parsed if build_board_model() has to read them.
+bool defer_reloaded_node(be::U8 keyword) {
+   return defer_node(keyword) || keyword == (be::U8)node_type::n_module || keyword == (be::U8)node_type::n_zone;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pairs each board item with an identical item of the previous board, in
+// order when there are several; none for changed items.
+std::vector<be::U32> match_items(const std::vector<be::U64>& previous, const std::vector<be::U64>& hashes) {
+   std::unordered_map<be::U64, std::vector<be::U32>> unmatched;
+   for (std::size_t i = previous.size(); i-- > 0; ) {
+      unmatched[previous[i]].push_back((be::U32)i);
+   }
+
+   std::vector<be::U32> reused(hashes.size(), BoardModel::none);
+   for (std::size_t j = 0, n = hashes.size(); j < n; ++j) {
+      auto it = unmatched.find(hashes[j]);
+      if (it != unmatched.end() && !it->second.empty()) {
+         reused[j] = it->second.back();
+         it->second.pop_back();
+      }
+   }
+   return reused;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fills in everything but the pick grid, once board.file has been mapped and
+// scanned.  When reloading, unchanged items are copied from the previous
+// board's model, and if most are unchanged, their modules and zones are
+// never parsed.
+void parse_board(Board& board, const be::S& filename, bool use_cache,
+                 const std::vector<be::U64>& sexpr_hashes, const PreviousBoard* previous) {
+   board.si = std::make_unique<be::util::StringInterner>();
+   board.si->provisioning_policy([](std::size_t s) { return std::min(s * 2, (std::size_t)0x1000000) + 0x10000; });
+
+   if (use_cache) {
+      BoardCache::Key key = BoardCache::key(filename, board.file.text());
+      if (board.cache.open(filename, key)) {
+         board.tree = board.cache.tree();
+      } else {
+         // the cache can't hold deferred subtrees, so parse everything now
+         board.tree = parse_parallel(board.file.text(), *board.si, true, classify_node);
+         try {
+            BoardCache::write(filename, key, board.tree);
+         } catch (const std::exception& e) {
+            board.cache_error = e.what(); // logged on the main thread, once the board is installed
+         }
+      }
+   } else {
+      bool reuse = previous && mostly_unchanged(previous->item_hashes, sexpr_hashes);
+      board.tree = parse_parallel(board.file.text(), *board.si, true, classify_node, reuse ? defer_reloaded_node : defer_node);
+   }
+
+   Node::const_iterator iter = find(board.tree.root(), "kicad_pcb"sv);
+
+   board.title = filename;
+
+   if (iter != board.tree.root().end()) {
+      const Node& pcb = *iter;
+      Node::const_iterator title_block_it = find(pcb, "title_block"sv);
+      if (title_block_it != pcb.end()) {
+         Node::const_iterator title_it = find(*title_block_it, "title"sv);
+         if (title_it != title_block_it->end()) {
+            const Node& title = *title_it;
+            if (title.size() >= 2) {
+               board.title = title[1].text();
+            }
+         }
+      }
+
+      board.bounds = get_area(pcb);
+   }
+
+   board.item_hashes = hash_items(sexpr_hashes, board.tree);
+   const Node& items = *board_path(board.tree).back();
+   if (previous && !board.item_hashes.empty()) {
+      board.reused = match_items(previous->item_hashes, board.item_hashes);
+      board.model = std::make_shared<BoardModel>(build_board_model(items, *previous->model, board.reused));
+   } else {
+      board.model = std::make_shared<BoardModel>(build_board_model(items));
+   }
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::size_t> carry_items(const std::vector<be::U32>& reused, std::size_t n_previous) {
+   constexpr std::size_t none = ~(std::size_t)0;
+   std::vector<std::size_t> carried(n_previous, none);
+   for (std::size_t j = 0, n = reused.size(); j < n; ++j) {
+      if (reused[j] != BoardModel::none) {
+         carried[reused[j]] = j;
+      }
+   }
+
+   std::size_t next_new = 0;
+   for (std::size_t& item : carried) {
+      if (item == none) {
+         while (next_new < reused.size() && reused[next_new] != BoardModel::none) {
+            ++next_new;
+         }
+         if (next_new < reused.size()) {
+            item = next_new++;
+         }
+      }
+   }
+   return carried;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::size_t> module_items(const std::set<const Node*>& modules, const NodeTree& tree) {
+   const Node* items = board_path(tree).back()->begin();
+   std::vector<std::size_t> indices;
+   for (const Node* mod : modules) {
+      indices.push_back((std::size_t)(mod - items));
+   }
+   return indices;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::set<const Node*> carry_modules(const std::vector<std::size_t>& previous_items, const std::vector<std::size_t>& carried, const NodeTree& tree) {
+   constexpr std::size_t none = ~(std::size_t)0;
+   const Node* items = board_path(tree).back()->begin();
+   std::set<const Node*> modules;
+   for (std::size_t i : previous_items) {
+      if (i < carried.size() && carried[i] != none && get_node_type(items[carried[i]]) == node_type::n_module) {
+         modules.insert(items + carried[i]);
+      }
+   }
+   return modules;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::set<be::U32> remap_nets(const std::set<be::U32>& nets, const BoardModel& previous, const BoardModel& model) {
+   const BoardModel::Nets& old_nets = previous.nets;
+   const BoardModel::Nets& new_nets = model.nets;
+   std::map<be::S, be::U32> nets_by_name;
+   std::map<be::U32, be::U32> nets_by_number;
+   for (be::U32 id = 0, n = (be::U32)new_nets.name.size(); id < n; ++id) {
+      if (new_nets.name[id].empty()) {
+         nets_by_number.emplace(new_nets.number[id], id);
+      } else {
+         nets_by_name.emplace(new_nets.name[id], id);
+      }
+   }
+
+   std::set<be::U32> remapped;
+   for (be::U32 net : nets) {
+      if (net >= old_nets.name.size()) {
+         continue;
+      }
+      if (old_nets.name[net].empty()) {
+         auto it = nets_by_number.find(old_nets.number[net]);
+         if (it != nets_by_number.end()) {
+            remapped.insert(it->second);
+         }
+      } else {
+         auto it = nets_by_name.find(old_nets.name[net]);
+         if (it != nets_by_name.end()) {
+            remapped.insert(it->second);
+         }
+      }
+   }
+   return remapped;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+Board& Board::operator=(Board&& other) {
+   tree = NodeTree(); // release the old tree before the text it refers to
+   si = std::move(other.si);
+   file = std::move(other.file);
+   cache = std::move(other.cache);
+   tree = std::move(other.tree);
+   model = std::move(other.model);
+   pick_grid = std::move(other.pick_grid);
+   title = std::move(other.title);
+   cache_error = std::move(other.cache_error);
+   bounds = other.bounds;
+   item_hashes = std::move(other.item_hashes);
+   reused = std::move(other.reused);
+   return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardLoader::BoardLoader(be::S filename, bool use_cache, View view, std::unique_ptr<PreviousBoard> previous,
+                         std::function<void()> notify)
+   : filename_(std::move(filename)),
+     use_cache_(use_cache),
+     view_(std::move(view)),
+     previous_(std::move(previous)),
+     notify_(std::move(notify)),
+     start_(std::chrono::steady_clock::now()) {
+   delivery_.status = (previous_ ? "Reloading " : "Loading ") + filename_;
+   thread_ = std::thread(&BoardLoader::run_, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardLoader::~BoardLoader() {
+   cancel_ = true;
+   if (thread_.joinable()) {
+      thread_.join();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The status and error stay, so each poll() sees the latest.
+BoardLoader::Delivery BoardLoader::poll() {
+   Delivery delivery;
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery.view_ready = delivery_.view_ready;
+      delivery_.view_ready = false;
+      delivery.bounds = delivery_.bounds;
+      delivery.lod_error = delivery_.lod_error;
+      delivery.mesh_region = delivery_.mesh_region;
+      delivery.board = std::move(delivery_.board);
+      delivery.pick_grid = std::move(delivery_.pick_grid);
+      delivery.meshes.swap(delivery_.meshes);
+      delivery.error = delivery_.error;
+      delivery.status = delivery_.status;
+      delivery.done = delivery_.done;
+   }
+
+   if (delivery.board && previous_) {
+      const std::vector<be::U32>& reused = delivery.board->reused;
+      changed_items_ = reused.empty() ? delivery.board->model->size() : (std::size_t)std::count(reused.begin(), reused.end(), BoardModel::none);
+   }
+   return delivery;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BoardLoader::run_() {
+   try {
+      if (previous_) {
+         reload_();
+      } else {
+         load_();
+      }
+   } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery_.error = std::current_exception();
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery_.done = true;
+   }
+   notify_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BoardLoader::set_status_(be::S status) {
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery_.status = std::move(status);
+   }
+   notify_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds the given meshes for items [begin, end) and hands them over.
+// Returns false if cancelled.
+bool BoardLoader::build_(const BoardModel& model, std::initializer_list<layer_mesh> types, bool back, const MeshSettings& settings,
+                         std::size_t begin, std::size_t end, bool replace, bool last) {
+   std::vector<Mesh> meshes;
+   meshes.reserve(types.size());
+   for (layer_mesh type : types) {
+      bool mesh_back = back && type != layer_mesh::holes && type != layer_mesh::edge_cuts;
+      be::U32 generation = view_.generations[(std::size_t)type][mesh_back ? 1 : 0];
+      meshes.push_back(Mesh { type, mesh_back, generation, CachedMesh(), replace, last });
+   }
+
+   std::vector<MeshTarget> targets;
+   for (Mesh& mesh : meshes) {
+      targets.push_back(MeshTarget { mesh.type, mesh.back, &mesh.mesh });
+   }
+
+   build_meshes(model, targets, settings, &cancel_, true, begin, end);
+   if (cancel_) {
+      return false;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (Mesh& mesh : meshes) {
+         delivery_.meshes.push_back(std::move(mesh));
+      }
+   }
+   notify_();
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Streams the given meshes for the whole board, a chunk of items at a time.
+bool BoardLoader::stream_(const BoardModel& model, std::initializer_list<layer_mesh> types, bool back, const MeshSettings& settings) {
+   constexpr std::size_t min_chunk_items = 0x1000;
+   constexpr std::size_t chunks_per_pass = 8;
+
+   std::size_t n_items = model.size();
+   std::size_t chunk_items = std::max(min_chunk_items, n_items / chunks_per_pass + 1);
+   std::size_t begin = 0;
+   do {
+      std::size_t end = std::min(n_items, begin + chunk_items);
+      if (!build_(model, types, back, settings, begin, end, false, end == n_items)) {
+         return false;
+      }
+      begin = end;
+   } while (begin < n_items);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The outline is read before anything else, so the view can be set up and
+// the board's shape shown while the rest is parsed.  Once the board is
+// handed over, its meshes are streamed a chunk of items at a time: the
+// outline, then copper, then pads and silk.  The pick grid comes last.
+void BoardLoader::load_() {
+   set_status_("Reading " + filename_);
+   auto board = std::make_unique<Board>();
+   board->file = MappedFile(filename_);
+   BoardScan scan = scan_board(board->file.text());
+
+   be::util::StringInterner outline_si;
+   NodeTree outline_tree = parse(scan.outline, outline_si, true, classify_node);
+   const Node& outline_pcb = *board_path(outline_tree).back();
+   BoardModel outline = build_board_model(outline_pcb);
+   be::rect bounds = get_area(outline_pcb);
+
+   // built for the view the app will set up once the bounds are handed over
+   be::F32 scale = view_.scale > 0 ? view_.scale : fit_scale(view_.viewport, bounds);
+   glm::vec2 center = view_.autocenter ? bounds.center() : view_.center;
+   SegmentDensities densities = segment_densities();
+   densities.max_error = lod_max_error(view_.lod_pixels, scale);
+   BoardModel::Bounds region = mesh_region(view_bounds(center, scale, view_.viewport), bounds);
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery_.view_ready = true;
+      delivery_.bounds = bounds;
+      delivery_.lod_error = densities.max_error;
+      delivery_.mesh_region = region;
+   }
+
+   // shown until the board's own outline replaces it
+   MeshSettings settings { view_.skip_zones, &view_.highlight_nets, &view_.highlight_modules, densities, region };
+   if (!build_(outline, { layer_mesh::edge_cuts }, false, settings, 0, BoardModel::none, true, false)) {
+      return;
+   }
+
+   set_status_("Parsing " + filename_);
+   parse_board(*board, filename_, use_cache_, scan.item_hashes, nullptr);
+   std::shared_ptr<const BoardModel> model = board->model; // its nodes stay put when the board is installed
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery_.board = std::move(board);
+   }
+
+   set_status_("Tessellating");
+   if (!build_(*model, { layer_mesh::edge_cuts }, false, settings, 0, BoardModel::none, true, true)) {
+      return;
+   }
+
+   // the visible face first, along with the holes, then the far face; on
+   // each, copper is completed before pads and silk, each group in one
+   // pass over the board
+   for (bool far_side : { false, true }) {
+      bool back = view_.back != far_side;
+      if (far_side) {
+         set_status_("Tessellating far side");
+      }
+
+      if (!stream_(*model, { layer_mesh::copper }, back, settings)
+          || !build_(*model, { layer_mesh::highlighted_copper }, back, settings, 0, BoardModel::none, true, true)) {
+         return;
+      }
+
+      bool pads_done = far_side
+         ? stream_(*model, { layer_mesh::pads, layer_mesh::highlighted_pads, layer_mesh::silk }, back, settings)
+         : stream_(*model, { layer_mesh::pads, layer_mesh::highlighted_pads, layer_mesh::holes, layer_mesh::silk }, back, settings);
+      if (!pads_done) {
+         return;
+      }
+   }
+
+   set_status_("Indexing");
+   auto pick_grid = std::make_unique<PickGrid>(*model);
+   std::lock_guard<std::mutex> lock(mutex_);
+   delivery_.pick_grid = std::move(pick_grid);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reloads skip the outline, and tessellate only the changed items.  The
+// board is handed over along with patches for the meshes which were valid,
+// built with the selection the app will carry over.
+void BoardLoader::reload_() {
+   const PreviousBoard& previous = *previous_;
+   set_status_("Reading " + filename_);
+   auto board = std::make_unique<Board>();
+   board->file = MappedFile(filename_);
+   BoardScan scan = scan_board(board->file.text());
+
+   set_status_("Parsing " + filename_);
+   parse_board(*board, filename_, use_cache_, scan.item_hashes, &previous);
+   std::shared_ptr<const BoardModel> model = board->model;
+
+   std::vector<bool> changed(model->size(), true);
+   for (std::size_t j = 0, n = board->reused.size(); j < n; ++j) {
+      changed[j] = board->reused[j] == BoardModel::none;
+   }
+
+   std::vector<std::size_t> carried = carry_items(board->reused, previous.item_hashes.size());
+   view_.highlight_nets = remap_nets(view_.highlight_nets, *previous.model, *model);
+   view_.highlight_modules = carry_modules(previous.highlight_items, carried, board->tree);
+
+   set_status_("Tessellating");
+   std::vector<Mesh> patches;
+   for (std::size_t t = 0; t < (std::size_t)layer_mesh::count; ++t) {
+      for (std::size_t f = 0; f < 2; ++f) {
+         if (previous.patchable[t][f]) {
+            patches.push_back(Mesh { (layer_mesh)t, f != 0, view_.generations[t][f], CachedMesh(), true, true, true });
+         }
+      }
+   }
+
+   std::vector<MeshTarget> targets;
+   for (Mesh& patch : patches) {
+      targets.push_back(MeshTarget { patch.type, patch.back, &patch.mesh });
+   }
+
+   MeshSettings settings { view_.skip_zones, &view_.highlight_nets, &view_.highlight_modules, view_.densities, view_.region, &changed };
+   build_meshes(*model, targets, settings, &cancel_);
+   if (cancel_) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      delivery_.board = std::move(board);
+      for (Mesh& patch : patches) {
+         delivery_.meshes.push_back(std::move(patch));
+      }
+   }
+   notify_();
+
+   set_status_("Indexing");
+   auto pick_grid = std::make_unique<PickGrid>(*model);
+   std::lock_guard<std::mutex> lock(mutex_);
+   delivery_.pick_grid = std::move(pick_grid);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Chunks are appended to what has been delivered so far.
+bool install_mesh(CachedMesh& mesh, BoardLoader::Mesh& delivered, const std::vector<be::U32>& reused, std::size_t n_previous) {
+   if (delivered.patch) {
+      const CachedMesh& patch = delivered.mesh;
+      if (!mesh.valid || mesh.generation != delivered.generation || mesh.item_ends.size() != n_previous
+          || patch.item_ends.size() != reused.size()) {
+         return false;
+      }
+
+      CachedMesh spliced;
+      spliced.item_ends.reserve(reused.size());
+      spliced.instance_ends.reserve(reused.size());
+      for (std::size_t j = 0, n = reused.size(); j < n; ++j) {
+         const CachedMesh& from = reused[j] == BoardModel::none ? patch : mesh;
+         std::size_t i = reused[j] == BoardModel::none ? j : reused[j];
+         spliced.mesh.append(from.mesh, i > 0 ? from.item_ends[i - 1] : 0, from.item_ends[i]);
+         spliced.shapes.append(from.shapes, i > 0 ? from.instance_ends[i - 1] : 0, from.instance_ends[i]);
+         spliced.item_ends.push_back((be::U32)spliced.mesh.triangles());
+         spliced.instance_ends.push_back((be::U32)spliced.shapes.instances().size());
+      }
+
+      mesh.mesh = std::move(spliced.mesh);
+      mesh.item_ends = std::move(spliced.item_ends);
+      mesh.shapes = std::move(spliced.shapes);
+      mesh.instance_ends = std::move(spliced.instance_ends);
+      mesh.revision = new_mesh_revision();
+      return true;
+   }
+
+   if (mesh.valid || mesh.generation != delivered.generation) {
+      return false;
+   }
+
+   CachedMesh& part = delivered.mesh;
+   if (delivered.replace || (mesh.mesh.indices.empty() && mesh.item_ends.empty() && mesh.shapes.shapes() == 0)) {
+      mesh.mesh = std::move(part.mesh);
+      mesh.item_ends = std::move(part.item_ends);
+      mesh.shapes = std::move(part.shapes);
+      mesh.instance_ends = std::move(part.instance_ends);
+   } else {
+      be::U32 tri_base = (be::U32)mesh.mesh.triangles();
+      be::U32 instance_base = (be::U32)mesh.shapes.instances().size();
+      mesh.mesh.append(part.mesh);
+      for (be::U32 end : part.item_ends) {
+         mesh.item_ends.push_back(tri_base + end);
+      }
+      mesh.shapes.append(part.shapes, 0, part.shapes.instances().size());
+      for (be::U32 end : part.instance_ends) {
+         mesh.instance_ends.push_back(instance_base + end);
+      }
+   }
+   mesh.revision = new_mesh_revision();
+   mesh.valid = delivered.last;
+   return true;
+}
@@ -0,0 +1,90 @@
+#include "board_meshes.hpp"
+#include "layer_config.hpp"
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+be::U64 new_mesh_revision() {
+   static std::atomic<be::U64> last { 0 };
+   return ++last;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+RenderItemPredicate mesh_predicate(layer_mesh type, bool back, const MeshSettings& settings) {
+   if (settings.items) {
+      MeshSettings all_items = settings;
+      all_items.items = nullptr;
+      const std::vector<bool>& items = *settings.items;
+      return [pred = mesh_predicate(type, back, all_items), &items](const BoardModel& model, model_item item_type, std::size_t i) {
+         return items[model.item(item_type, i)] && pred(model, item_type, i);
+      };
+   }
+
+   face_type face = back ? face_type::f_back : face_type::f_front;
+   switch (type) {
+      case layer_mesh::copper:             return CopperConfig { face, settings.skip_zones, true }; // pads are covered by the pads mesh
+      case layer_mesh::pads:               return ModuleConfig { face, false, nullptr };
+      case layer_mesh::highlighted_copper: return CopperConfig { face, false, false };
+      case layer_mesh::highlighted_pads:   return ModuleConfig { face, true, settings.highlight_modules };
+      case layer_mesh::silk:               return StandardConfig { face, layer_type::l_silk };
+      case layer_mesh::holes:              return HoleConfig();
+      default:                             return StandardConfig { face_type::any, layer_type::l_cuts };
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void build_meshes(const BoardModel& model, const std::vector<MeshTarget>& targets, const MeshSettings& settings,
+                  const std::atomic<bool>* cancel, bool parallel, std::size_t begin, std::size_t end) {
+   LayerBuckets buckets(settings.densities, settings.region);
+   for (const MeshTarget& target : targets) {
+      CachedMesh& mesh = *target.mesh;
+      mesh.revision = new_mesh_revision();
+      mesh.mesh.clear();
+      mesh.item_ends.clear();
+      mesh.shapes.clear();
+      mesh.instance_ends.clear();
+
+      RenderItemPredicate pred = mesh_predicate(target.type, target.back, settings);
+      if (target.type == layer_mesh::highlighted_copper) {
+         for (be::U32 net : *settings.highlight_nets) {
+            if (net < model.nets.number.size()) {
+               render_layer_net(model, net, pred, mesh.mesh, settings.densities, settings.region);
+            }
+         }
+      } else {
+         buckets.add(std::move(pred), mesh.mesh, &mesh.shapes, &mesh.item_ends, &mesh.instance_ends);
+      }
+   }
+
+   render_layers(model, buckets, begin, end, parallel, cancel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::F32 fit_scale(glm::ivec2 viewport, const be::rect& bounds) {
+   glm::vec2 scale = glm::vec2(viewport - glm::ivec2(0, 66)) * 0.98f / bounds.dim;
+   return std::min(scale.x, scale.y);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::F32 lod_max_error(be::F32 pixels, be::F32 scale) {
+   if (pixels <= 0 || !(scale > 0)) {
+      return 0;
+   }
+   return std::exp2(std::floor(std::log2(pixels / scale)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardModel::Bounds view_bounds(glm::vec2 center, be::F32 scale, glm::ivec2 viewport) {
+   glm::vec2 half = glm::vec2(viewport) / (2.f * scale);
+   return BoardModel::Bounds { center - half, center + half };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardModel::Bounds mesh_region(const BoardModel::Bounds& visible, const be::rect& board) {
+   glm::vec2 margin = visible.hi - visible.lo;
+   BoardModel::Bounds region { visible.lo - margin, visible.hi + margin };
+   if (region.contains(BoardModel::Bounds { board.offset, board.offset + board.dim })) {
+      return BoardModel::Bounds::everything();
+   }
+   return region;
+}
@@ -0,0 +1,824 @@
+#include "board_model.hpp"
+#include "transform.hpp"
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+void read_point(const Node& node, glm::vec2& out) {
+   if (node.size() >= 3) {
+      out.x = (be::F32)node[1].value();
+      out.y = (be::F32)node[2].value();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Atoms which look like numbers are parsed as values, so they're printed
+// back into text.
+be::S read_atom(const Node& node) {
+   be::S text(node.text());
+   if (text.empty() && node.type() == Node::node_type::value) {
+      std::ostringstream oss;
+      oss << node.value();
+      text = oss.str();
+   }
+   return text;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reads (size x [y]) or (rect_delta x [y]); y defaults to x.
+void read_size(const Node& node, glm::vec2& out) {
+   if (node.size() >= 2) {
+      out.x = (be::F32)node[1].value();
+      out.y = node.size() >= 3 ? (be::F32)node[2].value() : out.x;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reads (drill d) or (drill oval w h).
+glm::vec2 read_drill(const Node& node) {
+   if (node.size() >= 2) {
+      const Node& n = node[1];
+      if (n.type() == Node::node_type::value) {
+         return glm::vec2((be::F32)n.value());
+      } else if (node.size() >= 4 && n.text() == "oval"sv) {
+         return glm::vec2((be::F32)node[2].value(), (be::F32)node[3].value());
+      }
+   }
+   return glm::vec2();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 read_net(const Node& node) {
+   for (const Node& child : node) {
+      if (get_node_type(child) == node_type::n_net) {
+         return child.size() >= 2 ? (be::U32)child[1].value() : BoardModel::none;
+      }
+   }
+   return BoardModel::none;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The last layer entry, along with any layers entries after it.
+layer_mask read_layers(const Node& node) {
+   layer_mask layers = 0;
+   for (auto it = node.rbegin(), end = node.rend(); it != end; ++it) {
+      const Node& child = *it;
+      node_type type = get_node_type(child);
+      if (type == node_type::n_layer && child.size() >= 2) {
+         layers |= parse_layer_mask(child[1].text());
+         break;
+      } else if (type == node_type::n_layers) {
+         for (std::size_t i = 1, s = child.size(); i < s; ++i) {
+            layers |= parse_layer_mask(child[i].text());
+         }
+      }
+   }
+   return layers;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_graphic(BoardModel& model, const Node& node, graphic_shape shape, be::U32 item, be::U32 module) {
+   glm::vec2 start, end;
+   be::F32 angle = 0;
+   be::F32 width = 0;
+
+   for (const Node& child : node) {
+      switch (get_node_type(child)) {
+         case node_type::n_start:
+            if (shape != graphic_shape::circle) {
+               read_point(child, start);
+            }
+            break;
+
+         case node_type::n_center:
+            if (shape == graphic_shape::circle) {
+               read_point(child, start);
+            }
+            break;
+
+         case node_type::n_end:
+            read_point(child, end);
+            break;
+
+         case node_type::n_angle:
+            if (shape == graphic_shape::arc && child.size() >= 2) {
+               angle = (be::F32)child[1].value();
+            }
+            break;
+
+         case node_type::n_width:
+            if (child.size() >= 2) {
+               width = (be::F32)child[1].value();
+            }
+            break;
+
+         default:
+            break;
+      }
+   }
+
+   BoardModel::Graphics& g = model.graphics;
+   g.node.push_back(&node);
+   g.item.push_back(item);
+   g.module.push_back(module);
+   g.shape.push_back(shape);
+   g.start.push_back(start);
+   g.end.push_back(end);
+   g.angle.push_back(angle);
+   g.width.push_back(width);
+   g.layers.push_back(read_layers(node));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_pad(BoardModel& model, const Node& node, be::U32 item, be::U32 module, be::F32 module_rot) {
+   pad_shape shape = pad_shape::unsupported;
+   glm::vec2 at, size, rect_delta, drill;
+   be::F32 rot = 0;
+
+   if (node.size() >= 4) {
+      shape = pad_shape_parser().parse(node[3].text());
+   }
+
+   for (const Node& child : node) {
+      switch (get_node_type(child)) {
+         case node_type::n_at:
+            if (child.size() >= 3) {
+               read_point(child, at);
+               if (child.size() >= 4) {
+                  rot = (be::F32)child[3].value();
+               }
+            }
+            break;
+
+         case node_type::n_size:
+            read_size(child, size);
+            break;
+
+         case node_type::n_rect_delta:
+            read_size(child, rect_delta);
+            break;
+
+         case node_type::n_drill:
+            drill = read_drill(child);
+            break;
+
+         default:
+            break;
+      }
+   }
+
+   // a pad's rotation includes its module's
+   BoardModel::Pads& p = model.pads;
+   p.node.push_back(&node);
+   p.item.push_back(item);
+   p.module.push_back(module);
+   p.shape.push_back(shape);
+   glm::mat3 local = translation(at) * rotation(-glm::radians(rot - module_rot));
+   p.transform.push_back(model.modules.transform[module] * local);
+   p.local_transform.push_back(local);
+   p.size.push_back(size);
+   p.rect_delta.push_back(rect_delta);
+   p.drill.push_back(drill);
+   p.net.push_back(read_net(node));
+   p.layers.push_back(read_layers(node));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_module(BoardModel& model, const Node& node, be::U32 item) {
+   glm::vec2 at;
+   be::F32 rot = 0;
+
+   auto it = find(node, "at"sv);
+   if (it != node.end()) {
+      const Node& child = *it;
+      if (child.size() >= 3) {
+         read_point(child, at);
+         if (child.size() >= 4) {
+            rot = (be::F32)child[3].value();
+         }
+      }
+   }
+
+   be::U32 module = (be::U32)model.modules.node.size();
+   BoardModel::Modules& m = model.modules;
+   m.node.push_back(&node);
+   m.item.push_back(item);
+   m.at.push_back(at);
+   m.transform.push_back(translation(at) * rotation(-glm::radians(rot)));
+   m.layers.push_back(read_layers(node));
+   m.name.push_back(node.size() >= 2 ? read_atom(node[1]) : be::S());
+   m.reference.emplace_back();
+   m.value.emplace_back();
+
+   for (const Node& child : node) {
+      switch (get_node_type(child)) {
+         case node_type::n_fp_text:
+            if (child.size() >= 3) {
+               if (child[1].text() == "reference"sv) {
+                  m.reference.back() = read_atom(child[2]);
+               } else if (child[1].text() == "value"sv) {
+                  m.value.back() = read_atom(child[2]);
+               }
+            }
+            break;
+         case node_type::n_pad:       add_pad(model, child, item, module, rot); break;
+         case node_type::n_fp_line:   add_graphic(model, child, graphic_shape::line, item, module); break;
+         case node_type::n_fp_arc:    add_graphic(model, child, graphic_shape::arc, item, module); break;
+         case node_type::n_fp_circle: add_graphic(model, child, graphic_shape::circle, item, module); break;
+         default: break;
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_segment(BoardModel& model, const Node& node, be::U32 item) {
+   glm::vec2 start, end;
+   be::F32 width = 0;
+
+   for (const Node& child : node) {
+      switch (get_node_type(child)) {
+         case node_type::n_start: read_point(child, start); break;
+         case node_type::n_end:   read_point(child, end); break;
+         case node_type::n_width:
+            if (child.size() >= 2) {
+               width = (be::F32)child[1].value();
+            }
+            break;
+         default: break;
+      }
+   }
+
+   BoardModel::Segments& s = model.segments;
+   s.node.push_back(&node);
+   s.item.push_back(item);
+   s.start.push_back(start);
+   s.end.push_back(end);
+   s.width.push_back(width);
+   s.layers.push_back(read_layers(node));
+   s.net.push_back(read_net(node));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_via(BoardModel& model, const Node& node, be::U32 item) {
+   glm::vec2 at, drill;
+   be::F32 size = 0;
+
+   for (const Node& child : node) {
+      switch (get_node_type(child)) {
+         case node_type::n_at:    read_point(child, at); break;
+         case node_type::n_drill: drill = read_drill(child); break;
+         case node_type::n_size:
+            if (child.size() >= 2) {
+               size = (be::F32)child[1].value();
+            }
+            break;
+         default: break;
+      }
+   }
+
+   BoardModel::Vias& v = model.vias;
+   v.node.push_back(&node);
+   v.item.push_back(item);
+   v.at.push_back(at);
+   v.size.push_back(size);
+   v.drill.push_back(drill);
+   v.net.push_back(read_net(node));
+   v.layers.push_back(copper_span(read_layers(node)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_zone(BoardModel& model, const Node& node, be::U32 item) {
+   be::F32 width = 0;
+   BoardModel::Span polygons { (be::U32)model.polygons.size(), 0 };
+
+   for (const Node& child : node) {
+      switch (get_node_type(child)) {
+         case node_type::n_min_thickness:
+            if (child.size() >= 2) {
+               width = (be::F32)child[1].value();
+            }
+            break;
+
+         case node_type::n_filled_polygon:
+         {
+            auto it = find(child, "pts"sv);
+            if (it != child.end()) {
+               BoardModel::Span points { (be::U32)model.points.size(), 0 };
+               for (const Node& p : *it) {
+                  if (p.size() >= 3 && get_node_type(p) == node_type::n_xy) {
+                     model.points.push_back(glm::vec2((be::F32)p[1].value(), (be::F32)p[2].value()));
+                  }
+               }
+               points.count = (be::U32)model.points.size() - points.begin;
+               model.polygons.push_back(points);
+            }
+            break;
+         }
+
+         default:
+            break;
+      }
+   }
+   polygons.count = (be::U32)model.polygons.size() - polygons.begin;
+
+   BoardModel::Zones& z = model.zones;
+   z.node.push_back(&node);
+   z.item.push_back(item);
+   z.width.push_back(width);
+   z.net.push_back(read_net(node));
+   z.layers.push_back(read_layers(node));
+   z.polygons.push_back(polygons);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void add_net(BoardModel& model, const Node& node) {
+   if (node.size() >= 3) {
+      model.nets.number.push_back((be::U32)node[1].value());
+      model.nets.name.push_back(read_atom(node[2]));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Gives modules with identical graphics and pads the same footprint id.
+// Modules are grouped by a hash of their contents, then compared in full.
+void index_footprints(BoardModel& model) {
+   const BoardModel::Modules& m = model.modules;
+   const BoardModel::Graphics& g = model.graphics;
+   const BoardModel::Pads& p = model.pads;
+
+   auto hash_of = [](be::U64 h, const auto& value) {
+      unsigned char bytes[sizeof(value)];
+      std::memcpy(bytes, &value, sizeof(value));
+      for (unsigned char c : bytes) {
+         h = (h ^ c) * 0x100000001b3ull;
+      }
+      return h;
+   };
+
+   auto body = [&](be::U32 module) {
+      const BoardModel::ItemStart& begin = model.items[m.item[module]];
+      const BoardModel::ItemStart& end = model.items[m.item[module] + 1];
+      return std::make_pair(BoardModel::Span { begin.graphics, end.graphics - begin.graphics },
+                            BoardModel::Span { begin.pads, end.pads - begin.pads });
+   };
+
+   auto same_body = [&](be::U32 a, be::U32 b) {
+      auto [ag, ap] = body(a);
+      auto [bg, bp] = body(b);
+      if (ag.count != bg.count || ap.count != bp.count) {
+         return false;
+      }
+      for (be::U32 i = 0; i < ag.count; ++i) {
+         be::U32 x = ag.begin + i;
+         be::U32 y = bg.begin + i;
+         if (g.shape[x] != g.shape[y] || g.start[x] != g.start[y] || g.end[x] != g.end[y]
+             || g.angle[x] != g.angle[y] || g.width[x] != g.width[y] || g.layers[x] != g.layers[y]) {
+            return false;
+         }
+      }
+      for (be::U32 i = 0; i < ap.count; ++i) {
+         be::U32 x = ap.begin + i;
+         be::U32 y = bp.begin + i;
+         if (p.shape[x] != p.shape[y] || p.local_transform[x] != p.local_transform[y] || p.size[x] != p.size[y]
+             || p.rect_delta[x] != p.rect_delta[y] || p.drill[x] != p.drill[y] || p.layers[x] != p.layers[y]) {
+            return false;
+         }
+      }
+      return true;
+   };
+
+   BoardModel::Footprints& footprints = model.footprints;
+   std::unordered_multimap<be::U64, be::U32> by_hash; // to footprint ids
+   std::vector<be::U32> first_module; // by footprint id
+   model.modules.footprint.resize(m.node.size());
+   for (be::U32 module = 0, n = (be::U32)m.node.size(); module < n; ++module) {
+      auto [gs, ps] = body(module);
+      be::U64 h = 0xcbf29ce484222325ull;
+      for (be::U32 i = gs.begin, end = gs.begin + gs.count; i < end; ++i) {
+         h = hash_of(h, g.shape[i]);
+         h = hash_of(h, g.start[i]);
+         h = hash_of(h, g.end[i]);
+         h = hash_of(h, g.angle[i]);
+         h = hash_of(h, g.width[i]);
+         h = hash_of(h, g.layers[i]);
+      }
+      for (be::U32 i = ps.begin, end = ps.begin + ps.count; i < end; ++i) {
+         h = hash_of(h, p.shape[i]);
+         h = hash_of(h, p.local_transform[i]);
+         h = hash_of(h, p.size[i]);
+         h = hash_of(h, p.rect_delta[i]);
+         h = hash_of(h, p.drill[i]);
+         h = hash_of(h, p.layers[i]);
+      }
+      h = hash_of(h, gs.count);
+      h = hash_of(h, ps.count);
+
+      be::U32 id = BoardModel::none;
+      auto range = by_hash.equal_range(h);
+      for (auto it = range.first; it != range.second; ++it) {
+         if (same_body(first_module[it->second], module)) {
+            id = it->second;
+            break;
+         }
+      }
+
+      if (id == BoardModel::none) {
+         id = (be::U32)footprints.hash.size();
+         footprints.hash.push_back(h);
+         footprints.count.push_back(0);
+         first_module.push_back(module);
+         by_hash.emplace(h, id);
+      }
+
+      model.modules.footprint[module] = id;
+      ++footprints.count[id];
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Replaces the net numbers read from the file with net ids, adding any nets
+// which weren't declared, then lists each net's members.
+void index_nets(BoardModel& model) {
+   BoardModel::Nets& nets = model.nets;
+   std::unordered_map<be::U32, be::U32> ids;
+   for (be::U32 id = 0, n = (be::U32)nets.number.size(); id < n; ++id) {
+      ids.emplace(nets.number[id], id);
+   }
+
+   auto to_id = [&](std::vector<be::U32>& numbers) {
+      for (be::U32& net : numbers) {
+         if (net != BoardModel::none) {
+            auto result = ids.emplace(net, (be::U32)nets.number.size());
+            if (result.second) {
+               nets.number.push_back(net);
+               nets.name.push_back(be::S());
+            }
+            net = result.first->second;
+         }
+      }
+   };
+
+   to_id(model.segments.net);
+   to_id(model.vias.net);
+   to_id(model.pads.net);
+   to_id(model.zones.net);
+
+   std::size_t n_nets = nets.number.size();
+   auto list = [&](const std::vector<be::U32>& item_nets, std::vector<BoardModel::Span>& spans) {
+      spans.assign(n_nets, BoardModel::Span());
+      for (be::U32 net : item_nets) {
+         if (net != BoardModel::none) {
+            ++spans[net].count;
+         }
+      }
+
+      be::U32 begin = (be::U32)model.net_members.size();
+      for (BoardModel::Span& span : spans) {
+         span.begin = begin;
+         begin += span.count;
+         span.count = 0;
+      }
+
+      model.net_members.resize(begin);
+      for (be::U32 i = 0, n = (be::U32)item_nets.size(); i < n; ++i) {
+         be::U32 net = item_nets[i];
+         if (net != BoardModel::none) {
+            BoardModel::Span& span = spans[net];
+            model.net_members[span.begin + span.count++] = i;
+         }
+      }
+   };
+
+   list(model.segments.net, nets.segments);
+   list(model.vias.net, nets.vias);
+   list(model.pads.net, nets.pads);
+   list(model.zones.net, nets.zones);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Loose rather than tight: arcs count as whole circles, and pads as the
+// circles around their corners.  Tessellated curves stray outside the true
+// ones, by up to a sixth of their radius at four segments per circle, and
+// the mitered outsides of arcs further still, so every radius is padded.
+void bound_items(BoardModel& model) {
+   constexpr be::F32 slack = 1.5f;
+
+   const BoardModel::Modules& m = model.modules;
+   const BoardModel::Graphics& g = model.graphics;
+   const BoardModel::Pads& p = model.pads;
+   const BoardModel::Segments& s = model.segments;
+   const BoardModel::Vias& v = model.vias;
+   const BoardModel::Zones& z = model.zones;
+
+   model.item_bounds.assign(model.size(), BoardModel::Bounds());
+   for (std::size_t item = 0, n = model.size(); item < n; ++item) {
+      const BoardModel::ItemStart& begin = model.items[item];
+      const BoardModel::ItemStart& end = model.items[item + 1];
+      BoardModel::Bounds& bounds = model.item_bounds[item];
+      auto add = [&](glm::vec2 center, be::F32 radius) {
+         bounds.add(center, radius * slack);
+      };
+
+      for (be::U32 i = begin.graphics; i < end.graphics; ++i) {
+         glm::vec2 start = g.start[i];
+         glm::vec2 finish = g.end[i];
+         if (g.module[i] != BoardModel::none) {
+            const glm::mat3& transform = m.transform[g.module[i]];
+            start = glm::vec2(transform * glm::vec3(start, 1.f));
+            finish = glm::vec2(transform * glm::vec3(finish, 1.f));
+         }
+
+         be::F32 half_width = g.width[i] / 2.f;
+         if (g.shape[i] == graphic_shape::line) {
+            add(start, half_width);
+            add(finish, half_width);
+         } else {
+            add(start, glm::distance(start, finish) + half_width);
+         }
+      }
+
+      for (be::U32 i = begin.pads; i < end.pads; ++i) {
+         be::F32 radius = glm::length(p.size[i]) / 2.f + glm::length(p.rect_delta[i]) / 2.f;
+         add(glm::vec2(p.transform[i][2]), std::max(radius, std::max(p.drill[i].x, p.drill[i].y) / 2.f));
+      }
+
+      for (be::U32 i = begin.segments; i < end.segments; ++i) {
+         add(s.start[i], s.width[i] / 2.f);
+         add(s.end[i], s.width[i] / 2.f);
+      }
+
+      for (be::U32 i = begin.vias; i < end.vias; ++i) {
+         add(v.at[i], std::max(v.size[i], std::max(v.drill[i].x, v.drill[i].y)) / 2.f);
+      }
+
+      for (be::U32 i = begin.zones; i < end.zones; ++i) {
+         BoardModel::Span polygons = z.polygons[i];
+         for (be::U32 polygon = polygons.begin, polygons_end = polygons.begin + polygons.count; polygon < polygons_end; ++polygon) {
+            BoardModel::Span span = model.polygons[polygon];
+            for (be::U32 point = span.begin, points_end = span.begin + span.count; point < points_end; ++point) {
+               add(model.points[point], z.width[i] / 2.f);
+            }
+         }
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Appends the entries of old's board item old_item as entries of item, read
+// from node.  Nets go back to numbers, for index_nets().
+void copy_item(BoardModel& model, const BoardModel& old, be::U32 old_item, const Node& node, be::U32 item) {
+   const BoardModel::ItemStart& begin = old.items[old_item];
+   const BoardModel::ItemStart& end = old.items[old_item + 1];
+
+   auto net_number = [&](be::U32 net) {
+      return net == BoardModel::none ? net : old.nets.number[net];
+   };
+
+   be::U32 module = BoardModel::none;
+   auto it = std::lower_bound(old.modules.item.begin(), old.modules.item.end(), old_item);
+   if (it != old.modules.item.end() && *it == old_item) {
+      std::size_t i = it - old.modules.item.begin();
+      module = (be::U32)model.modules.node.size();
+      BoardModel::Modules& m = model.modules;
+      m.node.push_back(&node);
+      m.item.push_back(item);
+      m.at.push_back(old.modules.at[i]);
+      m.transform.push_back(old.modules.transform[i]);
+      m.layers.push_back(old.modules.layers[i]);
+      m.name.push_back(old.modules.name[i]);
+      m.reference.push_back(old.modules.reference[i]);
+      m.value.push_back(old.modules.value[i]);
+   }
+
+   const BoardModel::Graphics& og = old.graphics;
+   BoardModel::Graphics& g = model.graphics;
+   for (be::U32 i = begin.graphics; i < end.graphics; ++i) {
+      g.node.push_back(og.module[i] == BoardModel::none ? &node : nullptr);
+      g.item.push_back(item);
+      g.module.push_back(og.module[i] == BoardModel::none ? BoardModel::none : module);
+      g.shape.push_back(og.shape[i]);
+      g.start.push_back(og.start[i]);
+      g.end.push_back(og.end[i]);
+      g.angle.push_back(og.angle[i]);
+      g.width.push_back(og.width[i]);
+      g.layers.push_back(og.layers[i]);
+   }
+
+   const BoardModel::Pads& op = old.pads;
+   BoardModel::Pads& p = model.pads;
+   for (be::U32 i = begin.pads; i < end.pads; ++i) {
+      p.node.push_back(nullptr);
+      p.item.push_back(item);
+      p.module.push_back(module);
+      p.shape.push_back(op.shape[i]);
+      p.transform.push_back(op.transform[i]);
+      p.local_transform.push_back(op.local_transform[i]);
+      p.size.push_back(op.size[i]);
+      p.rect_delta.push_back(op.rect_delta[i]);
+      p.drill.push_back(op.drill[i]);
+      p.net.push_back(net_number(op.net[i]));
+      p.layers.push_back(op.layers[i]);
+   }
+
+   const BoardModel::Segments& os = old.segments;
+   BoardModel::Segments& s = model.segments;
+   for (be::U32 i = begin.segments; i < end.segments; ++i) {
+      s.node.push_back(&node);
+      s.item.push_back(item);
+      s.start.push_back(os.start[i]);
+      s.end.push_back(os.end[i]);
+      s.width.push_back(os.width[i]);
+      s.layers.push_back(os.layers[i]);
+      s.net.push_back(net_number(os.net[i]));
+   }
+
+   const BoardModel::Vias& ov = old.vias;
+   BoardModel::Vias& v = model.vias;
+   for (be::U32 i = begin.vias; i < end.vias; ++i) {
+      v.node.push_back(&node);
+      v.item.push_back(item);
+      v.at.push_back(ov.at[i]);
+      v.size.push_back(ov.size[i]);
+      v.drill.push_back(ov.drill[i]);
+      v.net.push_back(net_number(ov.net[i]));
+      v.layers.push_back(ov.layers[i]);
+   }
+
+   const BoardModel::Zones& oz = old.zones;
+   BoardModel::Zones& z = model.zones;
+   for (be::U32 i = begin.zones; i < end.zones; ++i) {
+      BoardModel::Span polygons { (be::U32)model.polygons.size(), oz.polygons[i].count };
+      for (be::U32 polygon = oz.polygons[i].begin, polygons_end = polygon + polygons.count; polygon < polygons_end; ++polygon) {
+         BoardModel::Span span = old.polygons[polygon];
+         model.polygons.push_back(BoardModel::Span { (be::U32)model.points.size(), span.count });
+         model.points.insert(model.points.end(), old.points.begin() + span.begin, old.points.begin() + span.begin + span.count);
+      }
+
+      z.node.push_back(&node);
+      z.item.push_back(item);
+      z.width.push_back(oz.width[i]);
+      z.net.push_back(net_number(oz.net[i]));
+      z.layers.push_back(oz.layers[i]);
+      z.polygons.push_back(polygons);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardModel build_board_model(const Node& board, const BoardModel* old, const std::vector<be::U32>* reused) {
+   BoardModel model;
+   be::U32 item = 0;
+
+   for (const Node& child : board) {
+      if (!child.empty()) {
+         node_type type = get_node_type(child);
+         if (old && type != node_type::n_net && (*reused)[item] != BoardModel::none) {
+            copy_item(model, *old, (*reused)[item], child, item);
+         } else {
+            switch (type) {
+               case node_type::n_gr_line:   add_graphic(model, child, graphic_shape::line, item, BoardModel::none); break;
+               case node_type::n_gr_arc:    add_graphic(model, child, graphic_shape::arc, item, BoardModel::none); break;
+               case node_type::n_gr_circle: add_graphic(model, child, graphic_shape::circle, item, BoardModel::none); break;
+               case node_type::n_module:    add_module(model, child, item); break;
+               case node_type::n_segment:   add_segment(model, child, item); break;
+               case node_type::n_via:       add_via(model, child, item); break;
+               case node_type::n_zone:      add_zone(model, child, item); break;
+               case node_type::n_net:       add_net(model, child); break;
+               default: break;
+            }
+         }
+      }
+
+      ++item;
+      model.items.push_back(BoardModel::ItemStart {
+         (be::U32)model.graphics.node.size(),
+         (be::U32)model.pads.node.size(),
+         (be::U32)model.segments.node.size(),
+         (be::U32)model.vias.node.size(),
+         (be::U32)model.zones.node.size()
+      });
+   }
+
+   index_nets(model);
+   index_footprints(model);
+   bound_items(model);
+   return model;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+const Node* BoardModel::node(model_item type, std::size_t i) const {
+   switch (type) {
+      case model_item::graphic:  return graphics.node[i];
+      case model_item::pad:
+      case model_item::pad_hole: return pads.node[i];
+      case model_item::segment:  return segments.node[i];
+      case model_item::via:
+      case model_item::via_hole: return vias.node[i];
+      default:                   return zones.node[i];
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 BoardModel::item(model_item type, std::size_t i) const {
+   switch (type) {
+      case model_item::graphic:  return graphics.item[i];
+      case model_item::pad:
+      case model_item::pad_hole: return pads.item[i];
+      case model_item::segment:  return segments.item[i];
+      case model_item::via:
+      case model_item::via_hole: return vias.item[i];
+      default:                   return zones.item[i];
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 BoardModel::net(model_item type, std::size_t i) const {
+   switch (type) {
+      case model_item::pad:
+      case model_item::pad_hole: return pads.net[i];
+      case model_item::segment:  return segments.net[i];
+      case model_item::via:
+      case model_item::via_hole: return vias.net[i];
+      case model_item::zone:     return zones.net[i];
+      default:                   return none;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 BoardModel::module(model_item type, std::size_t i) const {
+   switch (type) {
+      case model_item::graphic:  return graphics.module[i];
+      case model_item::pad:
+      case model_item::pad_hole: return pads.module[i];
+      default:                   return none;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+layer_mask BoardModel::layers(model_item type, std::size_t i) const {
+   switch (type) {
+      case model_item::graphic: return graphics.layers[i];
+      case model_item::pad:     return pads.layers[i];
+      case model_item::segment: return segments.layers[i];
+      case model_item::via:     return vias.layers[i];
+      case model_item::zone:    return zones.layers[i];
+      default:                  return 0;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BoardModel::Bounds::add(glm::vec2 center, be::F32 radius) noexcept {
+   lo = glm::min(lo, center - radius);
+   hi = glm::max(hi, center + radius);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool BoardModel::Bounds::overlaps(const Bounds& other) const noexcept {
+   return lo.x <= other.hi.x && other.lo.x <= hi.x && lo.y <= other.hi.y && other.lo.y <= hi.y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool BoardModel::Bounds::contains(const Bounds& other) const noexcept {
+   return lo.x <= other.lo.x && other.hi.x <= hi.x && lo.y <= other.lo.y && other.hi.y <= hi.y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Board items are contiguous in the tree, so modules are in address order.
+be::U32 BoardModel::find_module(const Node* node) const {
+   auto it = std::lower_bound(modules.node.begin(), modules.node.end(), node, std::less<const Node*>());
+   if (it == modules.node.end() || *it != node) {
+      return none;
+   }
+   return (be::U32)(it - modules.node.begin());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 BoardModel::find_net(be::SV name) const {
+   for (be::U32 id = 0, n = (be::U32)nets.name.size(); id < n; ++id) {
+      if (nets.name[id] == name) {
+         return id;
+      }
+   }
+   return none;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardModel build_board_model(const Node& board) {
+   return build_board_model(board, nullptr, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoardModel build_board_model(const Node& board, const BoardModel& old, const std::vector<be::U32>& reused) {
+   return build_board_model(board, &old, &reused);
+}
@@ -0,0 +1,91 @@
+#include "circle.hpp"
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr be::F64 pi = 3.14159265358979323846;
+
+///////////////////////////////////////////////////////////////////////////////
+// Taylor series, which are accurate to double precision within [-pi, pi].
+constexpr be::F64 series_cos(be::F64 x) {
+   be::F64 term = 1;
+   be::F64 sum = 1;
+   for (int n = 1; n < 20; ++n) {
+      term *= -x * x / ((2 * n - 1) * (2 * n));
+      sum += term;
+   }
+   return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+constexpr be::F64 series_sin(be::F64 x) {
+   be::F64 term = x;
+   be::F64 sum = x;
+   for (int n = 1; n < 20; ++n) {
+      term *= -x * x / ((2 * n) * (2 * n + 1));
+      sum += term;
+   }
+   return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+constexpr void fill_unit_circle(be::U32 segments, be::F32* cos, be::F32* sin) {
+   for (be::U32 k = 0; k < 2 * segments; ++k) {
+      be::F64 theta = pi * k / segments;
+      if (theta > pi) {
+         theta -= 2 * pi;
+      }
+      cos[k] = (be::F32)series_cos(theta);
+      sin[k] = (be::F32)series_sin(theta);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <be::U32 Segments>
+struct UnitCircleTable {
+   be::F32 cos[2 * Segments] = {};
+   be::F32 sin[2 * Segments] = {};
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <be::U32 Segments>
+constexpr UnitCircleTable<Segments> make_unit_circle() {
+   UnitCircleTable<Segments> table;
+   fill_unit_circle(Segments, table.cos, table.sin);
+   return table;
+}
+
+// the default pad, endcap and zone endcap density, and the default arc density
+constexpr UnitCircleTable<18> unit_circle_18 = make_unit_circle<18>();
+constexpr UnitCircleTable<72> unit_circle_72 = make_unit_circle<72>();
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+UnitCircle unit_circle(be::U32 segments) {
+   switch (segments) {
+      case 18: return UnitCircle { unit_circle_18.cos, unit_circle_18.sin };
+      case 72: return UnitCircle { unit_circle_72.cos, unit_circle_72.sin };
+   }
+
+   // tessellation runs on several threads, so each remembers the last table
+   // it used rather than locking for every circle
+   thread_local be::U32 cached_segments = 0;
+   thread_local UnitCircle cached = UnitCircle();
+   if (segments != cached_segments) {
+      static std::mutex mutex;
+      static std::map<be::U32, std::vector<be::F32>> tables;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<be::F32>& table = tables[segments];
+      if (table.empty()) {
+         table.resize(4 * (std::size_t)segments);
+         fill_unit_circle(segments, table.data(), table.data() + 2 * segments);
+      }
+      cached = UnitCircle { table.data(), table.data() + 2 * segments };
+      cached_segments = segments;
+   }
+   return cached;
+}
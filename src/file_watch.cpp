@@ -0,0 +1,181 @@
+#include "file_watch.hpp"
+#include <chrono>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+struct FileStamp {
+   bool exists = false;
+   be::U64 size = 0;
+   be::I64 mtime = 0;
+
+   bool operator!=(const FileStamp& other) const noexcept {
+      return exists != other.exists || size != other.size || mtime != other.mtime;
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+FileStamp stamp(const be::S& path) {
+   std::error_code ec;
+   FileStamp s;
+   s.size = (be::U64)std::filesystem::file_size(path, ec);
+   if (!ec) {
+      s.mtime = (be::I64)std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+      s.exists = !ec;
+   }
+   return s;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+FileWatch::~FileWatch() {
+   stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FileWatch::start(const be::S& path, std::function<void()> on_change) {
+   stop();
+   path_ = path;
+   on_change_ = std::move(on_change);
+   stopping_ = false;
+   polling_ = false;
+
+#ifdef __linux__
+   if (start_inotify_()) {
+      return;
+   }
+#endif
+
+   polling_ = true;
+   thread_ = std::thread(&FileWatch::poll_loop_, this);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FileWatch::stop() {
+   if (!thread_.joinable()) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+   }
+   stop_cv_.notify_all();
+
+#ifdef __linux__
+   if (wake_fds_[1] >= 0) {
+      char c = 0;
+      while (::write(wake_fds_[1], &c, 1) < 0 && errno == EINTR) { }
+   }
+#endif
+
+   thread_.join();
+
+#ifdef __linux__
+   for (int* fd : { &inotify_fd_, &wake_fds_[0], &wake_fds_[1] }) {
+      if (*fd >= 0) {
+         ::close(*fd);
+         *fd = -1;
+      }
+   }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool FileWatch::start_inotify_() {
+#ifdef __linux__
+   std::filesystem::path path(path_);
+   std::filesystem::path dir = path.parent_path();
+   if (dir.empty()) {
+      dir = ".";
+   }
+
+   inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (inotify_fd_ < 0) {
+      return false;
+   }
+
+   // editors often write a temporary file and rename it over the original,
+   // which would silently detach a watch on the file itself
+   if (::inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+       ::pipe2(wake_fds_, O_CLOEXEC) != 0) {
+      ::close(inotify_fd_);
+      inotify_fd_ = -1;
+      return false;
+   }
+
+   thread_ = std::thread(&FileWatch::inotify_loop_, this, path.filename().string());
+   return true;
+#else
+   return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FileWatch::inotify_loop_(be::S filename) {
+#ifdef __linux__
+   alignas(inotify_event) char buf[4096];
+   bool pending = false;
+
+   for (;;) {
+      pollfd fds[2] = { { inotify_fd_, POLLIN, 0 }, { wake_fds_[0], POLLIN, 0 } };
+      int result = ::poll(fds, 2, pending ? (int)settle_time_ms : -1);
+      if (result < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         break;
+      }
+
+      if (fds[1].revents != 0) {
+         break;
+      }
+
+      if (result == 0) {
+         pending = false;
+         on_change_();
+         continue;
+      }
+
+      ssize_t n;
+      while ((n = ::read(inotify_fd_, buf, sizeof(buf))) > 0) {
+         for (char* it = buf; it < buf + n; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(it);
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && filename == event->name)) {
+               pending = true;
+            }
+            it += sizeof(inotify_event) + event->len;
+         }
+      }
+   }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FileWatch::poll_loop_() {
+   FileStamp last = stamp(path_);
+   bool pending = false;
+
+   std::unique_lock<std::mutex> lock(mutex_);
+   while (!stop_cv_.wait_for(lock, std::chrono::milliseconds(pending ? settle_time_ms : poll_interval_ms), [this]() { return stopping_; })) {
+      FileStamp current = stamp(path_);
+      if (current != last) {
+         last = current;
+         pending = true;
+      } else if (pending) {
+         pending = false;
+         lock.unlock();
+         on_change_();
+         lock.lock();
+      }
+   }
+}
@@ -0,0 +1,25 @@
+#include "indexed_mesh.hpp"
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// Since triangles only index the vertices of their own board items, the
+// vertices of a run of whole items are those between the lowest and highest
+// index in it.
+void IndexedMesh::append(const IndexedMesh& other, std::size_t begin, std::size_t end) {
+   if (begin >= end) {
+      return;
+   }
+
+   const be::U32* first = other.indices.data() + begin * 3;
+   const be::U32* last = other.indices.data() + end * 3;
+   auto range = std::minmax_element(first, last);
+   be::U32 lo = *range.first;
+   be::U32 hi = *range.second + 1;
+
+   be::U32 base = (be::U32)vertices.size();
+   vertices.insert(vertices.end(), other.vertices.begin() + lo, other.vertices.begin() + hi);
+   indices.reserve(indices.size() + (last - first));
+   for (const be::U32* i = first; i != last; ++i) {
+      indices.push_back(base + *i - lo);
+   }
+}
@@ -2,6 +2,7 @@
 #include "node.hpp"
 #include "render_layer.hpp"
 #include "layer_config.hpp"
+#include "pick_grid.hpp"
 
 #include <be/core/logging.hpp>
 #include <be/core/version.hpp>
@@ -9,7 +10,6 @@
 #include <be/core/alg.hpp>
 #include <be/util/keyword_parser.hpp>
 #include <be/util/parse_numeric_string.hpp>
-#include <be/util/get_file_contents.hpp>
 #include <be/platform/glfw_window.hpp>
 #include <be/gfx/version.hpp>
 #include <be/cli/cli.hpp>
@@ -22,6 +22,7 @@
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <chrono>
 
 using namespace std::string_view_literals;
 using namespace be;
@@ -51,6 +52,7 @@ KiViewApp::KiViewApp(int argc, char** argv) {
          }))
          (end_of_options())
          (verbosity_param({ "v" }, { "verbosity" }, "LEVEL", default_log().verbosity_mask()))
+         (flag({ "c" }, { "cache" }, use_cache_).desc(Cell() << "Reuses a parsed copy of the board stored beside it in " << fg_cyan << "filename" << fg_yellow << ".kvcache" << reset << ", creating it if necessary."))
          (flag({ "V" }, { "version" }, show_version).desc("Prints version information to standard output."))
          (param({ "?" }, { "help" }, "OPTION", [&](const S& value) {
                show_help = true;
@@ -167,46 +169,54 @@ void GLAPIENTRY check_errors(GLenum source, GLenum type, GLuint id, GLenum sever
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-rect get_area(const Node& pcb) {
-   Node::const_iterator it = find(pcb, "general");
-   if (it != pcb.end()) {
-      Node::const_iterator area_it = find(*it, "area");
-      if (area_it != it->end()) {
-         const Node& area = *area_it;
-         if (area.size() >= 5) {
-            rect r;
-            r.offset.x = (F32)area[1].value();
-            r.offset.y = (F32)area[2].value();
-            vec2 b((F32)area[3].value(), (F32)area[4].value());
-            return r.union_bounds(rect { b, vec2() });
-         }
-      }
+// Draws triangles [begin, end) of mesh from client memory.
+void draw_triangles(const IndexedMesh& mesh, std::size_t begin, std::size_t end, bool wireframe) {
+   if (begin >= end) {
+      return;
+   }
+
+   if (wireframe) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+   }
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(2, GL_FLOAT, sizeof(glm::vec2), mesh.vertices.data());
+   glDrawElements(GL_TRIANGLES, (GLsizei)((end - begin) * 3), GL_UNSIGNED_INT, mesh.indices.data() + begin * 3);
+   glDisableClientState(GL_VERTEX_ARRAY);
+
+   if (wireframe) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
    }
-   return rect();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void draw_layer(const Node& root, const RenderNodePredicate& func, glm::vec4 color, bool wireframe) {
-   std::vector<triangle> tris = render_layer(root, func);
+void draw_layer(const IndexedMesh& mesh, glm::vec4 color, bool wireframe) {
    glColor4fv(glm::value_ptr(color));
+   draw_triangles(mesh, 0, mesh.triangles(), wireframe);
+}
 
-   if (wireframe) {
-      for (auto& tri : tris) {
-         glBegin(GL_LINE_LOOP);
-         glVertex2fv(glm::value_ptr(tri.v[0]));
-         glVertex2fv(glm::value_ptr(tri.v[1]));
-         glVertex2fv(glm::value_ptr(tri.v[2]));
-         glEnd();
-      }
-   } else {
-      glBegin(GL_TRIANGLES);
-      for (auto& tri : tris) {
-         glVertex2fv(glm::value_ptr(tri.v[0]));
-         glVertex2fv(glm::value_ptr(tri.v[1]));
-         glVertex2fv(glm::value_ptr(tri.v[2]));
+///////////////////////////////////////////////////////////////////////////////
+// Leaves out the triangles of hidden board items; item_ends is as in
+// CachedMesh.
+void draw_layer(const IndexedMesh& mesh, const std::vector<be::U32>& item_ends,
+                const std::vector<bool>& hidden_items, glm::vec4 color, bool wireframe) {
+   if (item_ends.size() != hidden_items.size()) {
+      draw_layer(mesh, color, wireframe);
+      return;
+   }
+
+   glColor4fv(glm::value_ptr(color));
+   std::size_t run = 0;
+   std::size_t item = 0;
+   for (std::size_t i = 0, n = item_ends.size(); i < n; ++i) {
+      std::size_t end = item_ends[i];
+      if (hidden_items[i]) {
+         draw_triangles(mesh, run, item, wireframe);
+         run = end;
       }
-      glEnd();
+      item = end;
    }
+   draw_triangles(mesh, run, mesh.triangles(), wireframe);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -281,132 +291,10 @@ util::KeywordParser<bool> bool_parser() {
    return parser;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-const Node* find_closest_module(const Node& root, glm::vec2 target, be::F32& max_distance, face_type side) {
-   const Node* closest = nullptr;
-
-   auto& parser = node_type_parser();
-   for (const Node& child : root) {
-      if (!child.empty()) {
-         node_type child_type = parser.parse(child[0].text());
-         if (child_type != node_type::ignored) {
-            
-            switch (child_type) {
-               case node_type::n_kicad_pcb:
-                  return find_closest_module(child, target, max_distance, side);
-
-               case node_type::n_module:
-                  if (check_layer(child, side, layer_type::any)) {
-                     auto it = find(child, "at"sv);
-                     if (it != child.end()) {
-                        const Node& at = *it;
-                        if (at.size() >= 3) {
-                           glm::vec2 at_pos = glm::vec2((be::F32)at[1].value(), (be::F32)at[2].value());
-                           if (glm::distance2(at_pos, target) < max_distance * max_distance) {
-                              closest = &child;
-                              max_distance = glm::distance(at_pos, target);
-                           }
-                        }
-                     }
-                  }
-                  break;
-            }
-         }
-      }
-   }
-
-   return closest;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-const Node* find_closest_segment_or_via(const Node& root, glm::vec2 target, be::F32& max_distance, face_type side, const std::set<be::U32>& skip_nets) {
-   const Node* closest = nullptr;
-
-   auto& parser = node_type_parser();
-   for (const Node& child : root) {
-      if (!child.empty()) {
-         node_type child_type = parser.parse(child[0].text());
-         if (child_type != node_type::ignored) {
-            
-            switch (child_type) {
-               case node_type::n_kicad_pcb:
-                  return find_closest_segment_or_via(child, target, max_distance, side, skip_nets);
-
-               case node_type::n_segment:
-                  if (check_layer(child, side, layer_type::any)) {
-                     auto nit = find(child, "net"sv);
-                     auto sit = find(child, "start"sv);
-                     auto eit = find(child, "end"sv);
-                     if (nit != child.end() && sit != child.end() && eit != child.end()) {
-                        const Node& net = *nit;
-                        const Node& start = *sit;
-                        const Node& end = *eit;
-                        if (net.size() >= 2 && start.size() >= 3 && end.size() >= 3) {
-                           if (skip_nets.count((be::U32)net[1].value()) > 0) {
-                              break;
-                           }
-
-                           glm::vec2 start_pos = glm::vec2((be::F32)start[1].value(), (be::F32)start[2].value());
-                           glm::vec2 end_pos = glm::vec2((be::F32)end[1].value(), (be::F32)end[2].value());
-                           glm::vec2 delta = end_pos - start_pos;
-                           if (glm::dot(delta, target - end_pos) >= 0) {
-                              if (glm::distance2(end_pos, target) < max_distance * max_distance) {
-                                 closest = &child;
-                                 max_distance = glm::distance(end_pos, target);
-                              }
-                           } else if (glm::dot(-delta, target - start_pos) >= 0) {
-                              if (glm::distance2(start_pos, target) < max_distance * max_distance) {
-                                 closest = &child;
-                                 max_distance = glm::distance(start_pos, target);
-                              }
-                           } else {
-                              glm::vec2 normal = glm::normalize(glm::vec2(-delta.y, delta.x));
-                              F32 distance = std::abs(glm::dot(normal, target - start_pos));
-                              if (distance < max_distance) {
-                                 closest = &child;
-                                 max_distance = distance;
-                              }
-                           }
-                        }
-                     }
-                  }
-                  break;
-
-               case node_type::n_via:
-                  if (check_layer(child, side, layer_type::any)) {
-                     auto nit = find(child, "net"sv);
-                     auto it = find(child, "at"sv);
-                     if (nit != child.end() && it != child.end()) {
-                        const Node& net = *nit;
-                        const Node& at = *it;
-                        if (net.size() >= 2 && at.size() >= 3) {
-                           if (skip_nets.count((be::U32)net[1].value()) > 0) {
-                              break;
-                           }
-
-                           glm::vec2 at_pos = glm::vec2((be::F32)at[1].value(), (be::F32)at[2].value());
-                           if (glm::distance2(at_pos, target) < max_distance * max_distance) {
-                              closest = &child;
-                              max_distance = glm::distance(at_pos, target);
-                           }
-                        }
-                     }
-                  }
-                  break;
-            }
-         }
-      }
-   }
-
-   return closest;
-}
-
 } // ::()
 
 ///////////////////////////////////////////////////////////////////////////////
 void KiViewApp::run_() {
-   si_.provisioning_policy([](std::size_t s) { return min(s * 2, 0x1000000ull) + 0x10000; });
-
    stb_easy_font_spacing(-1);
 
    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -418,6 +306,7 @@ void KiViewApp::run_() {
    glfwSetWindowUserPointer(wnd_, this);
 
    gl::init_context();
+   shape_renderer_ = std::make_unique<ShapeRenderer>();
 
    if (GL_KHR_debug) {
       //#bgl checked(GL_KHR_debug)
@@ -433,8 +322,12 @@ void KiViewApp::run_() {
    glBlendEquation(GL_FUNC_ADD);
    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
 
-   load_(filename_);
-   autoscale_();
+   start_load_();
+
+   watch_.start(filename_, [this]() {
+      reload_pending_ = true;
+      glfwPostEmptyEvent();
+   });
 
    glfwSetWindowSizeCallback(wnd_, [](GLFWwindow* wnd, int w, int h) {
       KiViewApp& app = *static_cast<KiViewApp*>(glfwGetWindowUserPointer(wnd));
@@ -534,47 +427,227 @@ void KiViewApp::run_() {
 
    while (!glfwWindowShouldClose(wnd_)) {
       glfwWaitEvents();
+      poll_load_();
+      if (reload_pending_.exchange(false)) {
+         reload_();
+      }
+      update_mesh_view_();
       render_();
       glfwSwapBuffers(wnd_);
    }
 
+   watch_.stop();
+   cancel_load_();
+
+   // GL objects go before the context does
+   for (auto& buffers : mesh_buffers_) {
+      for (MeshBuffers& b : buffers) {
+         b = MeshBuffers();
+      }
+   }
+   for (auto& buffers : shape_buffers_) {
+      for (ShapeBuffers& b : buffers) {
+         b = ShapeBuffers();
+      }
+   }
+   shape_renderer_.reset();
+
    glfwDestroyWindow(wnd_);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void KiViewApp::load_(be::SV filename) {
-   S file = be::util::get_text_file_contents_string(filename_);
-   root_ = parse(file, si_);
-   
-   Node::const_iterator iter = find(root_, "kicad_pcb"sv);
-   
-   S window_title = filename_;
-
-   if (iter != root_.end()) {
-      const Node& pcb = *iter;
-      Node::const_iterator title_block_it = find(pcb, "title_block"sv);
-      if (title_block_it != pcb.end()) {
-         Node::const_iterator title_it = find(*title_block_it, "title"sv);
-         if (title_it != title_block_it->end()) {
-            const Node& title = *title_it;
-            if (title.size() >= 2) {
-               window_title = title[1].text();
+void KiViewApp::install_board_(Board&& board) {
+   board_ = std::move(board);
+   board_bounds_ = board_.bounds;
+   ground_net_ = board_.model->find_net("GND"sv);
+   update_hidden_items_();
+
+   if (!board_.cache_error.empty()) {
+      be_warn() << "Could not write board cache"
+         & attr(ids::log_attr_message) << board_.cache_error
+         & attr(ids::log_attr_path) << BoardCache::path(filename_)
+         | default_log();
+   }
+
+   S window_title = "KiView - " + board_.title;
+   glfwSetWindowTitle(wnd_, window_title.c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// When reloading, the current board and meshes stay in place until the
+// loader hands over their replacements.
+void KiViewApp::start_load_(std::unique_ptr<PreviousBoard> previous) {
+   cancel_load_();
+   if (!previous) {
+      invalidate_meshes_();
+   }
+
+   BoardLoader::View view;
+   view.back = flipped_;
+   view.skip_zones = skip_zones_;
+   view.lod_pixels = lod_pixels_;
+   view.scale = enable_autoscale_ ? 0.f : scale_;
+   view.center = center_;
+   view.autocenter = enable_autocenter_;
+   view.viewport = viewport_;
+   view.highlight_nets = highlight_nets_;
+   view.highlight_modules = highlight_modules_;
+   for (std::size_t t = 0; t < (std::size_t)layer_mesh::count; ++t) {
+      for (std::size_t f = 0; f < 2; ++f) {
+         view.generations[t][f] = meshes_[t][f].generation;
+      }
+   }
+   if (previous) {
+      view.densities = mesh_settings_().densities;
+      view.region = mesh_region_;
+      info_ = "Reloading " + filename_;
+   } else {
+      info_ = "Loading " + filename_;
+   }
+
+   loader_ = std::make_unique<BoardLoader>(filename_, use_cache_, std::move(view), std::move(previous), []() {
+      glfwPostEmptyEvent();
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void KiViewApp::poll_load_() {
+   if (!loader_) {
+      return;
+   }
+
+   BoardLoader::Delivery delivery = loader_->poll();
+   if (delivery.view_ready) {
+      board_bounds_ = delivery.bounds;
+      lod_error_ = delivery.lod_error;
+      mesh_region_ = delivery.mesh_region;
+      autoscale_();
+      mesh_scale_ = scale_;
+   }
+
+   // a reloaded board's selection is carried over from the current board,
+   // and its patches are spliced into the current meshes
+   std::size_t n_previous = board_.item_hashes.size();
+   std::vector<be::U32> reused;
+   bool reloaded = delivery.board && loader_->previous();
+   if (reloaded) {
+      Board& board = *delivery.board;
+      std::vector<std::size_t> carried = carry_items(board.reused, n_previous);
+      std::vector<std::size_t> highlight_items = module_items(highlight_modules_, board_.tree);
+      skip_nets_ = remap_nets(skip_nets_, *board_.model, *board.model);
+      highlight_nets_ = remap_nets(highlight_nets_, *board_.model, *board.model);
+      reused = std::move(board.reused);
+      install_board_(std::move(board));
+      highlight_modules_ = carry_modules(highlight_items, carried, board_.tree);
+      autoscale_();
+   } else if (delivery.board) {
+      install_board_(std::move(*delivery.board));
+
+      // any valid meshes were built by mesh_() from the board it replaced
+      for (auto& meshes : meshes_) {
+         for (CachedMesh& mesh : meshes) {
+            if (mesh.valid) {
+               invalidate_mesh_(mesh);
             }
          }
       }
+   }
+
+   if (delivery.pick_grid) {
+      board_.pick_grid = std::move(*delivery.pick_grid);
+   }
 
-      for (auto& child : pcb) {
-         if (child.size() >= 3 && get_node_type(child) == node_type::n_net && child[2].text() == "GND"sv) {
-            ground_net_ = (be::U32)child[1].value();
+   bool patched[(std::size_t)layer_mesh::count][2] = { };
+   for (BoardLoader::Mesh& delivered : delivery.meshes) {
+      std::size_t t = (std::size_t)delivered.type;
+      std::size_t f = delivered.back ? 1 : 0;
+      if (install_mesh(meshes_[t][f], delivered, reused, n_previous) && delivered.patch) {
+         patched[t][f] = true;
+      }
+   }
+
+   // the rest are rebuilt once the loader is done
+   if (reloaded) {
+      for (std::size_t t = 0; t < (std::size_t)layer_mesh::count; ++t) {
+         for (std::size_t f = 0; f < 2; ++f) {
+            if (!patched[t][f]) {
+               invalidate_mesh_(meshes_[t][f]);
+            }
          }
       }
+   }
 
-      board_bounds_ = get_area(pcb);
+   if (!delivery.done) {
+      if (!input_enabled_) {
+         info_ = delivery.status;
+      }
+      return;
    }
 
-   window_title = "KiView - " + window_title;
+   using ms = std::chrono::duration<be::F64, std::milli>;
+   ms elapsed = loader_->elapsed();
+   bool reload = loader_->previous() != nullptr;
+   std::size_t changed_items = loader_->changed_items();
+   loader_.reset();
+
+   if (delivery.error && reload) {
+      try {
+         std::rethrow_exception(delivery.error);
+      } catch (const std::exception& e) {
+         board_ = Board();
+         hidden_items_.clear();
+         highlight_modules_.clear();
+         invalidate_meshes_();
+         be_warn() << "Could not reload board"
+            & attr(ids::log_attr_message) << S(e.what())
+            & attr(ids::log_attr_path) << filename_
+            | default_log();
+         info_ = "Reload failed: ";
+         info_.append(e.what());
+         return;
+      }
+   } else if (delivery.error) {
+      std::rethrow_exception(delivery.error);
+   }
 
-   glfwSetWindowTitle(wnd_, window_title.c_str());
+   if (!input_enabled_) {
+      std::ostringstream oss;
+      if (reload) {
+         oss << "Reloaded: " << changed_items << " of " << board_.model->size() << " items changed (" << elapsed.count() << " ms)";
+      } else {
+         oss << "Loaded in " << elapsed.count() << " ms";
+      }
+      info_ = oss.str();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void KiViewApp::cancel_load_() {
+   loader_.reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Board items are matched to the previous board by hashing their source
+// text; the BoardLoader copies unchanged items from the current model and only
+// tessellates changed ones, while the current board stays on screen.  The
+// file may already have been truncated or overwritten under the old tree's
+// mapping, so neither the loader nor the UI reads the old tree's text or parses
+// its deferred subtrees; what they need is read from the model, which holds
+// copies.  Selections are carried over by item index and net name.
+void KiViewApp::reload_() {
+   auto previous = std::make_unique<PreviousBoard>();
+   previous->item_hashes = board_.item_hashes;
+   previous->model = board_.model;
+   previous->highlight_items = module_items(highlight_modules_, board_.tree);
+   for (std::size_t t = 0; t < (std::size_t)layer_mesh::count; ++t) {
+      for (std::size_t f = 0; f < 2; ++f) {
+         const CachedMesh& mesh = meshes_[t][f];
+         // highlighted copper is built net by net rather than item by item, so it's just rebuilt
+         previous->patchable[t][f] = mesh.valid && mesh.item_ends.size() == board_.item_hashes.size()
+            && (layer_mesh)t != layer_mesh::highlighted_copper;
+      }
+   }
+   start_load_(std::move(previous));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -584,11 +657,40 @@ void KiViewApp::autoscale_() {
    }
 
    if (enable_autoscale_) {
-      vec2 scale = vec2(viewport_ - ivec2(0, 66)) * 0.98f / board_bounds_.dim;
-      scale_ = min(scale.x, scale.y);
+      scale_ = fit_scale(viewport_, board_bounds_);
    }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Rebuilds the meshes when zooming in would show their curves' facets, or
+// zooming out leaves them with four times the segments they need; and when
+// the view leaves the region they cover, or zooming in has shrunk it enough
+// that a smaller region would do.  Otherwise, the same meshes are drawn.
+void KiViewApp::update_mesh_view_() {
+   if (loader_) {
+      return; // its meshes are built for the view it expects
+   }
+
+   BoardModel::Bounds visible = view_bounds(center_, scale_, viewport_);
+   be::F32 error = lod_max_error(lod_pixels_, scale_);
+   be::F32 pixels = lod_error_ * scale_;
+   bool detail_ok = error == lod_error_ || (error > 0 && lod_error_ > 0 && pixels <= lod_pixels_ && pixels * 4.f >= lod_pixels_);
+   bool region_ok = mesh_region_.contains(visible) && scale_ <= mesh_scale_ * 2.f;
+   if (detail_ok && region_ok) {
+      return;
+   }
+
+   BoardModel::Bounds region = mesh_region(visible, board_bounds_);
+   mesh_scale_ = scale_;
+   if (error == lod_error_ && region.lo == mesh_region_.lo && region.hi == mesh_region_.hi) {
+      return;
+   }
+
+   lod_error_ = error;
+   mesh_region_ = region;
+   invalidate_meshes_();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void KiViewApp::select_at_(glm::vec2 pos) {
    face_type fg = flipped_ ? face_type::f_back : face_type::f_front;
@@ -597,118 +699,84 @@ void KiViewApp::select_at_(glm::vec2 pos) {
    highlight_nets_.clear();
    highlight_modules_.clear();
 
+   // while loading, the board arrives before its pick grid
+   const PickGrid* grid = board_.pick_grid.size() > 0 ? &board_.pick_grid : nullptr;
    be::F32 distance = 254.f / scale_;
-   const Node* selected = nullptr;
+   const Node* selected_module = nullptr;
+   be::U32 selected_net = BoardModel::none;
 
    if (!select_only_nets_) {
-      selected = find_closest_module(root_, pos, distance, fg);
+      selected_module = find_closest_module(*board_.model, grid, pos, distance, fg);
 
       if (see_thru_) {
-         be::F32 bg_distance = selected ? distance / 2.f : distance;
-         const Node* bg_selected = find_closest_module(root_, pos, bg_distance, bg);
+         be::F32 bg_distance = selected_module ? distance / 2.f : distance;
+         const Node* bg_selected = find_closest_module(*board_.model, grid, pos, bg_distance, bg);
          if (bg_selected) {
-            selected = bg_selected;
+            selected_module = bg_selected;
             distance = bg_distance;
          }
       }
    }
 
    if (!select_only_modules_ && (select_only_nets_ || !skip_copper_)) {
-      be::F32 cu_distance = selected ? distance / 2.f : distance;
-      const Node* cu_selected = find_closest_segment_or_via(root_, pos, cu_distance, fg, skip_nets_);
-      if (cu_selected) {
-         selected = cu_selected;
+      be::F32 cu_distance = selected_module ? distance / 2.f : distance;
+      be::U32 cu_selected = find_closest_copper(*board_.model, grid, pos, cu_distance, fg, skip_nets_, select_only_nets_);
+      if (cu_selected != BoardModel::none) {
+         selected_module = nullptr;
+         selected_net = cu_selected;
          distance = cu_distance;
       }
       
       if (see_thru_) {
-         be::F32 bg_distance = selected ? distance / 2.f : distance;
-         const Node* bg_selected = find_closest_segment_or_via(root_, pos, bg_distance, bg, skip_nets_);
-         if (bg_selected) {
-            selected = bg_selected;
+         be::F32 bg_distance = selected_module || selected_net != BoardModel::none ? distance / 2.f : distance;
+         be::U32 bg_selected = find_closest_copper(*board_.model, grid, pos, bg_distance, bg, skip_nets_, select_only_nets_);
+         if (bg_selected != BoardModel::none) {
+            selected_module = nullptr;
+            selected_net = bg_selected;
             distance = bg_distance;
          }
       }
    }
 
+   invalidate_meshes_(layer_mesh::highlighted_copper);
+   invalidate_meshes_(layer_mesh::highlighted_pads);
+
    select_only_modules_ = false;
    select_only_nets_ = false;
    input_enabled_ = false;
    info_ = "Nothing to select";
-   if (selected) {
-      if (get_node_type(*selected) == node_type::n_module) {
-         highlight_modules_.insert(selected);
-         info_ = "Selected Module";
-      } else {
-         auto it = find(*selected, "net"sv);
-         if (it != selected->end()) {
-            const Node& net = *it;
-            if (net.size() >= 2) {
-               be::U32 n = (be::U32)net[1].value();
-               highlight_nets_.insert(n);
-               info_ = "Selected Net";
-            }
-         }
-      }
+   if (selected_module) {
+      highlight_modules_.insert(selected_module);
+      info_ = "Selected Module";
+   } else if (selected_net != BoardModel::none) {
+      highlight_nets_.insert(selected_net);
+      info_ = "Selected Net";
    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void KiViewApp::select_all_like_(const Node& mod) {
-   SV footprint = mod.size() >= 2 ? mod[1].text() : ""sv;
-   char ref_type = 0;
-   SV value_text = ""sv;
-   F64 value = -1.f;
-
-   for (auto& child : mod) {
-      if (get_node_type(child) == node_type::n_fp_text) {
-         if (child.size() >= 3) {
-            if (child[1].text() == "reference"sv) {
-               if (!child[2].text().empty()) {
-                  ref_type = child[2].text()[0];
-               }
-            } else if (child[1].text() == "value"sv) {
-               value_text = child[2].text();
-               value = child[2].value();
-            }
-         }
-      }
-   }
+// Modules match if they have the same footprint, value and reference prefix.
+void KiViewApp::select_all_like_(be::U32 module) {
+   const BoardModel::Modules& modules = board_.model->modules;
+   const S& footprint = modules.name[module];
+   const S& value = modules.value[module];
+   const S& reference = modules.reference[module];
 
    highlight_nets_.clear();
    highlight_modules_.clear();
 
-   auto pcb = find(root_, "kicad_pcb"sv);
-   if (pcb != root_.end()) {
-      for (const Node& child : *pcb) {
-         if (get_node_type(child) == node_type::n_module && child.size() >= 2 && child[1].text() == footprint) {
-            bool found_value = false;
-            bool found_ref = false;
-            for (const Node& mod_child : child) {
-               if (get_node_type(mod_child) == node_type::n_fp_text) {
-                  if (mod_child.size() >= 3) {
-                     if (mod_child[1].text() == "reference"sv) {
-                        if (!mod_child[2].text().empty()) {
-                           if (ref_type == mod_child[2].text()[0]) {
-                              found_ref = true;
-                           }
-                        }
-                     } else if (mod_child[1].text() == "value"sv) {
-                        if (value_text == mod_child[2].text() && value == mod_child[2].value()) {
-                           found_value = true;
-                        }
-                     }
-                  }
-               }
-            }
-
-            if (found_value && found_ref) {
-               highlight_modules_.insert(&child);
-            }
+   if (!reference.empty()) {
+      for (std::size_t i = 0, n = modules.node.size(); i < n; ++i) {
+         if (modules.name[i] == footprint && modules.value[i] == value
+             && !modules.reference[i].empty() && modules.reference[i][0] == reference[0]) {
+            highlight_modules_.insert(modules.node[i]);
          }
       }
    }
 
+   invalidate_meshes_(layer_mesh::highlighted_copper);
+   invalidate_meshes_(layer_mesh::highlighted_pads);
+
    std::ostringstream oss;
    if (highlight_modules_.size() == 1) {
       oss << "Found 1 similar module";
@@ -769,6 +837,7 @@ void KiViewApp::process_command_(be::SV full_command) {
 
          case 'z':
             skip_zones_ = !skip_zones_;
+            invalidate_meshes_(layer_mesh::copper);
             info_ = skip_zones_ ? "Zones hidden" : "Zones shown";
             break;
 
@@ -788,7 +857,10 @@ void KiViewApp::process_command_(be::SV full_command) {
             if (highlight_modules_.empty()) {
                info_ = "No modules selected";
             } else {
-               select_all_like_(**highlight_modules_.begin());
+               be::U32 module = board_.model->find_module(*highlight_modules_.begin());
+               if (module != BoardModel::none) {
+                  select_all_like_(module);
+               }
             }
             break;
 
@@ -800,11 +872,13 @@ void KiViewApp::process_command_(be::SV full_command) {
             break;
 
          case 'g':
-            if (skip_nets_.count(ground_net_) > 0) {
-               skip_nets_.erase(ground_net_);
+            if (ground_net_ == BoardModel::none) {
+               info_ = "No ground net";
+            } else if (skip_nets_.count(ground_net_) > 0) {
+               hide_net_(ground_net_, false);
                info_ = "Ground Copper Shown";
             } else {
-               skip_nets_.insert(ground_net_);
+               hide_net_(ground_net_, true);
                info_ = "Ground Copper Hidden";
             }
             break;
@@ -824,16 +898,25 @@ void KiViewApp::process_command_(be::SV full_command) {
       set_segment_density_(params, arc_segment_density, " edges/circle");
    } else if (cmd_lower == "zone_endcap_density"sv) {
       set_segment_density_(params, zone_perimeter_endcap_segment_density, " edges/zone border endcap");
+   } else if (cmd_lower == "lod"sv) {
+      set_lod_(params);
    } else if (cmd_lower == "hide"sv) {
       if (highlight_nets_.empty()) {
          info_ = "No selected nets to hide";
       } else {
-         skip_nets_.insert(highlight_nets_.begin(), highlight_nets_.end());
+         for (be::U32 net : highlight_nets_) {
+            hide_net_(net, true);
+         }
          highlight_nets_.clear();
+         invalidate_meshes_(layer_mesh::highlighted_copper);
          info_ = "Selected nets hidden";
       }
+   } else if (cmd_lower == "reload"sv) {
+      reload_();
    } else if (cmd_lower == "clear_hidden_nets") {
-      skip_nets_.clear();
+      while (!skip_nets_.empty()) {
+         hide_net_(*skip_nets_.begin(), false);
+      }
       info_ = "No hidden nets";
    } else {
       info_ = "Unknown command: ";
@@ -847,6 +930,7 @@ void KiViewApp::set_segment_density_(be::SV params, void(*fp)(be::U32), be::SV l
    be::U32 segments = util::parse_bounded_numeric_string<be::U32>(params, 0, 360, ec);
    if (!ec) {
       fp(segments);
+      invalidate_meshes_();
       std::ostringstream oss;
       oss << segments << label;
       info_ = oss.str();
@@ -855,6 +939,187 @@ void KiViewApp::set_segment_density_(be::SV params, void(*fp)(be::U32), be::SV l
    }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// With a max error of 0 pixels, the densities are used as they are.
+void KiViewApp::set_lod_(be::SV params) {
+   std::error_code ec;
+   be::F32 pixels = util::parse_bounded_numeric_string<be::F32>(params, 0.f, 16.f, ec);
+   if (!ec) {
+      lod_pixels_ = pixels;
+      lod_error_ = lod_max_error(pixels, scale_);
+      invalidate_meshes_();
+      std::ostringstream oss;
+      if (pixels > 0) {
+         oss << "Curves within " << pixels << " pixels";
+      } else {
+         oss << "Automatic level of detail off";
+      }
+      info_ = oss.str();
+   } else {
+      info_ = "Failed to parse number!";
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshSettings KiViewApp::mesh_settings_() {
+   SegmentDensities densities = segment_densities();
+   densities.max_error = lod_error_;
+   return MeshSettings { skip_zones_, &highlight_nets_, &highlight_modules_, densities, mesh_region_ };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Builds every invalid mesh render_() will draw in one pass, so that showing
+// more layers doesn't mean more passes over the board.
+void KiViewApp::build_visible_meshes_() {
+   std::vector<MeshTarget> targets;
+   auto want = [&](layer_mesh type, bool back) {
+      CachedMesh& mesh = meshes_[(std::size_t)type][back ? 1 : 0];
+      if (!mesh.valid) {
+         targets.push_back(MeshTarget { type, back, &mesh });
+      }
+   };
+
+   for (bool back : { flipped_, !flipped_ }) {
+      if (back != flipped_ && !see_thru_) {
+         continue;
+      }
+      if (!skip_copper_) {
+         want(layer_mesh::copper, back);
+      }
+      want(layer_mesh::pads, back);
+      want(layer_mesh::highlighted_copper, back);
+      want(layer_mesh::highlighted_pads, back);
+   }
+   if (!skip_silk_) {
+      want(layer_mesh::silk, flipped_);
+   }
+   want(layer_mesh::holes, false);
+   want(layer_mesh::edge_cuts, false);
+
+   build_meshes(*board_.model, targets, mesh_settings_());
+   for (MeshTarget& target : targets) {
+      target.mesh->valid = true;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const CachedMesh& KiViewApp::mesh_(layer_mesh type, bool back) {
+   if (type == layer_mesh::holes || type == layer_mesh::edge_cuts) {
+      back = false; // not face-dependent
+   }
+
+   CachedMesh& mesh = meshes_[(std::size_t)type][back ? 1 : 0];
+   if (mesh.valid) {
+      return mesh;
+   }
+
+   if (loader_) {
+      // while loading, meshes are empty until the loader delivers them, but
+      // those invalidated since it started, like toggled highlights, are
+      // built from the installed board
+      if (mesh.generation != loader_->generation(type, back)) {
+         build_meshes(*board_.model, { MeshTarget { type, back, &mesh } }, mesh_settings_());
+         mesh.valid = true;
+      }
+      return mesh;
+   }
+
+   build_visible_meshes_();
+   if (!mesh.valid) {
+      build_meshes(*board_.model, { MeshTarget { type, back, &mesh } }, mesh_settings_());
+      mesh.valid = true;
+   }
+   return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Instanced pads, vias and holes are drawn after the rest of the mesh; they
+// share its color, so the order doesn't show.
+void KiViewApp::draw_mesh_(layer_mesh type, bool back, glm::vec4 color, bool skip_hidden) {
+   static const std::vector<bool> nothing_hidden;
+   const CachedMesh& mesh = mesh_(type, back);
+   const std::vector<bool>& hidden_items = skip_hidden ? hidden_items_ : nothing_hidden;
+
+   if (type == layer_mesh::holes || type == layer_mesh::edge_cuts) {
+      back = false;
+   }
+   be::U32 hidden_version = skip_hidden ? hidden_version_ : 0;
+   if (MeshBuffers::supported()) {
+      MeshBuffers& buffers = mesh_buffers_[(std::size_t)type][back ? 1 : 0];
+      buffers.update(mesh.mesh, mesh.item_ends, hidden_items, mesh.revision, hidden_version);
+      glColor4fv(glm::value_ptr(color));
+      buffers.draw(wireframe_);
+   } else {
+      draw_layer(mesh.mesh, mesh.item_ends, hidden_items, color, wireframe_);
+   }
+
+   ShapeBuffers& buffers = shape_buffers_[(std::size_t)type][back ? 1 : 0];
+   buffers.update(*shape_renderer_, mesh.shapes, mesh.instance_ends, hidden_items, hidden_version);
+   draw_layer(buffers.expanded(), color, wireframe_);
+   buffers.draw(*shape_renderer_, wireframe_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void KiViewApp::invalidate_mesh_(CachedMesh& mesh) {
+   ++mesh.generation;
+   mesh.revision = new_mesh_revision();
+   mesh.valid = false;
+   mesh.mesh.clear();
+   mesh.item_ends.clear();
+   mesh.shapes.clear();
+   mesh.instance_ends.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void KiViewApp::invalidate_meshes_(layer_mesh type) {
+   for (CachedMesh& mesh : meshes_[(std::size_t)type]) {
+      invalidate_mesh_(mesh);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void KiViewApp::invalidate_meshes_() {
+   for (std::size_t i = 0; i < (std::size_t)layer_mesh::count; ++i) {
+      invalidate_meshes_((layer_mesh)i);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Hiding a net only marks its items, so that the copper meshes don't need to
+// be rebuilt.  Pads aren't in the copper meshes, so they aren't marked.
+void KiViewApp::hide_net_(be::U32 net, bool hidden) {
+   if (hidden) {
+      skip_nets_.insert(net);
+   } else {
+      skip_nets_.erase(net);
+   }
+   ++hidden_version_;
+
+   const BoardModel& model = *board_.model;
+   if (net >= model.nets.number.size()) {
+      return;
+   }
+
+   auto mark = [&](BoardModel::Span span, const std::vector<be::U32>& items) {
+      for (be::U32 m = span.begin, end = span.begin + span.count; m < end; ++m) {
+         hidden_items_[items[model.net_members[m]]] = hidden;
+      }
+   };
+
+   mark(model.nets.segments[net], model.segments.item);
+   mark(model.nets.vias[net], model.vias.item);
+   mark(model.nets.zones[net], model.zones.item);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void KiViewApp::update_hidden_items_() {
+   hidden_items_.assign(board_.model->size(), false);
+   ++hidden_version_;
+   for (be::U32 net : skip_nets_) {
+      hide_net_(net, true);
+   }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void KiViewApp::render_() {
    glClear(GL_COLOR_BUFFER_BIT);
@@ -907,32 +1172,31 @@ void KiViewApp::render_() {
    glm::vec4 chf = glm::vec4(glm::mix(ch[0], ch[1], fv), 1.f);
    glm::vec4 phf = glm::vec4(glm::mix(ph[0], ph[1], fv), 1.f);
    
-   face_type foreground = flipped_ ? face_type::f_back : face_type::f_front;
-   face_type background = flipped_ ? face_type::f_front: face_type::f_back;
-   
+   bool back = flipped_;
+
    if (see_thru_) {
       if (!skip_copper_) {
-         draw_layer(root_, CopperConfig { background, skip_zones_, &skip_nets_, nullptr }, cb, wireframe_);
+         draw_mesh_(layer_mesh::copper, !back, cb, true);
       }
-      draw_layer(root_, ModuleConfig { background, false, nullptr }, cb, wireframe_);
-      draw_layer(root_, CopperConfig { background, false, false, &highlight_nets_ }, chb, wireframe_);
-      draw_layer(root_, ModuleConfig { background, true, &highlight_modules_ }, phb, wireframe_);
+      draw_mesh_(layer_mesh::pads, !back, cb);
+      draw_mesh_(layer_mesh::highlighted_copper, !back, chb);
+      draw_mesh_(layer_mesh::highlighted_pads, !back, phb);
    }
 
    if (!skip_copper_) {
-      draw_layer(root_, CopperConfig { foreground, skip_zones_, &skip_nets_, nullptr }, cf, wireframe_);
+      draw_mesh_(layer_mesh::copper, back, cf, true);
    }
       
-   draw_layer(root_, ModuleConfig { foreground, false, nullptr }, pf, wireframe_);
-   draw_layer(root_, CopperConfig { foreground, false, false, &highlight_nets_ }, chf, wireframe_);
-   draw_layer(root_, ModuleConfig { foreground, true, &highlight_modules_ }, phf, wireframe_);
+   draw_mesh_(layer_mesh::pads, back, pf);
+   draw_mesh_(layer_mesh::highlighted_copper, back, chf);
+   draw_mesh_(layer_mesh::highlighted_pads, back, phf);
 
    if (!skip_silk_) {
-      draw_layer(root_, StandardConfig { foreground, layer_type::l_silk }, silk, wireframe_);
+      draw_mesh_(layer_mesh::silk, back, silk);
    }
 
-   draw_layer(root_, HoleConfig(), hf, wireframe_);
-   draw_layer(root_, StandardConfig { face_type::any, layer_type::l_cuts }, edge_cuts, wireframe_);
+   draw_mesh_(layer_mesh::holes, back, hf);
+   draw_mesh_(layer_mesh::edge_cuts, back, edge_cuts);
 
 
    view = glm::scale(mat4(), vec3(3.f));
@@ -970,64 +1234,20 @@ void KiViewApp::render_() {
    draw_text(oss.str(), vec2(bounds.x - 2.f, 2.f), Alignment::right, text_color, false);
 
    // Bottom row: selection <ref>      <value>     <x>, <y>       <F/B> <T> <S> <C> <Z>
-   if (highlight_modules_.size() == 1 && highlight_nets_.empty()) {
-      const Node* mod = *highlight_modules_.begin();
-
-      auto it = find(*mod, "at"sv);
-      if (it != mod->end()) {
-         auto& at = *it;
-         if (at.size() >= 3) {
-            be::F32 x = (be::F32)at[1].value();
-            be::F32 y = (be::F32)at[2].value();
-
-            oss.str("");
-            oss << x << ", " << y;
-            draw_text(oss.str(), vec2(bounds.x * 2.f / 3.f, bounds.y - text_bg_height + 2.f), Alignment::center, text_color, false);
-         }
-      }
-
-      for (auto& child : *mod) {
-         if (get_node_type(child) == node_type::n_fp_text) {
-            if (child.size() >= 3) {
-               if (child[1].text() == "reference"sv) {
-                  S text(child[2].text());
-                  if (text.empty()) {
-                     oss.str("");
-                     oss << child[2].value();
-                     text = oss.str();
-                  }
-                  draw_text(text, vec2(2.f, bounds.y - text_bg_height + 2.f), Alignment::left, text_color, false);
-               } else if (child[1].text() == "value"sv) {
-                  S text(child[2].text());
-                  if (text.empty()) {
-                     oss.str("");
-                     oss << child[2].value();
-                     text = oss.str();
-                  }
-                  draw_text(text, vec2(bounds.x / 3.f, bounds.y - text_bg_height + 2.f), Alignment::center, text_color, false);
-               }
-            }
-         }
-      }
-
+   // read from the model, since the file may have changed under the tree
+   be::U32 module = highlight_modules_.size() == 1 && highlight_nets_.empty() ? board_.model->find_module(*highlight_modules_.begin()) : BoardModel::none;
+   if (module != BoardModel::none) {
+      const BoardModel::Modules& modules = board_.model->modules;
+      glm::vec2 at = modules.at[module];
+      oss.str("");
+      oss << at.x << ", " << at.y;
+      draw_text(oss.str(), vec2(bounds.x * 2.f / 3.f, bounds.y - text_bg_height + 2.f), Alignment::center, text_color, false);
+      draw_text(modules.reference[module], vec2(2.f, bounds.y - text_bg_height + 2.f), Alignment::left, text_color, false);
+      draw_text(modules.value[module], vec2(bounds.x / 3.f, bounds.y - text_bg_height + 2.f), Alignment::center, text_color, false);
    } else if (highlight_modules_.empty() && highlight_nets_.size() == 1) {
       U32 net = *highlight_nets_.begin();
-      
-      auto pcb = find(root_, "kicad_pcb"sv);
-      if (pcb != root_.end()) {
-         for (const Node& child : *pcb) {
-            if (get_node_type(child) == node_type::n_net) {
-               if (child.size() >= 3 && (be::U32)child[1].value() == net) {
-                  S text(child[2].text());
-                  if (text.empty()) {
-                     oss.str("");
-                     oss << child[2].value();
-                     text = oss.str();
-                  }
-                  draw_text(text, vec2(2.f, bounds.y - text_bg_height + 2.f), Alignment::left, text_color, false);
-               }
-            }
-         }
+      if (net < board_.model->nets.name.size()) {
+         draw_text(board_.model->nets.name[net], vec2(2.f, bounds.y - text_bg_height + 2.f), Alignment::left, text_color, false);
       }
    }
 
@@ -0,0 +1,119 @@
+#include "mapped_file.hpp"
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile(const be::S& path, bool copy_on_write) {
+#ifdef _WIN32
+   HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+   if (file == INVALID_HANDLE_VALUE) {
+      throw std::system_error((int)GetLastError(), std::system_category(), "Could not open " + path);
+   }
+
+   LARGE_INTEGER file_size;
+   if (!GetFileSizeEx(file, &file_size)) {
+      DWORD error = GetLastError();
+      CloseHandle(file);
+      throw std::system_error((int)error, std::system_category(), "Could not determine size of " + path);
+   }
+
+   if (file_size.QuadPart == 0) {
+      CloseHandle(file);
+      return;
+   }
+
+   HANDLE mapping = CreateFileMappingA(file, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+   DWORD error = GetLastError();
+   CloseHandle(file);
+   if (!mapping) {
+      throw std::system_error((int)error, std::system_category(), "Could not map " + path);
+   }
+
+   void* view = MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+   error = GetLastError();
+   CloseHandle(mapping); // the view keeps the mapping alive
+   if (!view) {
+      throw std::system_error((int)error, std::system_category(), "Could not map " + path);
+   }
+
+   data_ = static_cast<char*>(view);
+   size_ = (std::size_t)file_size.QuadPart;
+#else
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "Could not open " + path);
+   }
+
+   struct stat st;
+   if (::fstat(fd, &st) != 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "Could not determine size of " + path);
+   }
+
+   if (st.st_size == 0) {
+      ::close(fd);
+      return;
+   }
+
+   int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+   void* view = ::mmap(nullptr, (std::size_t)st.st_size, prot, MAP_PRIVATE, fd, 0);
+   int error = errno;
+   ::close(fd); // the mapping keeps the file alive
+   if (view == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(), "Could not map " + path);
+   }
+
+   // copy-on-write views hold data structures which won't be read in order
+   ::madvise(view, (std::size_t)st.st_size, copy_on_write ? MADV_WILLNEED : MADV_SEQUENTIAL);
+
+   data_ = static_cast<char*>(view);
+   size_ = (std::size_t)st.st_size;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile(MappedFile&& other) noexcept
+   : data_(std::exchange(other.data_, nullptr)),
+     size_(std::exchange(other.size_, 0)) { }
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+   if (this != &other) {
+      close_();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+   }
+   return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile() {
+   close_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MappedFile::close_() noexcept {
+   if (data_) {
+#ifdef _WIN32
+      UnmapViewOfFile(data_);
+#else
+      ::munmap(data_, size_);
+#endif
+      data_ = nullptr;
+      size_ = 0;
+   }
+}
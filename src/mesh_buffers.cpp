@@ -0,0 +1,184 @@
+#include "mesh_buffers.hpp"
+#include <be/gfx/bgl.hpp>
+#include <algorithm>
+#include <vector>
+
+using namespace be::gfx::gl;
+
+///////////////////////////////////////////////////////////////////////////////
+MeshBuffers::~MeshBuffers() {
+   release_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshBuffers::MeshBuffers(MeshBuffers&& other) noexcept
+   : vertex_buffer_(other.vertex_buffer_),
+     index_buffer_(other.index_buffer_),
+     batches_(std::move(other.batches_)),
+     triangles_(other.triangles_),
+     index_size_(other.index_size_),
+     draws_(std::move(other.draws_)),
+     revision_(other.revision_),
+     hidden_version_(other.hidden_version_) {
+   other.vertex_buffer_ = 0;
+   other.index_buffer_ = 0;
+   other.revision_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshBuffers& MeshBuffers::operator=(MeshBuffers&& other) noexcept {
+   if (this != &other) {
+      release_();
+      vertex_buffer_ = other.vertex_buffer_;
+      index_buffer_ = other.index_buffer_;
+      batches_ = std::move(other.batches_);
+      triangles_ = other.triangles_;
+      index_size_ = other.index_size_;
+      draws_ = std::move(other.draws_);
+      revision_ = other.revision_;
+      hidden_version_ = other.hidden_version_;
+      other.vertex_buffer_ = 0;
+      other.index_buffer_ = 0;
+      other.revision_ = 0;
+   }
+   return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool MeshBuffers::supported() noexcept {
+   return GL_VERSION_1_5;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MeshBuffers::update(const IndexedMesh& mesh, const std::vector<be::U32>& item_ends,
+                         const std::vector<bool>& hidden_items, be::U64 revision, be::U32 hidden_version) {
+   if (!supported() || (revision_ == revision && hidden_version_ == hidden_version)) {
+      return;
+   }
+
+   if (revision_ != revision) {
+      triangles_ = (be::U32)mesh.triangles();
+      batches_.clear();
+      index_size_ = sizeof(be::U16);
+
+      // a batch starts wherever a triangle's indices don't fit the current one
+      std::vector<be::U16> indices(mesh.indices.size());
+      be::U32 first_vertex = 0;
+      for (std::size_t t = 0; t < triangles_; ++t) {
+         const be::U32* tri = mesh.indices.data() + t * 3;
+         be::U32 lo = std::min({ tri[0], tri[1], tri[2] });
+         be::U32 hi = std::max({ tri[0], tri[1], tri[2] });
+         if (batches_.empty() || lo < first_vertex || hi - first_vertex > 0xffff) {
+            if (hi - lo > 0xffff) {
+               index_size_ = sizeof(be::U32);
+               batches_.assign(1, Batch { 0, 0 });
+               break;
+            }
+            first_vertex = lo;
+            batches_.push_back(Batch { (be::U32)t, first_vertex });
+         }
+         for (std::size_t k = 0; k < 3; ++k) {
+            indices[t * 3 + k] = (be::U16)(tri[k] - first_vertex);
+         }
+      }
+
+      //#bgl checked(GL_VERSION_1_5)
+      if (!vertex_buffer_) {
+         glGenBuffers(1, &vertex_buffer_);
+         glGenBuffers(1, &index_buffer_);
+      }
+
+      glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+      glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(mesh.vertices.size() * sizeof(glm::vec2)), mesh.vertices.data(), GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+      if (index_size_ == sizeof(be::U16)) {
+         glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(be::U16)), indices.data(), GL_STATIC_DRAW);
+      } else {
+         glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(mesh.indices.size() * sizeof(be::U32)), mesh.indices.data(), GL_STATIC_DRAW);
+      }
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+      //#bgl unchecked
+
+      revision_ = revision;
+   }
+
+   hidden_version_ = hidden_version;
+   draws_.clear();
+
+   // runs of shown triangles, split where batches begin
+   auto add_run = [&](be::U32 begin, be::U32 end) {
+      for (std::size_t b = 0, n = batches_.size(); b < n && begin < end; ++b) {
+         be::U32 batch_end = b + 1 < n ? batches_[b + 1].first_triangle : triangles_;
+         if (begin < batch_end) {
+            be::U32 run_end = std::min(end, batch_end);
+            draws_.push_back(Draw { batches_[b].first_vertex, begin * 3, (run_end - begin) * 3 });
+            begin = run_end;
+         }
+      }
+   };
+
+   if (item_ends.size() != hidden_items.size()) {
+      add_run(0, triangles_);
+      return;
+   }
+
+   be::U32 run = 0;
+   be::U32 item = 0;
+   for (std::size_t i = 0, n = item_ends.size(); i < n; ++i) {
+      be::U32 end = item_ends[i];
+      if (hidden_items[i]) {
+         add_run(run, item);
+         run = end;
+      }
+      item = end;
+   }
+   add_run(run, triangles_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MeshBuffers::draw(bool wireframe) const {
+   if (draws_.empty() || !supported()) {
+      return;
+   }
+
+   //#bgl checked(GL_VERSION_1_5)
+   if (wireframe) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+   }
+
+   glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+   glEnableClientState(GL_VERTEX_ARRAY);
+
+   GLenum index_type = index_size_ == sizeof(be::U16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+   be::U32 first_vertex = ~(be::U32)0;
+   for (const Draw& draw : draws_) {
+      if (draw.first_vertex != first_vertex) {
+         first_vertex = draw.first_vertex;
+         glVertexPointer(2, GL_FLOAT, sizeof(glm::vec2), (const void*)(first_vertex * sizeof(glm::vec2)));
+      }
+      glDrawElements(GL_TRIANGLES, (GLsizei)draw.indices, index_type, (const void*)((std::size_t)draw.first_index * index_size_));
+   }
+
+   glDisableClientState(GL_VERTEX_ARRAY);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   if (wireframe) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+   }
+   //#bgl unchecked
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MeshBuffers::release_() noexcept {
+   if (vertex_buffer_) {
+      //#bgl checked(GL_VERSION_1_5)
+      glDeleteBuffers(1, &vertex_buffer_);
+      glDeleteBuffers(1, &index_buffer_);
+      //#bgl unchecked
+      vertex_buffer_ = 0;
+      index_buffer_ = 0;
+   }
+}
@@ -0,0 +1,64 @@
+#include "parse_lazy.hpp"
+#include <be/core/logging.hpp>
+#include <exception>
+
+///////////////////////////////////////////////////////////////////////////////
+Node& LazySubtree::materialize_() noexcept {
+   std::lock_guard<std::mutex> lock(context_->mutex);
+   Node* root = root_.load(std::memory_order_relaxed);
+   if (!root) {
+      try {
+         tree_ = parse(text_, context_->si, true, context_->classifier);
+         Node& parsed = tree_.root();
+         if (!parsed.empty() && parsed[0].type() == Node::node_type::sexpr) {
+            root = &parsed[0];
+         } else {
+            report_failure_("Deferred text is not a sexpr");
+         }
+      } catch (const std::exception& e) {
+         report_failure_(e.what());
+      } catch (...) {
+         report_failure_("Unexpected exception");
+      }
+
+      if (!root) {
+         root = &empty_;
+      }
+      root_.store(root, std::memory_order_release);
+   }
+   return *root;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void LazySubtree::report_failure_(const char* what) const noexcept {
+   using namespace be;
+   try {
+      be_warn() << "Could not parse deferred subtree"
+         & attr(ids::log_attr_message) << S(what)
+         & attr("Keyword") << S(car_)
+         | default_log();
+   } catch (...) { }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+NodeTree parse_lazy(be::SV text, be::util::StringInterner& si, NodeClassifier classifier, LazyPredicate defer) {
+   return parse_lazy(text, si, std::make_shared<LazyContext>(si, classifier), defer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+NodeTree parse_lazy(be::SV text, be::util::StringInterner& si, const std::shared_ptr<LazyContext>& context, LazyPredicate defer) {
+   {
+      NodeTreeBuilder builder(context->classifier);
+      builder.set_lazy(context, defer);
+      builder.reserve(text.size() / 8);
+      if (parse_indexed(text, si, true, builder)) {
+         return builder.finish();
+      }
+   }
+
+   NodeTreeBuilder builder(context->classifier);
+   builder.set_lazy(context, defer);
+   builder.reserve(text.size() / 8);
+   parse_scalar_into(text, si, true, builder);
+   return builder.finish();
+}
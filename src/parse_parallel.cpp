@@ -0,0 +1,182 @@
+#include "parse_parallel.hpp"
+#include "parallel.hpp"
+#include "sexpr_scan.hpp"
+#include <deque>
+
+///////////////////////////////////////////////////////////////////////////////
+// Joins trees parsed from consecutive slices of a sexpr's contents into the
+// tree parse() would have built for the whole sexpr.  The arena layout is
+// post-order, so the parts' descendants come first, followed by all of the
+// parts' top-level nodes (which become the sexpr's children), the sexpr, and
+// finally the root.
+class NodeTreeSplicer final {
+public:
+   static NodeTree splice(std::vector<NodeTree>& parts, be::SV source, be::util::StringInterner& si) {
+      std::size_t n_parts = parts.size();
+      std::vector<std::size_t> desc_base(n_parts + 1, 0);
+      std::vector<std::size_t> child_base(n_parts + 1, 0);
+      be::U8 keyword = 0;
+      bool found_car = false;
+
+      for (std::size_t p = 0; p < n_parts; ++p) {
+         const std::vector<Node>& src = parts[p].nodes_;
+         std::size_t children = src.back().size_;
+         desc_base[p + 1] = desc_base[p] + src.size() - 1 - children;
+         child_base[p + 1] = child_base[p] + children;
+         if (!found_car && children > 0) {
+            // each part's root was classified by the same first atom the outer sexpr would be
+            keyword = src.back().keyword_;
+            found_car = true;
+         }
+      }
+
+      std::size_t n_desc = desc_base[n_parts];
+      std::size_t n_children = child_base[n_parts];
+      std::size_t sexpr_index = n_desc + n_children;
+      std::vector<Node> nodes(sexpr_index + 2);
+      std::vector<std::vector<std::size_t>> foreign(n_parts);
+
+      parallel_for(n_parts, [&](std::size_t p) {
+         const std::vector<Node>& src = parts[p].nodes_;
+         std::size_t src_children = src.size() - 1 - src.back().size_;
+         for (std::size_t i = 0, n = src.size() - 1; i < n; ++i) {
+            std::size_t dest = i < src_children
+               ? desc_base[p] + i
+               : n_desc + child_base[p] + (i - src_children);
+
+            Node& node = nodes[dest];
+            node = src[i];
+            if (node.type_ == Node::node_type::text) {
+               const char* data = reinterpret_cast<const char*>(&src[i]) + src[i].offset_;
+               node.offset_ = data - reinterpret_cast<const char*>(&node);
+               if (data < source.data() || data >= source.data() + source.size()) {
+                  foreign[p].push_back(dest);
+               }
+            } else if (node.type_ == Node::node_type::sexpr && !node.lazy_ && i >= src_children) {
+               std::ptrdiff_t first_child = (std::ptrdiff_t)(i + desc_base[p]) + src[i].offset_;
+               node.offset_ = first_child - (std::ptrdiff_t)dest;
+            }
+         }
+      });
+
+      // text interned while parsing a part lives in that part's interner
+      for (const std::vector<std::size_t>& indices : foreign) {
+         for (std::size_t index : indices) {
+            Node& node = nodes[index];
+            be::SV text = si(node.text());
+            node.offset_ = text.data() - reinterpret_cast<const char*>(&node);
+         }
+      }
+
+      Node& sexpr = nodes[sexpr_index];
+      sexpr.offset_ = (std::ptrdiff_t)n_desc - (std::ptrdiff_t)sexpr_index;
+      sexpr.size_ = (be::U32)n_children;
+      sexpr.keyword_ = keyword;
+
+      Node& root = nodes[sexpr_index + 1];
+      root.offset_ = -1;
+      root.size_ = 1;
+
+      NodeTree tree(std::move(nodes));
+      for (NodeTree& part : parts) {
+         std::move(part.deferred_.begin(), part.deferred_.end(), std::back_inserter(tree.deferred_));
+      }
+      return tree;
+   }
+};
+
+namespace {
+
+constexpr std::size_t min_chunk_size = 0x40000;
+
+///////////////////////////////////////////////////////////////////////////////
+// Finds the bounds of the outer sexpr's contents and the positions of some of
+// its children, roughly chunk_size bytes apart, at which it can be split.
+// Since scan_sexpr() follows parse_scalar()'s states, each boundary is a '('
+// which it would open at depth 1 with no atom or quote in progress.
+// Boundaries must also follow whitespace or ')' so that the atom before them
+// ends within the previous chunk.  Returns false if the text isn't one sexpr,
+// optionally surrounded by whitespace.
+bool find_chunks(be::SV text, std::size_t chunk_size, std::vector<std::size_t>& bounds) {
+   const CharClasses& classify = char_classes();
+   std::size_t next_split = 0;
+   bool closed = false;
+
+   auto ends_atom = [&](std::size_t pos) {
+      char_class cc = classify(text[pos - 1]);
+      return cc == cc_space || cc == cc_close;
+   };
+
+   bool ok = scan_sexpr(text, [&](sexpr_event event, std::size_t pos, std::size_t depth) {
+      if (closed) {
+         return false;
+      }
+
+      switch (event) {
+         case sexpr_event::open:
+            if (depth == 0) {
+               bounds.push_back(pos + 1);
+               next_split = pos + chunk_size;
+            } else if (depth == 1 && pos >= next_split && ends_atom(pos)) {
+               bounds.push_back(pos);
+               next_split = pos + chunk_size;
+            }
+            return true;
+
+         case sexpr_event::close:
+            if (depth == 0) {
+               if (!ends_atom(pos)) {
+                  return false; // the last chunk would end with an unterminated atom
+               }
+               bounds.push_back(pos);
+               closed = true;
+            }
+            return true;
+
+         default:
+            return depth > 0;
+      }
+   });
+
+   return ok && closed;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+NodeTree parse_parallel(be::SV text, be::util::StringInterner& si, bool text_outlives_tree, NodeClassifier classifier, LazyPredicate defer) {
+   if (!text_outlives_tree) {
+      defer = nullptr;
+   }
+
+   auto serial = [&]() {
+      return defer ? parse_lazy(text, si, classifier, defer) : parse(text, si, text_outlives_tree, classifier);
+   };
+
+   std::size_t workers = worker_count();
+   if (workers <= 1 || text.size() < 2 * min_chunk_size) {
+      return serial();
+   }
+
+   std::vector<std::size_t> bounds;
+   std::size_t chunk_size = std::max(min_chunk_size, text.size() / (workers * 4));
+   if (!find_chunks(text, chunk_size, bounds) || bounds.size() < 3) {
+      return serial();
+   }
+
+   std::size_t n_chunks = bounds.size() - 1;
+   std::vector<NodeTree> parts(n_chunks);
+   std::deque<be::util::StringInterner> interners(n_chunks); // si isn't thread safe
+   std::shared_ptr<LazyContext> context = std::make_shared<LazyContext>(si, classifier);
+
+   parallel_for(n_chunks, [&](std::size_t i) {
+      be::SV chunk = text.substr(bounds[i], bounds[i + 1] - bounds[i]);
+      if (defer) {
+         parts[i] = parse_lazy(chunk, interners[i], context, defer);
+      } else {
+         parts[i] = parse(chunk, interners[i], text_outlives_tree, classifier);
+      }
+   });
+
+   return NodeTreeSplicer::splice(parts, text, si);
+}
@@ -1,4 +1,5 @@
 #include "pcb_helper.hpp"
+#include <array>
 #include <string>
 
 using namespace std::string_view_literals;
@@ -41,6 +42,11 @@ const be::util::ExactKeywordParser<node_type>& node_type_parser() {
          (node_type::n_fp_arc, "fp_arc")
          (node_type::n_fp_circle, "fp_circle")
          (node_type::n_fp_text, "fp_text")
+         (node_type::n_model, "model")
+         (node_type::n_setup, "setup")
+         (node_type::n_page, "page")
+         (node_type::n_net_class, "net_class")
+         (node_type::n_dimension, "dimension")
       );
 
    return parser;
@@ -73,83 +79,202 @@ const be::util::ExactKeywordParser<pad_shape>& pad_shape_parser() {
 }
 
 //////////////////////////////////////////////////////////////////////////////
-node_type get_node_type(const Node& node) {
-   return node.empty() ? node_type::ignored : node_type_parser().parse(node[0].text());
+be::U8 classify_node(be::SV car) {
+   return (be::U8)node_type_parser().parse(car);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+bool defer_node(be::U8 keyword) {
+   switch ((node_type)keyword) {
+      case node_type::n_polygon: // zone outline; only filled_polygon is rendered
+      case node_type::n_effects:
+      case node_type::n_model:
+      case node_type::n_setup:
+      case node_type::n_page:
+      case node_type::n_net_class:
+      case node_type::n_dimension:
+         return true;
+      default:
+         return false;
+   }
 }
 
 namespace {
 
 //////////////////////////////////////////////////////////////////////////////
-const be::util::KeywordParser<layer_type>& layer_type_parser() {
-   static be::util::KeywordParser<layer_type> parser = 
-      std::move(be::util::KeywordParser<layer_type>(layer_type::other)
-         (layer_type::l_copper, "F.Cu", "B.Cu", "*.Cu")
-         (layer_type::l_silk, "F.SilkS", "B.SilkS", "*.SilkS")
-         (layer_type::l_fab, "F.Fab", "B.Fab", "*.Fab")
-         (layer_type::l_court, "F.CrtYd", "B.CrtYd", "*.CrtYd")
-         (layer_type::l_cuts, "Edge.Cuts")
+const be::util::ExactKeywordParser<layer_id>& layer_id_parser() {
+   static be::util::ExactKeywordParser<layer_id> parser = 
+      std::move(be::util::ExactKeywordParser<layer_id>(layer_id::unknown)
+         (layer_id::f_cu, "F.Cu")
+         (layer_id::b_cu, "B.Cu")
+         (layer_id::b_adhes, "B.Adhes")
+         (layer_id::f_adhes, "F.Adhes")
+         (layer_id::b_paste, "B.Paste")
+         (layer_id::f_paste, "F.Paste")
+         (layer_id::b_silks, "B.SilkS")
+         (layer_id::f_silks, "F.SilkS")
+         (layer_id::b_mask, "B.Mask")
+         (layer_id::f_mask, "F.Mask")
+         (layer_id::dwgs_user, "Dwgs.User")
+         (layer_id::cmts_user, "Cmts.User")
+         (layer_id::eco1_user, "Eco1.User")
+         (layer_id::eco2_user, "Eco2.User")
+         (layer_id::edge_cuts, "Edge.Cuts")
+         (layer_id::margin, "Margin")
+         (layer_id::b_crtyd, "B.CrtYd")
+         (layer_id::f_crtyd, "F.CrtYd")
+         (layer_id::b_fab, "B.Fab")
+         (layer_id::f_fab, "F.Fab")
       );
 
    return parser;
 }
 
 //////////////////////////////////////////////////////////////////////////////
-bool check_face(be::SV text, face_type face) {
-   face_type f = face_type::both;
-
-   if (text.size() >= 3 && text[1] == '.') {
-      switch (text[0]) {
-         case 'F':
-         case 'f':
-            f = face_type::f_front;
-            break;
-         case 'B':
-         case 'b':
-            f = face_type::f_back;
-            break;
-      }
+face_type layer_face(layer_id id) {
+   switch (id) {
+      case layer_id::f_cu:
+      case layer_id::f_adhes:
+      case layer_id::f_paste:
+      case layer_id::f_silks:
+      case layer_id::f_mask:
+      case layer_id::f_crtyd:
+      case layer_id::f_fab:
+         return face_type::f_front;
+      case layer_id::b_cu:
+      case layer_id::b_adhes:
+      case layer_id::b_paste:
+      case layer_id::b_silks:
+      case layer_id::b_mask:
+      case layer_id::b_crtyd:
+      case layer_id::b_fab:
+         return face_type::f_back;
+      default:
+         return face_type::both;
    }
+}
 
-   return face == f ||
-      face == face_type::any ||
-      f == face_type::both;
+//////////////////////////////////////////////////////////////////////////////
+layer_type layer_kind(layer_id id) {
+   switch (id) {
+      case layer_id::f_cu:
+      case layer_id::b_cu:
+         return layer_type::l_copper; // inner layers aren't drawn, so check_layer() treats them as other
+      case layer_id::f_silks:
+      case layer_id::b_silks:
+         return layer_type::l_silk;
+      case layer_id::f_fab:
+      case layer_id::b_fab:
+         return layer_type::l_fab;
+      case layer_id::f_crtyd:
+      case layer_id::b_crtyd:
+         return layer_type::l_court;
+      case layer_id::edge_cuts:
+         return layer_type::l_cuts;
+      default:
+         return layer_type::other;
+   }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-bool check_layer(be::SV text, face_type face, layer_type layer) {
-   if (!check_face(text, face)) {
+bool check_layer(layer_id id, face_type face, layer_type layer) {
+   face_type f = layer_face(id);
+   if (face != f && face != face_type::any && f != face_type::both) {
       return false;
    }
 
-   if (layer == layer_type::any) {
-      return true;
+   return layer == layer_type::any || layer == layer_kind(id);
+}
+
+} // ::()
+
+//////////////////////////////////////////////////////////////////////////////
+layer_id parse_layer_id(be::SV name) {
+   // In1.Cu through In30.Cu
+   if (name.size() >= 6 && name.size() <= 7 && name.substr(0, 2) == "In"sv && name.substr(name.size() - 3) == ".Cu"sv) {
+      be::U32 n = 0;
+      for (char c : name.substr(2, name.size() - 5)) {
+         if (c < '0' || c > '9') {
+            return layer_id::unknown;
+         }
+         n = n * 10 + (be::U32)(c - '0');
+      }
+      if (n >= 1 && n <= 30) {
+         return (layer_id)((be::U32)layer_id::f_cu + n);
+      }
+      return layer_id::unknown;
    }
 
-   return layer == layer_type_parser().parse(text);
+   return layer_id_parser().parse(name);
 }
 
-} // ::()
+//////////////////////////////////////////////////////////////////////////////
+layer_mask parse_layer_mask(be::SV name) {
+   struct Pair {
+      be::SV suffix;
+      layer_id front;
+      layer_id back;
+   };
+
+   static const Pair pairs[] = {
+      { ".Adhes"sv, layer_id::f_adhes, layer_id::b_adhes },
+      { ".Paste"sv, layer_id::f_paste, layer_id::b_paste },
+      { ".SilkS"sv, layer_id::f_silks, layer_id::b_silks },
+      { ".Mask"sv,  layer_id::f_mask,  layer_id::b_mask },
+      { ".CrtYd"sv, layer_id::f_crtyd, layer_id::b_crtyd },
+      { ".Fab"sv,   layer_id::f_fab,   layer_id::b_fab },
+   };
+
+   // *.Cu (or F&B.Cu) is both faces and every inner layer between them
+   std::size_t dot = name.find('.');
+   be::SV prefix = name.substr(0, dot);
+   if (dot != be::SV::npos && (prefix == "*"sv || prefix == "F&B"sv)) {
+      be::SV suffix = name.substr(dot);
+      if (suffix == ".Cu"sv) {
+         return copper_layers;
+      }
+      for (const Pair& pair : pairs) {
+         if (suffix == pair.suffix) {
+            return layer_bit(pair.front) | layer_bit(pair.back);
+         }
+      }
+   }
+
+   return layer_bit(parse_layer_id(name));
+}
 
 //////////////////////////////////////////////////////////////////////////////
-bool check_layer(const Node& node, face_type face, layer_type layer) {
-   if (node.empty()) {
-      return false;
+layer_mask copper_span(layer_mask layers) {
+   layer_mask copper = layers & copper_layers;
+   if (copper == 0) {
+      return layers;
+   }
+
+   layer_mask lowest = copper & (~copper + 1);
+   layer_mask highest = copper;
+   while (highest & (highest - 1)) {
+      highest &= highest - 1;
    }
+   return layers | (highest - lowest) | highest;
+}
 
-   for (auto it = node.rbegin(), end = node.rend(); it != end; ++it) {
-      auto& child = *it;
-      if (child.size() >= 2) {
-         if (child[0].text() == "layer"sv) {
-            return check_layer(child[1].text(), face, layer);
-         } else if (child[0].text() == "layers"sv) {
-            for (std::size_t i = 1, s = child.size(); i < s; ++i) {
-               if (check_layer(child[i].text(), face, layer)) {
-                  return true;
+//////////////////////////////////////////////////////////////////////////////
+layer_mask layer_query_mask(face_type face, layer_type layer) {
+   static const auto table = []() {
+      constexpr std::size_t faces = (std::size_t)face_type::f_back + 1;
+      constexpr std::size_t types = (std::size_t)layer_type::l_cuts + 1;
+      std::array<std::array<layer_mask, types>, faces> masks { };
+      for (std::size_t f = 0; f < faces; ++f) {
+         for (std::size_t t = 0; t < types; ++t) {
+            for (std::size_t id = 0; id <= (std::size_t)layer_id::unknown; ++id) {
+               if (check_layer((layer_id)id, (face_type)f, (layer_type)t)) {
+                  masks[f][t] |= layer_bit((layer_id)id);
                }
             }
          }
       }
-   }
+      return masks;
+   }();
 
-   return false;
-}
\ No newline at end of file
+   return table[(std::size_t)face][(std::size_t)layer];
+}
@@ -0,0 +1,312 @@
+#include "pick_grid.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr be::U32 max_grid_dim = 1024;
+
+struct Shape {
+   glm::vec2 a;
+   glm::vec2 b; // same as a for points
+   PickGrid::Entry entry;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<Shape> gather_shapes(const BoardModel& model, face_type face, be::U32 item_limit) {
+   using entry_type = PickGrid::entry_type;
+   std::vector<Shape> shapes;
+
+   const BoardModel::Modules& modules = model.modules;
+   for (std::size_t i = 0, n = modules.node.size(); i < n; ++i) {
+      if (modules.item[i] < item_limit && check_layer(modules.layers[i], face, layer_type::any)) {
+         shapes.push_back(Shape { modules.at[i], modules.at[i], { (be::U32)i, entry_type::module } });
+      }
+   }
+
+   const BoardModel::Segments& segments = model.segments;
+   for (std::size_t i = 0, n = segments.node.size(); i < n; ++i) {
+      if (segments.item[i] < item_limit && check_layer(segments.layers[i], face, layer_type::any)) {
+         shapes.push_back(Shape { segments.start[i], segments.end[i], { (be::U32)i, entry_type::segment } });
+      }
+   }
+
+   const BoardModel::Vias& vias = model.vias;
+   for (std::size_t i = 0, n = vias.node.size(); i < n; ++i) {
+      if (vias.item[i] < item_limit && model.check_layer(model_item::via, i, face, layer_type::any)) {
+         shapes.push_back(Shape { vias.at[i], vias.at[i], { (be::U32)i, entry_type::via } });
+      }
+   }
+
+   const BoardModel::Pads& pads = model.pads;
+   for (std::size_t i = 0, n = pads.node.size(); i < n; ++i) {
+      if (pads.item[i] < item_limit && model.check_layer(model_item::pad, i, face, layer_type::l_copper)) {
+         glm::vec2 center = glm::vec2(pads.transform[i][2]);
+         shapes.push_back(Shape { center, center, { (be::U32)i, entry_type::pad } });
+      }
+   }
+
+   return shapes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Bounds which leave out a few outlying coordinates, so that a stray item far
+// from the board doesn't stretch every cell.  Anything outside goes in the
+// border cells.
+void grid_bounds(const std::vector<Shape>& shapes, glm::vec2& lo, glm::vec2& hi) {
+   std::vector<be::F32> xs;
+   std::vector<be::F32> ys;
+   xs.reserve(shapes.size() * 2);
+   ys.reserve(shapes.size() * 2);
+   for (const Shape& shape : shapes) {
+      xs.push_back(shape.a.x);
+      xs.push_back(shape.b.x);
+      ys.push_back(shape.a.y);
+      ys.push_back(shape.b.y);
+   }
+
+   // the middle 80%, widened by a quarter on each side
+   std::size_t outliers = xs.size() / 10;
+   auto range = [=](std::vector<be::F32>& v, be::F32& min, be::F32& max) {
+      std::nth_element(v.begin(), v.begin() + outliers, v.end());
+      min = v[outliers];
+      std::nth_element(v.begin(), v.end() - 1 - outliers, v.end());
+      max = v[v.size() - 1 - outliers];
+      be::F32 margin = (max - min) * 0.25f;
+      min -= margin;
+      max += margin;
+   };
+
+   range(xs, lo.x, hi.x);
+   range(ys, lo.y, hi.y);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Calls func(col, row) for each cell the shape (in grid coordinates) touches.
+template <typename F>
+void for_each_cell(glm::vec2 a, glm::vec2 b, be::U32 cols, be::U32 rows, F&& func) {
+   // clamped before converting, since outliers can be far beyond the range of U32
+   auto col_of = [=](be::F32 x) { return (be::U32)std::min(std::max(x, 0.f), (be::F32)(cols - 1)); };
+   auto row_of = [=](be::F32 y) { return (be::U32)std::min(std::max(y, 0.f), (be::F32)(rows - 1)); };
+
+   if (a.y > b.y) {
+      std::swap(a, b);
+   }
+
+   be::U32 row_begin = row_of(a.y);
+   be::U32 row_end = row_of(b.y) + 1;
+   for (be::U32 row = row_begin; row < row_end; ++row) {
+      be::F32 x0 = a.x;
+      be::F32 x1 = b.x;
+      if (row_end - row_begin > 1) {
+         // the part of the centerline within this row, or beyond it for the border rows
+         be::F32 dy = b.y - a.y;
+         be::F32 t0 = row == 0 ? 0.f : std::max(((be::F32)row - a.y) / dy, 0.f);
+         be::F32 t1 = row == rows - 1 ? 1.f : std::min(((be::F32)row + 1.f - a.y) / dy, 1.f);
+         x0 = a.x + (b.x - a.x) * t0;
+         x1 = a.x + (b.x - a.x) * t1;
+      }
+      if (x0 > x1) {
+         std::swap(x0, x1);
+      }
+      for (be::U32 col = col_of(x0), col_end = col_of(x1) + 1; col < col_end; ++col) {
+         func(col, row);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The closest candidate found so far.  Ties go to the lowest type and index,
+// so that the result doesn't depend on the order candidates are seen in.
+struct Pick {
+   be::F32 distance;
+   PickGrid::Entry entry = PickGrid::Entry { BoardModel::none, PickGrid::entry_type::module };
+   bool found = false;
+
+   void consider(be::F32 d, const PickGrid::Entry& e) {
+      if (d < distance || (found && d == distance &&
+          std::make_pair(e.type, e.index) < std::make_pair(entry.type, entry.index))) {
+         distance = d;
+         entry = e;
+         found = true;
+      }
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Calls visit(const PickGrid::Entry&) for the items of the given types which
+// might be within radius of target: those near it in grid, or if grid is
+// null, every one of them.
+template <typename F>
+void for_each_pick_candidate(const BoardModel& model, const PickGrid* grid, std::initializer_list<PickGrid::entry_type> types,
+                             face_type side, glm::vec2 target, be::F32 radius, F&& visit) {
+   if (grid) {
+      grid->query(side, target, radius, visit);
+      return;
+   }
+
+   for (PickGrid::entry_type type : types) {
+      std::size_t n = 0;
+      switch (type) {
+         case PickGrid::entry_type::module:  n = model.modules.node.size(); break;
+         case PickGrid::entry_type::segment: n = model.segments.node.size(); break;
+         case PickGrid::entry_type::via:     n = model.vias.node.size(); break;
+         case PickGrid::entry_type::pad:     n = model.pads.node.size(); break;
+      }
+      for (std::size_t i = 0; i < n; ++i) {
+         visit(PickGrid::Entry { (be::U32)i, type });
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::F32 segment_distance(glm::vec2 start_pos, glm::vec2 end_pos, glm::vec2 target) {
+   glm::vec2 delta = end_pos - start_pos;
+   if (glm::dot(delta, target - end_pos) >= 0) {
+      return glm::distance(end_pos, target);
+   } else if (glm::dot(-delta, target - start_pos) >= 0) {
+      return glm::distance(start_pos, target);
+   } else {
+      glm::vec2 normal = glm::normalize(glm::vec2(-delta.y, delta.x));
+      return std::abs(glm::dot(normal, target - start_pos));
+   }
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+PickGrid::PickGrid(const BoardModel& model, be::U32 item_limit) {
+   for (std::size_t f = 0; f < 2; ++f) {
+      std::vector<Shape> shapes = gather_shapes(model, f == 0 ? face_type::f_front : face_type::f_back, item_limit);
+      if (shapes.empty()) {
+         continue;
+      }
+
+      glm::vec2 lo;
+      glm::vec2 hi;
+      grid_bounds(shapes, lo, hi);
+
+      // roughly one entry per cell
+      glm::vec2 extent = hi - lo;
+      be::F32 cell_size = std::sqrt(extent.x * extent.y / (be::F32)shapes.size());
+      cell_size = std::max(cell_size, std::max(extent.x, extent.y) / (be::F32)(max_grid_dim - 1));
+      if (!(cell_size > 0.f)) {
+         cell_size = 1.f;
+      }
+
+      Grid& grid = grids_[f];
+      grid.origin = lo;
+      grid.inv_cell_size = 1.f / cell_size;
+      grid.cols = std::min((be::U32)(extent.x * grid.inv_cell_size) + 1, max_grid_dim);
+      grid.rows = std::min((be::U32)(extent.y * grid.inv_cell_size) + 1, max_grid_dim);
+
+      // count each cell's entries, then fill them in
+      std::size_t n_cells = (std::size_t)grid.cols * grid.rows;
+      grid.cell_start.assign(n_cells + 1, 0);
+      for (const Shape& shape : shapes) {
+         glm::vec2 a = (shape.a - lo) * grid.inv_cell_size;
+         glm::vec2 b = (shape.b - lo) * grid.inv_cell_size;
+         for_each_cell(a, b, grid.cols, grid.rows, [&](be::U32 col, be::U32 row) {
+            ++grid.cell_start[(std::size_t)row * grid.cols + col + 1];
+         });
+      }
+
+      for (std::size_t c = 0; c < n_cells; ++c) {
+         grid.cell_start[c + 1] += grid.cell_start[c];
+      }
+
+      std::vector<be::U32> next(grid.cell_start.begin(), grid.cell_start.end() - 1);
+      grid.entries.resize(grid.cell_start.back());
+      for (const Shape& shape : shapes) {
+         glm::vec2 a = (shape.a - lo) * grid.inv_cell_size;
+         glm::vec2 b = (shape.b - lo) * grid.inv_cell_size;
+         for_each_cell(a, b, grid.cols, grid.rows, [&](be::U32 col, be::U32 row) {
+            grid.entries[next[(std::size_t)row * grid.cols + col]++] = shape.entry;
+         });
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t PickGrid::cells() const noexcept {
+   return (std::size_t)grids_[0].cols * grids_[0].rows + (std::size_t)grids_[1].cols * grids_[1].rows;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t PickGrid::size() const noexcept {
+   return grids_[0].entries.size() + grids_[1].entries.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const Node* find_closest_module(const BoardModel& model, const PickGrid* grid, glm::vec2 target, be::F32& max_distance,
+                                face_type side, be::U32 item_limit) {
+   const BoardModel::Modules& modules = model.modules;
+   Pick pick { max_distance };
+
+   for_each_pick_candidate(model, grid, { PickGrid::entry_type::module }, side, target, max_distance, [&](const PickGrid::Entry& e) {
+      if (e.type == PickGrid::entry_type::module && modules.item[e.index] < item_limit &&
+          check_layer(modules.layers[e.index], side, layer_type::any)) {
+         pick.consider(glm::distance(modules.at[e.index], target), e);
+      }
+   });
+
+   if (!pick.found) {
+      return nullptr;
+   }
+
+   max_distance = pick.distance;
+   return modules.node[pick.entry.index];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 find_closest_copper(const BoardModel& model, const PickGrid* grid, glm::vec2 target, be::F32& max_distance,
+                            face_type side, const std::set<be::U32>& skip_nets, bool include_pads,
+                            be::U32 item_limit) {
+   using entry_type = PickGrid::entry_type;
+   const BoardModel::Segments& segments = model.segments;
+   const BoardModel::Vias& vias = model.vias;
+   const BoardModel::Pads& pads = model.pads;
+   Pick pick { max_distance };
+
+   auto skip_net = [&](be::U32 net) {
+      return net == BoardModel::none || skip_nets.count(net) > 0;
+   };
+
+   for_each_pick_candidate(model, grid, { entry_type::segment, entry_type::via, entry_type::pad }, side, target, max_distance, [&](const PickGrid::Entry& e) {
+      be::U32 i = e.index;
+      switch (e.type) {
+         case entry_type::segment:
+            if (segments.item[i] < item_limit && !skip_net(segments.net[i]) && check_layer(segments.layers[i], side, layer_type::any)) {
+               pick.consider(segment_distance(segments.start[i], segments.end[i], target), e);
+            }
+            break;
+
+         case entry_type::via:
+            if (vias.item[i] < item_limit && !skip_net(vias.net[i]) && model.check_layer(model_item::via, i, side, layer_type::any)) {
+               pick.consider(glm::distance(vias.at[i], target), e);
+            }
+            break;
+
+         case entry_type::pad:
+            if (include_pads && pads.item[i] < item_limit && !skip_net(pads.net[i]) &&
+                model.check_layer(model_item::pad, i, side, layer_type::l_copper)) {
+               pick.consider(glm::distance(glm::vec2(pads.transform[i][2]), target), e);
+            }
+            break;
+
+         default:
+            break;
+      }
+   });
+
+   if (!pick.found) {
+      return BoardModel::none;
+   }
+
+   max_distance = pick.distance;
+   switch (pick.entry.type) {
+      case entry_type::segment: return segments.net[pick.entry.index];
+      case entry_type::via:     return vias.net[pick.entry.index];
+      default:                  return pads.net[pick.entry.index];
+   }
+}
@@ -1,38 +1,30 @@
 #include "render_layer.hpp"
-#include "pcb_helper.hpp"
 #include "circle.hpp"
 #include "polygon.hpp"
-#include <be/util/keyword_parser.hpp>
+#include "transform.hpp"
+#include "parallel.hpp"
 #include <glm/mat3x3.hpp>
 #include <glm/vec3.hpp>
-#include <glm/trigonometric.hpp>
-#include <string>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 
 namespace {
 
-be::U32 endcap_segments = 18;
-be::U32 pad_segments = 18;
-be::U32 arc_segments = 72;
-be::U32 zone_segments = 18;
+std::atomic<be::U32> endcap_density { 18 };
+std::atomic<be::U32> pad_density { 18 };
+std::atomic<be::U32> arc_density { 72 };
+std::atomic<be::U32> zone_endcap_density { 18 };
 
-using namespace std::string_view_literals;
+// The segments per circle SegmentDensities::fit() chooses from, so that
+// similar curves share instanced shapes and unit circle tables.
+constexpr be::U32 lod_levels[] = { 4, 6, 8, 12, 18, 24, 36, 48, 72, 96, 144, 192, 288, 360 };
+constexpr std::size_t n_lod_levels = sizeof(lod_levels) / sizeof(lod_levels[0]);
 
-//////////////////////////////////////////////////////////////////////////////
-glm::mat3 translation(const glm::vec2& v) {
-   return glm::mat3(1.f, 0.f, 0.f, 0.f, 1.f, 0.f, v.x, v.y, 1.f);
-}
-
-//////////////////////////////////////////////////////////////////////////////
-glm::mat3 rotation(be::F32 radians) {
-   be::F32 s = std::sin(radians);
-   be::F32 c = std::cos(radians);
-   return glm::mat3(c, s, 0.f, -s, c, 0.f, 0.f, 0.f, 1.f);
-}
-
-//////////////////////////////////////////////////////////////////////////////
-glm::mat3 scaling(const glm::vec2& v) {
-   return glm::mat3(v.x, 0.f, 0.f, 0.f, v.y, 0.f, 0.f, 0.f, 1.f);
-}
+using namespace std::string_view_literals;
 
 //////////////////////////////////////////////////////////////////////////////
 bool intersection(glm::vec2 s0, glm::vec2 e0, glm::vec2 s1, glm::vec2 e1, glm::vec2& out) {
@@ -53,99 +45,68 @@ bool intersection(glm::vec2 s0, glm::vec2 e0, glm::vec2 s1, glm::vec2 e1, glm::v
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_triangle(const triangle& t, const glm::mat3& transform, std::vector<triangle>& out) {
-   out.push_back(triangle { {
-         glm::vec2(transform * glm::vec3(t.v[0], 1.f)),
-         glm::vec2(transform * glm::vec3(t.v[1], 1.f)),
-         glm::vec2(transform * glm::vec3(t.v[2], 1.f))
-   } });
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_triangle(glm::vec2 a, glm::vec2 b, glm::vec2 c, const glm::mat3& transform, std::vector<triangle>& out) {
-   out.push_back(triangle { {
-         glm::vec2(transform * glm::vec3(a, 1.f)),
-         glm::vec2(transform * glm::vec3(b, 1.f)),
-         glm::vec2(transform * glm::vec3(c, 1.f))
-   } });
+// Two triangles, (a, b, d) and (d, b, c), sharing the edge between b and d.
+void render_quad(glm::vec2 a, glm::vec2 b, glm::vec2 c, glm::vec2 d, IndexedMesh& out) {
+   be::U32 first = out.add_vertex(a);
+   out.add_vertex(b);
+   out.add_vertex(c);
+   out.add_vertex(d);
+   out.add_triangle(first, first + 1, first + 3);
+   out.add_triangle(first + 3, first + 1, first + 2);
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_endcap(glm::vec2 center, glm::vec2 tangent, const glm::mat3& transform, std::vector<triangle>& out) {
-   be::U32 n = 0;
-   glm::vec2 root;
-   glm::vec2 last;
-   discretize_arc(center, tangent, glm::pi<be::F32>(), endcap_segments, [&](glm::vec2 v) {
-      if (n >= 2) {
-         render_triangle(root, last, v, transform, out);
-      } else if (n == 0) {
-         root = v;
+// Adds each vertex once and fans the triangles out from the first.
+template <typename F>
+void render_fan(F&& discretize, IndexedMesh& out) {
+   be::U32 root = (be::U32)out.vertices.size();
+   discretize([&](glm::vec2 v) {
+      be::U32 i = out.add_vertex(v);
+      if (i >= root + 2) {
+         out.add_triangle(root, i - 1, i);
       }
-      last = v;
-      ++n;
    });
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_line(glm::vec2 start, glm::vec2 end, be::F32 width, const glm::mat3& transform, std::vector<triangle>& out) {
-   if (width > 0) {
-      be::F32 half_width = width / 2.f;
-      glm::vec2 delta = end - start;
-      glm::vec2 normal = glm::normalize(glm::vec2(-delta.y, delta.x)) * half_width;
-
-      render_endcap(start, start + normal, transform, out);
-      render_endcap(end, end - normal, transform, out);
-      
-      render_triangle(start + normal, start - normal, end + normal, transform, out);
-      render_triangle(start - normal, end + normal, end - normal, transform, out);
-   }
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_zone_endcap(glm::vec2 center, glm::vec2 tangent, const glm::mat3& transform, std::vector<triangle>& out) {
-   be::U32 n = 0;
-   glm::vec2 root;
-   glm::vec2 last;
-   discretize_arc(center, tangent, glm::pi<be::F32>(), zone_segments, [&](glm::vec2 v) {
-      if (n >= 2) {
-         render_triangle(root, last, v, transform, out);
-      } else if (n == 0) {
-         root = v;
-      }
-      last = v;
-      ++n;
-   });
+void render_endcap(glm::vec2 center, glm::vec2 tangent, be::U32 segments, IndexedMesh& out) {
+   render_fan([&](auto&& emit) {
+      discretize_arc(center, tangent, glm::pi<be::F32>(), segments, emit);
+   }, out);
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_zone_line(glm::vec2 start, glm::vec2 end, be::F32 width, const glm::mat3& transform, std::vector<triangle>& out) {
+// The endcaps together go all the way round the line, so it's a single fan.
+void render_line(glm::vec2 start, glm::vec2 end, be::F32 width, be::U32 endcap_segments, IndexedMesh& out) {
    if (width > 0) {
       be::F32 half_width = width / 2.f;
       glm::vec2 delta = end - start;
       glm::vec2 normal = glm::normalize(glm::vec2(-delta.y, delta.x)) * half_width;
 
-      render_zone_endcap(start, start + normal, transform, out);
-      render_zone_endcap(end, end - normal, transform, out);
-      
-      render_triangle(start + normal, start - normal, end + normal, transform, out);
-      render_triangle(start - normal, end + normal, end - normal, transform, out);
+      render_fan([&](auto&& emit) {
+         discretize_arc(start, start + normal, glm::pi<be::F32>(), endcap_segments, emit);
+         discretize_arc(end, end - normal, glm::pi<be::F32>(), endcap_segments, emit);
+      }, out);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_arc(glm::vec2 center, glm::vec2 tangent, be::F32 degrees, be::F32 width, const glm::mat3& transform, std::vector<triangle>& out) {
+// The strip along the arc adds each pair of offset vertices once, and begins
+// and ends with the ends of the endcaps.
+void render_arc(glm::vec2 center, glm::vec2 tangent, be::F32 degrees, be::F32 width, be::U32 arc_segments, be::U32 endcap_segments,
+                IndexedMesh& out) {
    if (width > 0 && degrees != 0) {
       const be::F32 half_width = width / 2.f;
 
       be::U32 n = 0;
       glm::vec2 first, semifinal, last;
-      glm::vec2 offset1, offset2;
-      
+      be::U32 offset1 = 0, offset2 = 0;
+
       discretize_arc(center, tangent, glm::radians(degrees), arc_segments, [&](glm::vec2 v) {
          if (n >= 2) {
             glm::vec2 pd = last - semifinal;
             glm::vec2 pn = glm::normalize(glm::vec2(-pd.y, pd.x)) * half_width;
-            
+
             glm::vec2 nd = v - last;
             glm::vec2 nn = glm::normalize(glm::vec2(-nd.y, nd.x)) * half_width;
 
@@ -153,18 +114,20 @@ void render_arc(glm::vec2 center, glm::vec2 tangent, be::F32 degrees, be::F32 wi
             intersection(semifinal - pn, last - pn, v - nn, last - nn, intersect1);
             intersection(semifinal + pn, last + pn, v + nn, last + nn, intersect2);
 
-            render_triangle(offset2, offset1, intersect2, transform, out);
-            render_triangle(offset1, intersect2, intersect1, transform, out);
+            be::U32 next1 = out.add_vertex(intersect1);
+            be::U32 next2 = out.add_vertex(intersect2);
+            out.add_triangle(offset2, offset1, next2);
+            out.add_triangle(offset1, next2, next1);
 
-            offset1 = intersect1;
-            offset2 = intersect2;
+            offset1 = next1;
+            offset2 = next2;
 
          } else if (n == 1) {
             glm::vec2 d = v - first;
             glm::vec2 offset = glm::normalize(glm::vec2(-d.y, d.x)) * half_width;
-            offset1 = first - offset;
-            offset2 = first + offset;
-            render_endcap(first, offset2, transform, out);
+            offset2 = (be::U32)out.vertices.size();
+            render_endcap(first, first + offset, endcap_segments, out);
+            offset1 = (be::U32)out.vertices.size() - 1;
          } else {
             first = v;
          }
@@ -177,22 +140,22 @@ void render_arc(glm::vec2 center, glm::vec2 tangent, be::F32 degrees, be::F32 wi
       glm::vec2 pd = last - semifinal;
       glm::vec2 pn = glm::normalize(glm::vec2(-pd.y, pd.x)) * half_width;
 
-      glm::vec2 final_offset1 = last - pn;
-      glm::vec2 final_offset2 = last + pn;
+      be::U32 final_offset1 = (be::U32)out.vertices.size();
+      render_endcap(last, last - pn, endcap_segments, out);
+      be::U32 final_offset2 = (be::U32)out.vertices.size() - 1;
 
-      render_triangle(offset2, offset1, final_offset2, transform, out);
-      render_triangle(offset1, final_offset2, final_offset1, transform, out);
-
-      render_endcap(last, final_offset1, transform, out);
+      out.add_triangle(offset2, offset1, final_offset2);
+      out.add_triangle(offset1, final_offset2, final_offset1);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_circle(glm::vec2 center, glm::vec2 tangent, be::F32 width, const glm::mat3& transform, std::vector<triangle>& out) {
-   if (width > 0) {
+// A closed strip; the last pair of vertices is the first.
+void render_circle(glm::vec2 center, glm::vec2 tangent, be::F32 width, be::U32 arc_segments, IndexedMesh& out) {
+   if (width > 0 && arc_segments > 0) {
+      const UnitCircle unit = unit_circle(arc_segments);
       const be::F32 radius = glm::distance(center, tangent);
-      const be::F32 omega = glm::two_pi<be::F32>() / arc_segments;
-      const be::F32 cho = std::cos(omega / 2.f);
+      const be::F32 cho = unit.cos[1];
       const be::F32 adj_radius = 2.f * radius / (1.f + cho);
       const be::F32 offset = width / (2.f * cho);
       const be::F32 r1 = adj_radius - offset;
@@ -204,723 +167,657 @@ void render_circle(glm::vec2 center, glm::vec2 tangent, be::F32 width, const glm
       const glm::mat2 cob0 = glm::mat2(p0, glm::vec2(-p0.y, p0.x));
       const glm::mat2 cob1 = glm::mat2(p1, glm::vec2(-p1.y, p1.x));
 
-      glm::vec2 last0 = center + p0;
-      glm::vec2 last1 = center + p1;
+      const be::U32 first = out.add_vertex(center + p0);
+      out.add_vertex(center + p1);
+      be::U32 last = first;
 
       for (be::U32 s = 1; s <= arc_segments; ++s) {
-         const be::F32 theta = omega * s;
-         const glm::vec2 cs = glm::vec2(std::cos(theta), std::sin(theta));
-         const glm::vec2 q0 = center + cob0 * cs;
-         const glm::vec2 q1 = center + cob1 * cs;
+         be::U32 next = first;
+         if (s < arc_segments) {
+            const be::U32 k = 2 * s;
+            const glm::vec2 cs = glm::vec2(unit.cos[k], unit.sin[k]);
+            next = out.add_vertex(center + cob0 * cs);
+            out.add_vertex(center + cob1 * cs);
+         }
 
-         render_triangle(last1, last0, q1, transform, out);
-         render_triangle(last0, q1, q0, transform, out);
+         out.add_triangle(last + 1, last, next + 1);
+         out.add_triangle(last, next + 1, next);
 
-         last0 = q0;
-         last1 = q1;
+         last = next;
       }
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_gr_line(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 start, end;
-      be::F32 width = 0;
+void render_circle_pad(be::F32 radius, be::U32 segments, IndexedMesh& out) {
+   render_fan([&](auto&& emit) {
+      discretize_circle(glm::vec2(), radius, segments, emit);
+   }, out);
+}
 
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_start:
-               if (child.size() >= 3) {
-                  start.x = (be::F32)child[1].value();
-                  start.y = (be::F32)child[2].value();
-               }
-               break;
+//////////////////////////////////////////////////////////////////////////////
+void render_oval_pad(glm::vec2 radius, be::U32 segments, IndexedMesh& out) {
+   render_fan([&](auto&& emit) {
+      discretize_oval(glm::vec2(), radius, segments, emit);
+   }, out);
+}
 
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  end.x = (be::F32)child[1].value();
-                  end.y = (be::F32)child[2].value();
-               }
-               break;
+//////////////////////////////////////////////////////////////////////////////
+void render_rect_pad(glm::vec2 radius, IndexedMesh& out) {
+   render_quad(glm::vec2(-radius.x, radius.y),
+               glm::vec2(-radius.x, -radius.y),
+               glm::vec2(radius.x, -radius.y),
+               glm::vec2(radius.x, radius.y), out);
+}
 
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
-         }
-      }
+//////////////////////////////////////////////////////////////////////////////
+void render_trapezoid_pad(glm::vec2 radius, glm::vec2 rect_delta, IndexedMesh& out) {
+   render_quad(glm::vec2(-radius.x - rect_delta.y, radius.y + rect_delta.x),
+               glm::vec2(-radius.x + rect_delta.y, -radius.y - rect_delta.x),
+               glm::vec2(radius.x - rect_delta.y, -radius.y + rect_delta.x),
+               glm::vec2(radius.x + rect_delta.y, radius.y - rect_delta.x), out);
+}
 
-      render_line(start, end, width, transform, out);
+//////////////////////////////////////////////////////////////////////////////
+void render_drill(glm::vec2 size, be::U32 segments, IndexedMesh& out) {
+   if (size.x > 0 && size.y > 0) {
+      render_fan([&](auto&& emit) {
+         discretize_oval(glm::vec2(), size / 2.f, segments, emit);
+      }, out);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_gr_arc(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 center, tangent;
-      be::F32 angle = 0;
-      be::F32 width = 0;
+// Adds the triangles of a polygon, each of its points once.
+void render_polygon(std::deque<edge>& edges, IndexedMesh& out) {
+   std::vector<triangle> tris;
+   triangulate_polygon(edges, tris);
 
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_start:
-               if (child.size() >= 3) {
-                  center.x = (be::F32)child[1].value();
-                  center.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  tangent.x = (be::F32)child[1].value();
-                  tangent.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_angle:
-               if (child.size() >= 2) {
-                  angle = (be::F32)child[1].value();
-               }
-               break;
-
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
+   std::unordered_map<be::U64, be::U32> indices;
+   for (const triangle& tri : tris) {
+      be::U32 i[3];
+      for (std::size_t k = 0; k < 3; ++k) {
+         be::U64 bits;
+         std::memcpy(&bits, &tri.v[k], sizeof(bits));
+         auto result = indices.emplace(bits, (be::U32)out.vertices.size());
+         if (result.second) {
+            out.add_vertex(tri.v[k]);
          }
+         i[k] = result.first->second;
       }
-
-      render_arc(center, tangent, angle, width, transform, out);
+      out.add_triangle(i[0], i[1], i[2]);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_gr_circle(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 center, tangent;
-      be::F32 width = 0;
-
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_center:
-               if (child.size() >= 3) {
-                  center.x = (be::F32)child[1].value();
-                  center.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  tangent.x = (be::F32)child[1].value();
-                  tangent.y = (be::F32)child[2].value();
-               }
-               break;
+// Sends the triangles of items accepted by a single predicate to one output.
+struct PredicateOutput {
+   const RenderItemPredicate& pred;
+   IndexedMesh& out;
+   const SegmentDensities& densities;
 
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
-         }
+   template <typename F>
+   void emit(const BoardModel& model, model_item type, std::size_t i, F&& tessellate) {
+      if (pred(model, type, i)) {
+         tessellate(out);
       }
+   }
 
-      render_circle(center, tangent, width, transform, out);
+   // tessellate(out) renders the shape around the origin, to be placed by transform
+   template <typename F>
+   void emit_shape(const BoardModel& model, model_item type, std::size_t i, const ShapeKey&, const glm::mat3& transform, F&& tessellate) {
+      if (pred(model, type, i)) {
+         std::size_t first = out.vertices.size();
+         tessellate(out);
+         transform_vertices(transform, out.vertices, first);
+      }
    }
-}
 
-//////////////////////////////////////////////////////////////////////////////
-void render_gr_text(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   // TODO
-}
+   void emit_module(const BoardModel& model, be::U32 module, const BoardModel::ItemStart& begin, const BoardModel::ItemStart& end);
+};
 
 //////////////////////////////////////////////////////////////////////////////
-void render_fp_line(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 start, end;
-      be::F32 width = 0;
+// Sends the triangles of each item to every bucket whose predicate accepts
+// it, tessellating it only once.  Buckets with InstancedShapes get instances
+// of pads, vias and holes rather than their triangles, and of whole modules
+// when several share a footprint.
+struct BucketOutput {
+   using Bucket = LayerBuckets::Bucket;
 
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_start:
-               if (child.size() >= 3) {
-                  start.x = (be::F32)child[1].value();
-                  start.y = (be::F32)child[2].value();
-               }
-               break;
+   const std::vector<Bucket>& buckets;
+   std::vector<const Bucket*>& accepted;
+   IndexedMesh& scratch;
+   const SegmentDensities& densities;
+   bool skip_instanced = false; // leaves out buckets with InstancedShapes
 
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  end.x = (be::F32)child[1].value();
-                  end.y = (be::F32)child[2].value();
-               }
-               break;
+   template <typename F>
+   void emit(const BoardModel& model, model_item type, std::size_t i, F&& tessellate) {
+      emit_triangles(model, type, i, !skip_instanced, tessellate);
+   }
 
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
+   template <typename F>
+   void emit_shape(const BoardModel& model, model_item type, std::size_t i, const ShapeKey& key, const glm::mat3& transform, F&& tessellate) {
+      for (const Bucket& bucket : buckets) {
+         if (bucket.shapes && !skip_instanced && bucket.pred(model, type, i)) {
+            be::U32 shape = bucket.shapes->shape(key, tessellate);
+            bucket.shapes->add(shape, transform);
          }
       }
 
-      render_line(start, end, width, transform, out);
+      emit_triangles(model, type, i, false, [&](IndexedMesh& out) {
+         std::size_t first = out.vertices.size();
+         tessellate(out);
+         transform_vertices(transform, out.vertices, first);
+      });
    }
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_fp_arc(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 center, tangent;
-      be::F32 angle = 0;
-      be::F32 width = 0;
 
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_start:
-               if (child.size() >= 3) {
-                  center.x = (be::F32)child[1].value();
-                  center.y = (be::F32)child[2].value();
-               }
-               break;
+   void emit_module(const BoardModel& model, be::U32 module, const BoardModel::ItemStart& begin, const BoardModel::ItemStart& end);
 
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  tangent.x = (be::F32)child[1].value();
-                  tangent.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_angle:
-               if (child.size() >= 2) {
-                  angle = (be::F32)child[1].value();
-               }
-               break;
-
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
+   // instanced_too: whether buckets with InstancedShapes take the triangles
+   template <typename F>
+   void emit_triangles(const BoardModel& model, model_item type, std::size_t i, bool instanced_too, F&& tessellate) {
+      accepted.clear();
+      for (const Bucket& bucket : buckets) {
+         if ((instanced_too || !bucket.shapes) && bucket.pred(model, type, i)) {
+            accepted.push_back(&bucket);
          }
       }
 
-      render_arc(center, tangent, angle, width, transform, out);
-   }
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_fp_circle(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 center, tangent;
-      be::F32 width = 0;
-
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_center:
-               if (child.size() >= 3) {
-                  center.x = (be::F32)child[1].value();
-                  center.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  tangent.x = (be::F32)child[1].value();
-                  tangent.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
+      if (accepted.size() == 1) {
+         tessellate(*accepted[0]->mesh);
+      } else if (!accepted.empty()) {
+         scratch.clear();
+         tessellate(scratch);
+         for (const Bucket* bucket : accepted) {
+            bucket->mesh->append(scratch);
          }
       }
-
-      render_circle(center, tangent, width, transform, out);
    }
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_fp_text(std::vector<const Node*>& stack, const RenderNodePredicate& pred, be::F32 parent_rot, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   // TODO
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_circle_pad(be::F32 radius, const glm::mat3& transform, std::vector<triangle>& out) {
-   be::U32 n = 0;
-   glm::vec2 root;
-   glm::vec2 last;
-   discretize_circle(glm::vec2(), radius, pad_segments, [&](glm::vec2 v) {
-      if (n >= 2) {
-         render_triangle(root, last, v, transform, out);
-      } else if (n == 0) {
-         root = v;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// local: in module space rather than board space
+template <typename Output>
+void render_graphic(const BoardModel& model, std::size_t i, Output& output, bool local = false) {
+   const SegmentDensities& d = output.densities;
+   output.emit(model, model_item::graphic, i, [&](IndexedMesh& out) {
+      const BoardModel::Graphics& g = model.graphics;
+      be::U32 module = g.module[i];
+      std::size_t first = out.vertices.size();
+      be::F32 half_width = g.width[i] / 2.f;
+      be::U32 endcaps = d.fit(d.endcaps, half_width);
+
+      switch (g.shape[i]) {
+         case graphic_shape::line:
+            render_line(g.start[i], g.end[i], g.width[i], endcaps, out);
+            break;
+         case graphic_shape::arc:
+            render_arc(g.start[i], g.end[i], g.angle[i], g.width[i], d.fit(d.arcs, glm::distance(g.start[i], g.end[i]) + half_width), endcaps, out);
+            break;
+         case graphic_shape::circle:
+            render_circle(g.start[i], g.end[i], g.width[i], d.fit(d.arcs, glm::distance(g.start[i], g.end[i]) + half_width), out);
+            break;
       }
-      last = v;
-      ++n;
-   });
-}
 
-//////////////////////////////////////////////////////////////////////////////
-void render_oval_pad(glm::vec2 radius, const glm::mat3& transform, std::vector<triangle>& out) {
-   be::U32 n = 0;
-   glm::vec2 root;
-   glm::vec2 last;
-   discretize_oval(glm::vec2(), radius, pad_segments, [&](glm::vec2 v) {
-      if (n >= 2) {
-         render_triangle(root, last, v, transform, out);
-      } else if (n == 0) {
-         root = v;
+      if (!local && module != BoardModel::none) {
+         transform_vertices(model.modules.transform[module], out.vertices, first);
       }
-      last = v;
-      ++n;
    });
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_rect_pad(glm::vec2 radius, const glm::mat3& transform, std::vector<triangle>& out) {
-   glm::vec2 pts[4] = {
-      glm::vec2(-radius.x, radius.y),
-      glm::vec2(-radius.x, -radius.y),
-      glm::vec2(radius.x, -radius.y),
-      glm::vec2(radius.x, radius.y)
-   };
-
-   render_triangle(pts[0], pts[1], pts[3], transform, out);
-   render_triangle(pts[3], pts[1], pts[2], transform, out);
-}
-
-//////////////////////////////////////////////////////////////////////////////
-void render_trapezoid_pad(glm::vec2 radius, glm::vec2 rect_delta, const glm::mat3& transform, std::vector<triangle>& out) {
-   glm::vec2 pts[4] = {
-      glm::vec2(-radius.x - rect_delta.y, radius.y + rect_delta.x),
-      glm::vec2(-radius.x + rect_delta.y, -radius.y - rect_delta.x),
-      glm::vec2(radius.x - rect_delta.y, -radius.y + rect_delta.x),
-      glm::vec2(radius.x + rect_delta.y, radius.y - rect_delta.x)
-   };
-
-   render_triangle(pts[0], pts[1], pts[3], transform, out);
-   render_triangle(pts[3], pts[1], pts[2], transform, out);
+template <typename Output>
+void render_drill(const BoardModel& model, model_item type, std::size_t i, glm::vec2 size, const glm::mat3& transform, Output& output) {
+   ShapeKey key { instanced_shape::drill, output.densities.fit(output.densities.pads, std::min(size.x, size.y) / 2.f), size, glm::vec2() };
+   output.emit_shape(model, type, i, key, transform, [&](IndexedMesh& out) {
+      render_drill(size, key.segments, out);
+   });
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_drill(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_self) {
-      glm::vec2 size;
+template <typename Output>
+void render_pad(const BoardModel& model, std::size_t i, Output& output, bool local = false) {
+   const BoardModel::Pads& p = model.pads;
+   const glm::mat3& transform = local ? p.local_transform[i] : p.transform[i];
+   const SegmentDensities& d = output.densities;
+   glm::vec2 size = p.size[i];
 
-      if (node.size() >= 2) {
-         const Node& n = node[1];
-         if (n.type() == Node::node_type::value) {
-            size = glm::vec2((be::F32)n.value());
-         } else if (node.size() >= 4 && n.text() == "oval"sv) {
-            size = glm::vec2((be::F32)node[2].value(), (be::F32)node[3].value());
-         }
+   if (size.x > 0 && size.y > 0) {
+      ShapeKey key { instanced_shape::rect, 0, size, glm::vec2() };
+      bool supported = true;
+      switch (p.shape[i]) {
+         case pad_shape::unsupported: supported = false; break;
+         case pad_shape::s_circle:    key = ShapeKey { instanced_shape::circle, d.fit(d.pads, size.x / 2.f), glm::vec2(size.x), glm::vec2() }; break;
+         case pad_shape::s_oval:      key = ShapeKey { instanced_shape::oval, d.fit(d.pads, std::min(size.x, size.y) / 2.f), size, glm::vec2() }; break;
+         case pad_shape::s_rect:      break;
+         case pad_shape::s_trapezoid: key = ShapeKey { instanced_shape::trapezoid, 0, size, p.rect_delta[i] }; break;
       }
 
-      if (size.x > 0 && size.y > 0) {
-         be::U32 n = 0;
-         glm::vec2 root;
-         glm::vec2 last;
-         discretize_oval(glm::vec2(), size / 2.f, pad_segments, [&](glm::vec2 v) {
-            if (n >= 2) {
-               render_triangle(root, last, v, transform, out);
-            } else if (n == 0) {
-               root = v;
+      if (supported) {
+         output.emit_shape(model, model_item::pad, i, key, transform, [&](IndexedMesh& out) {
+            switch (key.shape) {
+               case instanced_shape::circle:
+                  render_circle_pad(size.x / 2.f, key.segments, out);
+                  break;
+               case instanced_shape::oval:
+                  render_oval_pad(size / 2.f, key.segments, out);
+                  break;
+               case instanced_shape::trapezoid:
+                  render_trapezoid_pad(size / 2.f, p.rect_delta[i] / 2.f, out);
+                  break;
+               default:
+                  render_rect_pad(size / 2.f, out);
+                  break;
             }
-            last = v;
-            ++n;
          });
       }
    }
-}
 
-//////////////////////////////////////////////////////////////////////////////
-void render_pad(std::vector<const Node*>& stack, const RenderNodePredicate& pred, be::F32 parent_rot, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   if (!render_self && !render_children) {
-      return;
+   if (p.drill[i] != glm::vec2()) {
+      render_drill(model, model_item::pad_hole, i, p.drill[i], transform, output);
    }
-   
-   pad_shape shape = pad_shape::unsupported;
-   glm::vec2 at, size, rect_delta;
-   be::F32 rot = 0;
-   const Node* drill = nullptr;
-
-   if (node.size() >= 4) {
-      shape = pad_shape_parser().parse(node[3].text());
-   }
-
-   for (auto& child : node) {
-      switch (get_node_type(child)) {
-         case node_type::n_at:
-            if (child.size() >= 3) {
-               at.x = (be::F32)child[1].value();
-               at.y = (be::F32)child[2].value();
-
-               if (child.size() >= 4) {
-                  rot = (be::F32)child[3].value();
-               }
-            }
-            break;
-
-         case node_type::n_size:
-            if (child.size() >= 2) {
-               size.x = (be::F32)child[1].value();
-
-               if (child.size() >= 3) {
-                  size.y = (be::F32)child[2].value();
-               } else {
-                  size.y = size.x;
-               }
-            }
-            break;
-
-         case node_type::n_rect_delta:
-            if (child.size() >= 2) {
-               rect_delta.x = (be::F32)child[1].value();
-
-               if (child.size() >= 3) {
-                  rect_delta.y = (be::F32)child[2].value();
-               } else {
-                  rect_delta.y = rect_delta.x;
-               }
-            }
-            break;
+}
 
-         case node_type::n_drill:
-            drill = &child;
-            break;
-      }
-   }
+//////////////////////////////////////////////////////////////////////////////
+template <typename Output>
+void render_segment(const BoardModel& model, std::size_t i, Output& output) {
+   output.emit(model, model_item::segment, i, [&](IndexedMesh& out) {
+      const BoardModel::Segments& s = model.segments;
+      render_line(s.start[i], s.end[i], s.width[i], output.densities.fit(output.densities.endcaps, s.width[i] / 2.f), out);
+   });
+}
 
-   
+//////////////////////////////////////////////////////////////////////////////
+template <typename Output>
+void render_via(const BoardModel& model, std::size_t i, Output& output) {
+   const BoardModel::Vias& v = model.vias;
+   glm::mat3 transform = translation(v.at[i]);
+   be::F32 size = v.size[i];
 
-   if (render_self && size.x > 0 && size.y > 0) {
-      glm::mat3 child_transform = transform * translation(at) * rotation(-glm::radians(rot - parent_rot));
-      switch (shape) {
-         case pad_shape::s_circle:
-            render_circle_pad(size.x / 2.f, child_transform, out);
-            break;
-         case pad_shape::s_oval:
-            render_oval_pad(size / 2.f, child_transform, out);
-            break;
-         case pad_shape::s_rect:
-            render_rect_pad(size / 2.f, child_transform, out);
-            break;
-         case pad_shape::s_trapezoid:
-            render_trapezoid_pad(size / 2.f, rect_delta / 2.f, child_transform, out);
-            break;
-      }
+   if (size > 0) {
+      ShapeKey key { instanced_shape::circle, output.densities.fit(output.densities.pads, size / 2.f), glm::vec2(size), glm::vec2() };
+      output.emit_shape(model, model_item::via, i, key, transform, [&](IndexedMesh& out) {
+         render_circle_pad(size / 2.f, key.segments, out);
+      });
    }
 
-   if (render_children && drill) {
-      glm::mat3 child_transform = transform * translation(at) * rotation(-glm::radians(rot - parent_rot));
-      stack.push_back(drill);
-      render_drill(stack, pred, child_transform, out);
-      stack.pop_back();
+   if (v.drill[i] != glm::vec2()) {
+      render_drill(model, model_item::via_hole, i, v.drill[i], transform, output);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_module(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   
-   if (render_children) {
-      glm::vec2 at;
-      be::F32 rot = 0;
+template <typename Output>
+void render_zone(const BoardModel& model, std::size_t i, Output& output) {
+   output.emit(model, model_item::zone, i, [&](IndexedMesh& out) {
+      const BoardModel::Zones& z = model.zones;
+      be::F32 width = z.width[i];
+      be::U32 zone_endcaps = output.densities.fit(output.densities.zone_endcaps, width / 2.f);
+      BoardModel::Span polygons = z.polygons[i];
 
-      auto it = find(node, "at"sv);
-      if (it != node.end()) {
-         auto& child = *it;
-         if (child.size() >= 3) {
-            at.x = (be::F32)child[1].value();
-            at.y = (be::F32)child[2].value();
+      for (be::U32 p = polygons.begin, end = polygons.begin + polygons.count; p < end; ++p) {
+         BoardModel::Span span = model.polygons[p];
+         auto first = model.points.begin() + span.begin;
+         std::vector<glm::vec2> points(first, first + span.count);
 
-            if (child.size() >= 4) {
-               rot = (be::F32)child[3].value();
+         std::deque<edge> edges;
+         make_dcel(points, edges);
+         auto n_edges = edges.size();
+         render_polygon(edges, out);
+
+         if (zone_endcaps > 0 && width > 0) {
+            for (auto zit = edges.begin(), end = zit + n_edges; zit != end; ++zit) {
+               if (zit->next) {
+                  render_line(zit->origin, zit->next->origin, width, zone_endcaps, out);
+               }
             }
          }
       }
+   });
+}
 
-      glm::mat3 child_transform = transform * translation(at) * rotation(-glm::radians(rot));
-
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_pad:
-               stack.push_back(&child);
-               render_pad(stack, pred, rot, child_transform, out);
-               stack.pop_back();
-               break;
-            case node_type::n_fp_line:
-               stack.push_back(&child);
-               render_fp_line(stack, pred, child_transform, out);
-               stack.pop_back();
-               break;
-            case node_type::n_fp_arc:
-               stack.push_back(&child);
-               render_fp_arc(stack, pred, child_transform, out);
-               stack.pop_back();
-               break;
-            case node_type::n_fp_circle:
-               stack.push_back(&child);
-               render_fp_circle(stack, pred, child_transform, out);
-               stack.pop_back();
-               break;
-            case node_type::n_fp_text:
-               stack.push_back(&child);
-               render_fp_text(stack, pred, rot, child_transform, out);
-               stack.pop_back();
-               break;
-         }
-      }
+//////////////////////////////////////////////////////////////////////////////
+template <typename Output>
+void render_module_body(const BoardModel& model, const BoardModel::ItemStart& begin, const BoardModel::ItemStart& end, Output& output, bool local) {
+   for (std::size_t i = begin.graphics; i < end.graphics; ++i) {
+      render_graphic(model, i, output, local);
+   }
+   for (std::size_t i = begin.pads; i < end.pads; ++i) {
+      render_pad(model, i, output, local);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_segment(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-
-   if (render_self) {
-      glm::vec2 start, end;
-      be::F32 width = 0;
-
-      for (auto& child : node) {
-         switch (get_node_type(child)) {
-            case node_type::n_start:
-               if (child.size() >= 3) {
-                  start.x = (be::F32)child[1].value();
-                  start.y = (be::F32)child[2].value();
-               }
-               break;
-
-            case node_type::n_end:
-               if (child.size() >= 3) {
-                  end.x = (be::F32)child[1].value();
-                  end.y = (be::F32)child[2].value();
-               }
-               break;
+// Hashes which parts of a module a predicate accepts, without rendering any.
+struct AcceptedParts {
+   const RenderItemPredicate& pred;
+   const SegmentDensities& densities;
+   be::U64 hash;
+   bool any = false;
 
-            case node_type::n_width:
-               if (child.size() >= 2) {
-                  width = (be::F32)child[1].value();
-               }
-               break;
-         }
-      }
+   template <typename F>
+   void emit(const BoardModel& model, model_item type, std::size_t i, F&&) {
+      bool accepted = pred(model, type, i);
+      hash = (hash ^ (accepted ? 2 : 1)) * 0x100000001b3ull;
+      hash ^= hash >> 32;
+      any = any || accepted;
+   }
 
-      render_line(start, end, width, transform, out);
+   template <typename F>
+   void emit_shape(const BoardModel& model, model_item type, std::size_t i, const ShapeKey&, const glm::mat3&, F&& tessellate) {
+      emit(model, type, i, tessellate);
    }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+void PredicateOutput::emit_module(const BoardModel& model, be::U32, const BoardModel::ItemStart& begin, const BoardModel::ItemStart& end) {
+   render_module_body(model, begin, end, *this, false);
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_via(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto [render_self, render_children] = pred(node, stack);
-   if (!render_self && !render_children) {
+// A module sharing its footprint with others becomes one instance for each
+// bucket with InstancedShapes that draws any of it.  The shape is keyed on
+// the footprint and on which of its parts the bucket draws, so it's
+// tessellated once per footprint rather than once per module.
+void BucketOutput::emit_module(const BoardModel& model, be::U32 module, const BoardModel::ItemStart& begin, const BoardModel::ItemStart& end) {
+   be::U32 footprint = model.modules.footprint[module];
+   if (skip_instanced || model.footprints.count[footprint] < 2) {
+      render_module_body(model, begin, end, *this, false);
       return;
    }
 
-   glm::vec2 at;
-   be::F32 size = 0;
-   const Node* drill = nullptr;
-
-   for (auto& child : node) {
-      switch (get_node_type(child)) {
-         case node_type::n_at:
-            if (child.size() >= 3) {
-               at.x = (be::F32)child[1].value();
-               at.y = (be::F32)child[2].value();
-            }
-            break;
-
-         case node_type::n_size:
-            if (child.size() >= 2) {
-               size = (be::F32)child[1].value();
-            }
-            break;
+   for (const Bucket& bucket : buckets) {
+      if (!bucket.shapes) {
+         continue;
+      }
 
-         case node_type::n_drill:
-            drill = &child;
-            break;
+      AcceptedParts parts { bucket.pred, densities, model.footprints.hash[footprint] };
+      render_module_body(model, begin, end, parts, true);
+      if (!parts.any) {
+         continue;
       }
-   }
-   
-   if (render_self && size > 0) {
-      be::U32 n = 0;
-      glm::vec2 root;
-      glm::vec2 last;
-      discretize_circle(at, size / 2.f, pad_segments, [&](glm::vec2 v) {
-         if (n >= 2) {
-            render_triangle(root, last, v, transform, out);
-         } else if (n == 0) {
-            root = v;
-         }
-         last = v;
-         ++n;
+
+      ShapeKey key { instanced_shape::footprint, densities.pads, glm::vec2((be::F32)densities.arcs, (be::F32)densities.endcaps),
+                     glm::vec2(densities.max_error, 0.f), parts.hash };
+      be::U32 shape = bucket.shapes->shape(key, [&](IndexedMesh& out) {
+         PredicateOutput local { bucket.pred, out, densities };
+         render_module_body(model, begin, end, local, true);
       });
+      bucket.shapes->add(shape, model.modules.transform[module]);
    }
 
-   if (render_children && drill) {
-      glm::mat3 drill_transform = transform * translation(at);
-      stack.push_back(drill);
-      render_drill(stack, pred, drill_transform, out);
-      stack.pop_back();
-   }
+   BucketOutput rest { buckets, accepted, scratch, densities, true };
+   render_module_body(model, begin, end, rest, false);
 }
 
 //////////////////////////////////////////////////////////////////////////////
-void render_zone(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   const Node& node = *stack.back();
-   auto[render_self, render_children] = pred(node, stack);
-
-   if (render_self) {
-      be::F32 width = 0;
+template <typename Output>
+void render_item(const BoardModel& model, std::size_t item, Output& output) {
+   const BoardModel::ItemStart& begin = model.items[item];
+   const BoardModel::ItemStart& end = model.items[item + 1];
 
-      auto thickness_it = find(node, "min_thickness"sv);
-      if (thickness_it != node.end()) {
-         auto& child = *thickness_it;
-         if (child.size() >= 2) {
-            width = (be::F32)child[1].value();
-         }
-      }
-
-      for (auto& child : node) {
-         if (get_node_type(child) == node_type::n_filled_polygon) {
-            auto it = find(child, "pts"sv);
-            if (it != child.end()) {
-               std::vector<glm::vec2> points;
-               for (auto& p : *it) {
-                  if (p.size() >= 3 && get_node_type(p) == node_type::n_xy) {
-                     points.push_back(glm::vec2((be::F32)p[1].value(), (be::F32)p[2].value()));
-                  }
-               }
-               auto n = out.size();
-               std::deque<edge> edges;
-               make_dcel(points, edges);
-               auto n_edges = edges.size();
-               triangulate_polygon(edges, out);
-
-               for (auto oit = out.begin() + n, end = out.end(); oit != end; ++oit) {
-                  triangle& tri = *oit;
-                  tri.v[0] = glm::vec2(transform * glm::vec3(tri.v[0], 1.f));
-                  tri.v[1] = glm::vec2(transform * glm::vec3(tri.v[1], 1.f));
-                  tri.v[2] = glm::vec2(transform * glm::vec3(tri.v[2], 1.f));
-               }
-
-               if (zone_segments > 0 && width > 0) {
-                  for (auto zit = edges.begin(), end = zit + n_edges; zit != end; ++zit) {
-                     if (zit->next) {
-                        render_zone_line(zit->origin, zit->next->origin, width, transform, out);
-                     }
-                  }
-               }
-            }
-         }
-      }
+   be::U32 module = BoardModel::none;
+   if (begin.graphics < end.graphics) {
+      module = model.graphics.module[begin.graphics];
+   } else if (begin.pads < end.pads) {
+      module = model.pads.module[begin.pads];
    }
-}
 
-//////////////////////////////////////////////////////////////////////////////
-void render_root(std::vector<const Node*>& stack, const RenderNodePredicate& pred, const glm::mat3& transform, std::vector<triangle>& out) {
-   auto& parser = node_type_parser();
-   for (const Node& child : *stack.back()) {
-      if (!child.empty()) {
-         node_type child_type = parser.parse(child[0].text());
-         if (child_type != node_type::ignored) {
-            stack.push_back(&child);
-            switch (child_type) {
-               case node_type::n_kicad_pcb: render_root(stack, pred, transform, out); break;
-               case node_type::n_gr_line:   render_gr_line(stack, pred, transform, out); break;
-               case node_type::n_gr_arc:    render_gr_arc(stack, pred, transform, out); break;
-               case node_type::n_gr_circle: render_gr_circle(stack, pred, transform, out); break;
-               case node_type::n_gr_text:   render_gr_text(stack, pred, transform, out); break;
-               case node_type::n_module:    render_module(stack, pred, transform, out); break;
-               case node_type::n_segment:   render_segment(stack, pred, transform, out); break;
-               case node_type::n_via:       render_via(stack, pred, transform, out); break;
-               case node_type::n_zone:      render_zone(stack, pred, transform, out); break;
-            }
-            stack.pop_back();
-         }
+   if (module != BoardModel::none) {
+      output.emit_module(model, module, begin, end);
+   } else {
+      for (std::size_t i = begin.graphics; i < end.graphics; ++i) {
+         render_graphic(model, i, output);
       }
    }
+   for (std::size_t i = begin.segments; i < end.segments; ++i) {
+      render_segment(model, i, output);
+   }
+   for (std::size_t i = begin.vias; i < end.vias; ++i) {
+      render_via(model, i, output);
+   }
+   for (std::size_t i = begin.zones; i < end.zones; ++i) {
+      render_zone(model, i, output);
+   }
 }
 
 } // ::()
 
 //////////////////////////////////////////////////////////////////////////////
 be::U32 pad_segment_density() {
-   return pad_segments;
+   return pad_density;
 }
 //////////////////////////////////////////////////////////////////////////////
 void pad_segment_density(be::U32 segments_per_circle) {
-   pad_segments = segments_per_circle;
+   pad_density = segments_per_circle;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 be::U32 endcap_segment_density() {
-   return endcap_segments;
+   return endcap_density;
 }
 //////////////////////////////////////////////////////////////////////////////
 void endcap_segment_density(be::U32 segments_per_circle) {
-   endcap_segments = segments_per_circle;
+   endcap_density = segments_per_circle;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 be::U32 arc_segment_density() {
-   return arc_segments;
+   return arc_density;
 }
 //////////////////////////////////////////////////////////////////////////////
 void arc_segment_density(be::U32 segments_per_circle) {
-   arc_segments = segments_per_circle;
+   arc_density = segments_per_circle;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 be::U32 zone_perimeter_endcap_segment_density() {
-   return zone_segments;
+   return zone_endcap_density;
 }
 //////////////////////////////////////////////////////////////////////////////
 void zone_perimeter_endcap_segment_density(be::U32 segments_per_circle) {
-   zone_segments = segments_per_circle;
+   zone_endcap_density = segments_per_circle;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+SegmentDensities segment_densities() {
+   return SegmentDensities { pad_density, endcap_density, arc_density, zone_endcap_density };
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// discretize_circle() and discretize_arc() put the circle between a polygon's
+// vertices and the middles of its edges, so n segments stray from a circle of
+// radius r by r (1 - cos(pi/n)) / (1 + cos(pi/n)).
+be::U32 SegmentDensities::fit(be::U32 max_segments, be::F32 radius) const noexcept {
+   if (max_error <= 0 || max_segments <= lod_levels[0]) {
+      return max_segments;
+   }
+
+   static const auto level_cos = [] {
+      std::array<be::F32, n_lod_levels> result;
+      for (std::size_t l = 0; l < n_lod_levels; ++l) {
+         result[l] = std::cos(glm::pi<be::F32>() / lod_levels[l]);
+      }
+      return result;
+   }();
+
+   if (radius <= max_error) {
+      return lod_levels[0];
+   }
+
+   be::F32 e = max_error / radius;
+   be::F32 min_cos = (1.f - e) / (1.f + e);
+   for (std::size_t l = 0; l < n_lod_levels && lod_levels[l] < max_segments; ++l) {
+      if (level_cos[l] >= min_cos) {
+         return lod_levels[l];
+      }
+   }
+   return max_segments;
 }
 
 //////////////////////////////////////////////////////////////////////////////
-std::vector<triangle> render_layer(const Node& node, const RenderNodePredicate& pred) {
-   std::vector<triangle> out;
-   std::vector<const Node*> stack;
-   stack.push_back(&node);
-   render_root(stack, pred, glm::mat3(), out);
+IndexedMesh render_layer(const BoardModel& model, const RenderItemPredicate& pred) {
+   SegmentDensities densities = segment_densities();
+   IndexedMesh out;
+   PredicateOutput output { pred, out, densities };
+   for (std::size_t i = 0, n = model.size(); i < n; ++i) {
+      render_item(model, i, output);
+   }
    return out;
 }
+
+//////////////////////////////////////////////////////////////////////////////
+void render_layer_item(const BoardModel& model, std::size_t item, const RenderItemPredicate& pred, IndexedMesh& out) {
+   SegmentDensities densities = segment_densities();
+   PredicateOutput output { pred, out, densities };
+   render_item(model, item, output);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+void render_layer_net(const BoardModel& model, be::U32 net, const RenderItemPredicate& pred, IndexedMesh& out,
+                      const SegmentDensities& densities, const BoardModel::Bounds& region) {
+   auto for_each_member = [&](BoardModel::Span span, const std::vector<be::U32>& items, auto&& func) {
+      for (be::U32 m = span.begin, end = span.begin + span.count; m < end; ++m) {
+         be::U32 i = model.net_members[m];
+         if (region.overlaps(model.item_bounds[items[i]])) {
+            func(i);
+         }
+      }
+   };
+
+   PredicateOutput output { pred, out, densities };
+   const BoardModel::Nets& nets = model.nets;
+   for_each_member(nets.pads[net], model.pads.item, [&](be::U32 i) { render_pad(model, i, output); });
+   for_each_member(nets.segments[net], model.segments.item, [&](be::U32 i) { render_segment(model, i, output); });
+   for_each_member(nets.vias[net], model.vias.item, [&](be::U32 i) { render_via(model, i, output); });
+   for_each_member(nets.zones[net], model.zones.item, [&](be::U32 i) { render_zone(model, i, output); });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+void LayerBuckets::add(RenderItemPredicate pred, IndexedMesh& mesh, InstancedShapes* shapes,
+                       std::vector<be::U32>* item_ends, std::vector<be::U32>* instance_ends) {
+   buckets_.push_back(Bucket { std::move(pred), &mesh, shapes, item_ends, instance_ends });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+void render_layers_item(const BoardModel& model, std::size_t item, LayerBuckets& buckets) {
+   if (!buckets.region_.overlaps(model.item_bounds[item])) {
+      return;
+   }
+
+   BucketOutput output { buckets.buckets_, buckets.accepted_, buckets.scratch_, buckets.densities_ };
+   render_item(model, item, output);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// In parallel, each chunk of items is rendered into buckets of its own, which
+// are appended to the real ones in chunk order once they're all done.  Since
+// InstancedShapes::append() numbers new shapes in the order their first
+// instances arrive, just as rendering serially does, the result is the same.
+void render_layers(const BoardModel& model, LayerBuckets& buckets, std::size_t begin, std::size_t end,
+                   bool parallel, const std::atomic<bool>* cancel) {
+   constexpr std::size_t chunks_per_worker = 8;
+   constexpr std::size_t min_chunk_items = 64;
+
+   auto render_items = [&](std::size_t begin, std::size_t end, LayerBuckets& out) {
+      for (std::size_t i = begin; i < end; ++i) {
+         if (cancel && *cancel) {
+            return;
+         }
+         render_layers_item(model, i, out);
+         for (const LayerBuckets::Bucket& bucket : out.buckets_) {
+            if (bucket.item_ends) {
+               bucket.item_ends->push_back((be::U32)bucket.mesh->triangles());
+            }
+            if (bucket.instance_ends) {
+               bucket.instance_ends->push_back(bucket.shapes ? (be::U32)bucket.shapes->instances().size() : 0);
+            }
+         }
+      }
+   };
+
+   if (buckets.buckets_.empty()) {
+      return;
+   }
+
+   end = std::min(end, model.size());
+   if (begin >= end) {
+      return;
+   }
+
+   std::size_t n_items = end - begin;
+   std::size_t chunk_items = std::max(min_chunk_items, n_items / (worker_count() * chunks_per_worker) + 1);
+   std::size_t n_chunks = (n_items + chunk_items - 1) / chunk_items;
+   if (!parallel || n_chunks <= 1 || worker_count() <= 1) {
+      render_items(begin, end, buckets);
+      return;
+   }
+
+   struct ChunkBucket {
+      IndexedMesh mesh;
+      InstancedShapes shapes;
+      std::vector<be::U32> item_ends;
+      std::vector<be::U32> instance_ends;
+   };
+
+   std::size_t n_buckets = buckets.buckets_.size();
+   std::vector<ChunkBucket> chunks(n_chunks * n_buckets);
+   parallel_for(n_chunks, [&](std::size_t c) {
+      LayerBuckets local(buckets.densities_, buckets.region_);
+      for (std::size_t b = 0; b < n_buckets; ++b) {
+         const LayerBuckets::Bucket& bucket = buckets.buckets_[b];
+         ChunkBucket& chunk = chunks[c * n_buckets + b];
+         local.add(bucket.pred, chunk.mesh, bucket.shapes ? &chunk.shapes : nullptr, &chunk.item_ends, &chunk.instance_ends);
+      }
+      render_items(begin + c * chunk_items, begin + std::min(n_items, (c + 1) * chunk_items), local);
+   });
+
+   if (cancel && *cancel) {
+      return;
+   }
+
+   for (std::size_t b = 0; b < n_buckets; ++b) {
+      const LayerBuckets::Bucket& bucket = buckets.buckets_[b];
+      std::size_t vertices = bucket.mesh->vertices.size();
+      std::size_t indices = bucket.mesh->indices.size();
+      for (std::size_t c = 0; c < n_chunks; ++c) {
+         vertices += chunks[c * n_buckets + b].mesh.vertices.size();
+         indices += chunks[c * n_buckets + b].mesh.indices.size();
+      }
+      bucket.mesh->vertices.reserve(vertices);
+      bucket.mesh->indices.reserve(indices);
+   }
+
+   for (std::size_t c = 0; c < n_chunks; ++c) {
+      for (std::size_t b = 0; b < n_buckets; ++b) {
+         const LayerBuckets::Bucket& bucket = buckets.buckets_[b];
+         ChunkBucket& chunk = chunks[c * n_buckets + b];
+
+         be::U32 tri_base = (be::U32)bucket.mesh->triangles();
+         bucket.mesh->append(chunk.mesh);
+         if (bucket.item_ends) {
+            for (be::U32 end : chunk.item_ends) {
+               bucket.item_ends->push_back(tri_base + end);
+            }
+         }
+
+         be::U32 instance_base = 0;
+         if (bucket.shapes) {
+            instance_base = (be::U32)bucket.shapes->instances().size();
+            bucket.shapes->append(chunk.shapes, 0, chunk.shapes.instances().size());
+         }
+         if (bucket.instance_ends) {
+            for (be::U32 end : chunk.instance_ends) {
+               bucket.instance_ends->push_back(instance_base + end);
+            }
+         }
+
+         chunk = ChunkBucket();
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+void render_layers(const BoardModel& model, LayerBuckets& buckets, bool parallel, const std::atomic<bool>* cancel) {
+   render_layers(model, buckets, 0, model.size(), parallel, cancel);
+}
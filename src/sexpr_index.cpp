@@ -0,0 +1,168 @@
+#include "sexpr_index.hpp"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define KIVIEW_SEXPR_INDEX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KIVIEW_SEXPR_INDEX_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t block_size = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+struct BlockMasks {
+   be::U64 quote;
+   be::U64 paren;
+   be::U64 space;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+BlockMasks classify_scalar(const char* block) {
+   BlockMasks masks { };
+   for (std::size_t i = 0; i < block_size; ++i) {
+      const be::U64 bit = 1ull << i;
+      switch (block[i]) {
+         case '"': masks.quote |= bit; break;
+         case '(':
+         case ')': masks.paren |= bit; break;
+         case ' ':
+         case '\t':
+         case '\r':
+         case '\n': masks.space |= bit; break;
+      }
+   }
+   return masks;
+}
+
+#if defined(KIVIEW_SEXPR_INDEX_AVX2)
+
+///////////////////////////////////////////////////////////////////////////////
+BlockMasks classify(const char* block) {
+   BlockMasks masks { };
+   for (std::size_t i = 0; i < block_size; i += 32) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+      const __m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+      const __m256i paren = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(')')));
+      const __m256i space = _mm256_or_si256(
+         _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+         _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+      masks.quote |= (be::U64)(be::U32)_mm256_movemask_epi8(quote) << i;
+      masks.paren |= (be::U64)(be::U32)_mm256_movemask_epi8(paren) << i;
+      masks.space |= (be::U64)(be::U32)_mm256_movemask_epi8(space) << i;
+   }
+   return masks;
+}
+
+#elif defined(KIVIEW_SEXPR_INDEX_SSE2)
+
+///////////////////////////////////////////////////////////////////////////////
+BlockMasks classify(const char* block) {
+   BlockMasks masks { };
+   for (std::size_t i = 0; i < block_size; i += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+      const __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+      const __m128i paren = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('(')),
+                                         _mm_cmpeq_epi8(v, _mm_set1_epi8(')')));
+      const __m128i space = _mm_or_si128(
+         _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+         _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+      masks.quote |= (be::U64)(be::U16)_mm_movemask_epi8(quote) << i;
+      masks.paren |= (be::U64)(be::U16)_mm_movemask_epi8(paren) << i;
+      masks.space |= (be::U64)(be::U16)_mm_movemask_epi8(space) << i;
+   }
+   return masks;
+}
+
+#else
+
+///////////////////////////////////////////////////////////////////////////////
+BlockMasks classify(const char* block) {
+   return classify_scalar(block);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Bit i of the result is the parity of bits 0..i of x.
+be::U64 prefix_xor(be::U64 x) {
+   x ^= x << 1;
+   x ^= x << 2;
+   x ^= x << 4;
+   x ^= x << 8;
+   x ^= x << 16;
+   x ^= x << 32;
+   return x;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 count_trailing_zeros(be::U64 x) {
+#ifdef _MSC_VER
+   unsigned long index;
+   _BitScanForward64(&index, x);
+   return (be::U32)index;
+#else
+   return (be::U32)__builtin_ctzll(x);
+#endif
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+bool SexprIndexer::simd() noexcept {
+#if defined(KIVIEW_SEXPR_INDEX_AVX2) || defined(KIVIEW_SEXPR_INDEX_SSE2)
+   return true;
+#else
+   return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool SexprIndexer::next(std::vector<be::U32>& out) {
+   const std::size_t chunk_end = std::min(offset_ + chunk_size, text_.size());
+   char tail[block_size];
+
+   while (offset_ < chunk_end) {
+      const char* block = text_.data() + offset_;
+      if (text_.size() - offset_ < block_size) {
+         // pad the final partial block with whitespace
+         std::memset(tail, ' ', block_size);
+         std::memcpy(tail, block, text_.size() - offset_);
+         block = tail;
+      }
+
+      const BlockMasks masks = scalar_ ? classify_scalar(block) : classify(block);
+
+      const be::U64 in_string = prefix_xor(masks.quote) ^ in_string_;
+      in_string_ = (be::U64)((be::I64)in_string >> 63);
+
+      const be::U64 delim = masks.quote | masks.paren | masks.space;
+      const be::U64 after_delim = (delim << 1) | prev_delim_;
+      prev_delim_ = delim >> 63;
+
+      const be::U64 opening_quotes = masks.quote & in_string;
+      if (opening_quotes & ~after_delim) {
+         irregular_ = true;
+      }
+
+      const be::U64 atom_starts = ~delim & ~in_string & after_delim;
+      be::U64 events = (masks.paren & ~in_string) | opening_quotes | atom_starts;
+
+      while (events) {
+         out.push_back((be::U32)(offset_ + count_trailing_zeros(events)));
+         events &= events - 1;
+      }
+
+      offset_ += block_size;
+   }
+
+   return offset_ < text_.size();
+}
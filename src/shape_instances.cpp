@@ -0,0 +1,125 @@
+#include "shape_instances.hpp"
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+be::U32 float_bits(be::F32 value) noexcept {
+   be::U32 bits;
+   std::memcpy(&bits, &value, sizeof(bits));
+   return bits;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U64 next_revision() noexcept {
+   static std::atomic<be::U64> last { 0 };
+   return ++last;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+// Compares bits rather than values, to agree with KeyHash.
+bool operator==(const ShapeKey& a, const ShapeKey& b) noexcept {
+   return a.shape == b.shape && a.segments == b.segments && a.footprint == b.footprint
+      && float_bits(a.size.x) == float_bits(b.size.x) && float_bits(a.size.y) == float_bits(b.size.y)
+      && float_bits(a.rect_delta.x) == float_bits(b.rect_delta.x) && float_bits(a.rect_delta.y) == float_bits(b.rect_delta.y);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t InstancedShapes::KeyHash::operator()(const ShapeKey& key) const noexcept {
+   be::U64 h = ((be::U64)key.shape * 0x9e3779b97f4a7c15ull ^ key.segments) + key.footprint;
+   for (be::F32 value : { key.size.x, key.size.y, key.rect_delta.x, key.rect_delta.y }) {
+      h = (h ^ float_bits(value)) * 0x100000001b3ull;
+      h ^= h >> 29;
+   }
+   return (std::size_t)h;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+InstancedShapes::InstancedShapes(InstancedShapes&& other) noexcept
+   : keys_(std::move(other.keys_)),
+     ids_(std::move(other.ids_)),
+     shape_starts_(std::move(other.shape_starts_)),
+     vertex_starts_(std::move(other.vertex_starts_)),
+     mesh_(std::move(other.mesh_)),
+     instances_(std::move(other.instances_)),
+     revision_(other.revision_) {
+   other.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+InstancedShapes& InstancedShapes::operator=(InstancedShapes&& other) noexcept {
+   if (this != &other) {
+      keys_ = std::move(other.keys_);
+      ids_ = std::move(other.ids_);
+      shape_starts_ = std::move(other.shape_starts_);
+      vertex_starts_ = std::move(other.vertex_starts_);
+      mesh_ = std::move(other.mesh_);
+      instances_ = std::move(other.instances_);
+      revision_ = other.revision_;
+      other.clear();
+   }
+   return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void InstancedShapes::add(be::U32 shape, const glm::mat3& transform) {
+   instances_.push_back(Instance { shape, glm::vec2(transform[0]), glm::vec2(transform[1]), glm::vec2(transform[2]) });
+   revision_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void InstancedShapes::append(const InstancedShapes& other, std::size_t begin, std::size_t end) {
+   constexpr be::U32 unmapped = ~(be::U32)0;
+   std::vector<be::U32> ids(other.keys_.size(), unmapped);
+   for (std::size_t i = begin; i < end; ++i) {
+      Instance instance = other.instances_[i];
+      be::U32& id = ids[instance.shape];
+      if (id == unmapped) {
+         id = shape(other.keys_[instance.shape], [&](IndexedMesh& out) {
+            out.append(other.mesh_, other.shape_starts_[instance.shape], other.shape_starts_[instance.shape + 1]);
+         });
+      }
+      instance.shape = id;
+      instances_.push_back(instance);
+   }
+   revision_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void InstancedShapes::expand(std::size_t begin, std::size_t end, IndexedMesh& out) const {
+   for (std::size_t i = begin; i < end; ++i) {
+      const Instance& instance = instances_[i];
+      be::U32 first = vertex_starts_[instance.shape];
+      be::U32 base = (be::U32)out.vertices.size();
+
+      for (be::U32 v = first, v_end = vertex_starts_[instance.shape + 1]; v < v_end; ++v) {
+         glm::vec2 p = mesh_.vertices[v];
+         out.vertices.push_back(instance.x_axis * p.x + instance.y_axis * p.y + instance.origin);
+      }
+      for (be::U32 x = shape_starts_[instance.shape] * 3, x_end = shape_starts_[instance.shape + 1] * 3; x < x_end; ++x) {
+         out.indices.push_back(base + mesh_.indices[x] - first);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void InstancedShapes::clear() {
+   keys_.clear();
+   ids_.clear();
+   shape_starts_.assign(1, 0);
+   vertex_starts_.assign(1, 0);
+   mesh_.clear();
+   instances_.clear();
+   revision_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::U64 InstancedShapes::revision() const noexcept {
+   if (revision_ == 0) {
+      revision_ = next_revision();
+   }
+   return revision_;
+}
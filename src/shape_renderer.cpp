@@ -0,0 +1,288 @@
+#include "shape_renderer.hpp"
+#include <be/core/logging.hpp>
+#include <be/gfx/bgl.hpp>
+
+using namespace be;
+using namespace be::gfx::gl;
+
+namespace {
+
+// Per-instance attributes after the shape's vertex position; in
+// compatibility contexts the fixed function matrices and color still apply.
+const char* vertex_source = R"(#version 120
+attribute vec2 position;
+attribute vec2 x_axis;
+attribute vec2 y_axis;
+attribute vec2 origin;
+void main() {
+   vec2 p = x_axis * position.x + y_axis * position.y + origin;
+   gl_Position = gl_ModelViewProjectionMatrix * vec4(p, 0.0, 1.0);
+   gl_FrontColor = gl_Color;
+}
+)";
+
+const char* fragment_source = R"(#version 120
+void main() {
+   gl_FragColor = gl_Color;
+}
+)";
+
+// Each instance is its transform's columns.
+constexpr GLsizei instance_stride = 6 * sizeof(be::F32);
+
+///////////////////////////////////////////////////////////////////////////////
+GLuint compile_shader(GLenum type, const char* source) {
+   //#bgl checked(GL_VERSION_3_3)
+   GLuint shader = glCreateShader(type);
+   glShaderSource(shader, 1, &source, nullptr);
+   glCompileShader(shader);
+
+   GLint status = GL_FALSE;
+   glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+   if (status != GL_TRUE) {
+      GLchar log[1024] = {};
+      glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+      be_warn() << "Could not compile shape shader"
+         & attr(ids::log_attr_message) << S(log)
+         | default_log();
+      glDeleteShader(shader);
+      return 0;
+   }
+   //#bgl unchecked
+
+   return shader;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+ShapeRenderer::ShapeRenderer() {
+   if (!GL_VERSION_3_3) {
+      return;
+   }
+
+   //#bgl checked(GL_VERSION_3_3)
+   GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_source);
+   GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+   if (vertex && fragment) {
+      GLuint program = glCreateProgram();
+      glAttachShader(program, vertex);
+      glAttachShader(program, fragment);
+      glBindAttribLocation(program, 0, "position");
+      glBindAttribLocation(program, 1, "x_axis");
+      glBindAttribLocation(program, 2, "y_axis");
+      glBindAttribLocation(program, 3, "origin");
+      glLinkProgram(program);
+
+      GLint status = GL_FALSE;
+      glGetProgramiv(program, GL_LINK_STATUS, &status);
+      if (status == GL_TRUE) {
+         program_ = program;
+      } else {
+         GLchar log[1024] = {};
+         glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+         be_warn() << "Could not link shape shader"
+            & attr(ids::log_attr_message) << S(log)
+            | default_log();
+         glDeleteProgram(program);
+      }
+   }
+
+   if (vertex) {
+      glDeleteShader(vertex);
+   }
+   if (fragment) {
+      glDeleteShader(fragment);
+   }
+   //#bgl unchecked
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShapeRenderer::~ShapeRenderer() {
+   if (program_) {
+      //#bgl checked(GL_VERSION_3_3)
+      glDeleteProgram(program_);
+      //#bgl unchecked
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShapeBuffers::~ShapeBuffers() {
+   release_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShapeBuffers::ShapeBuffers(ShapeBuffers&& other) noexcept
+   : shape_buffer_(other.shape_buffer_),
+     index_buffer_(other.index_buffer_),
+     instance_buffer_(other.instance_buffer_),
+     batches_(std::move(other.batches_)),
+     expanded_(std::move(other.expanded_)),
+     revision_(other.revision_),
+     hidden_version_(other.hidden_version_) {
+   other.shape_buffer_ = 0;
+   other.index_buffer_ = 0;
+   other.instance_buffer_ = 0;
+   other.revision_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShapeBuffers& ShapeBuffers::operator=(ShapeBuffers&& other) noexcept {
+   if (this != &other) {
+      release_();
+      shape_buffer_ = other.shape_buffer_;
+      index_buffer_ = other.index_buffer_;
+      instance_buffer_ = other.instance_buffer_;
+      batches_ = std::move(other.batches_);
+      expanded_ = std::move(other.expanded_);
+      revision_ = other.revision_;
+      hidden_version_ = other.hidden_version_;
+      other.shape_buffer_ = 0;
+      other.index_buffer_ = 0;
+      other.instance_buffer_ = 0;
+      other.revision_ = 0;
+   }
+   return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShapeBuffers::update(const ShapeRenderer& renderer, const InstancedShapes& shapes,
+                          const std::vector<be::U32>& instance_ends, const std::vector<bool>& hidden_items, be::U32 hidden_version) {
+   if (revision_ == shapes.revision() && hidden_version_ == hidden_version) {
+      return;
+   }
+
+   revision_ = shapes.revision();
+   hidden_version_ = hidden_version;
+   batches_.clear();
+   expanded_.clear();
+
+   const std::vector<InstancedShapes::Instance>& instances = shapes.instances();
+   bool hiding = instance_ends.size() == hidden_items.size();
+   auto for_each_shown = [&](auto&& func) {
+      if (!hiding) {
+         func((std::size_t)0, instances.size());
+         return;
+      }
+      be::U32 begin = 0;
+      for (std::size_t i = 0, n = instance_ends.size(); i < n; ++i) {
+         if (!hidden_items[i] && begin < instance_ends[i]) {
+            func((std::size_t)begin, (std::size_t)instance_ends[i]);
+         }
+         begin = instance_ends[i];
+      }
+   };
+
+   if (!renderer.instanced()) {
+      for_each_shown([&](std::size_t begin, std::size_t end) {
+         shapes.expand(begin, end, expanded_);
+      });
+      return;
+   }
+
+   // counting sort by shape, so each shape's instances are contiguous
+   const std::vector<be::U32>& shape_starts = shapes.shape_starts();
+   std::vector<be::U32> first(shapes.shapes() + 1, 0);
+   for_each_shown([&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+         ++first[instances[i].shape + 1];
+      }
+   });
+   for (std::size_t s = 0; s < shapes.shapes(); ++s) {
+      if (first[s + 1] > 0) {
+         batches_.push_back(Batch { shape_starts[s] * 3, (shape_starts[s + 1] - shape_starts[s]) * 3, first[s], first[s + 1] });
+      }
+      first[s + 1] += first[s];
+   }
+
+   std::vector<be::F32> data(first.back() * 6);
+   for_each_shown([&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+         const InstancedShapes::Instance& instance = instances[i];
+         be::F32* out = data.data() + (std::size_t)first[instance.shape]++ * 6;
+         out[0] = instance.x_axis.x;
+         out[1] = instance.x_axis.y;
+         out[2] = instance.y_axis.x;
+         out[3] = instance.y_axis.y;
+         out[4] = instance.origin.x;
+         out[5] = instance.origin.y;
+      }
+   });
+
+   //#bgl checked(GL_VERSION_3_3)
+   if (!shape_buffer_) {
+      glGenBuffers(1, &shape_buffer_);
+      glGenBuffers(1, &index_buffer_);
+      glGenBuffers(1, &instance_buffer_);
+   }
+
+   const IndexedMesh& mesh = shapes.mesh();
+   glBindBuffer(GL_ARRAY_BUFFER, shape_buffer_);
+   glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(mesh.vertices.size() * sizeof(glm::vec2)), mesh.vertices.data(), GL_STATIC_DRAW);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(mesh.indices.size() * sizeof(be::U32)), mesh.indices.data(), GL_STATIC_DRAW);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+   glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(data.size() * sizeof(be::F32)), data.data(), GL_STATIC_DRAW);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   //#bgl unchecked
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShapeBuffers::draw(const ShapeRenderer& renderer, bool wireframe) const {
+   if (batches_.empty() || !renderer.instanced()) {
+      return;
+   }
+
+   //#bgl checked(GL_VERSION_3_3)
+   glUseProgram(renderer.program_);
+   if (wireframe) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+   }
+
+   glBindBuffer(GL_ARRAY_BUFFER, shape_buffer_);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), nullptr);
+
+   glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+   for (GLuint a = 1; a <= 3; ++a) {
+      glEnableVertexAttribArray(a);
+      glVertexAttribDivisor(a, 1);
+   }
+
+   for (const Batch& batch : batches_) {
+      std::size_t offset = (std::size_t)batch.first_instance * instance_stride;
+      for (GLuint a = 1; a <= 3; ++a) {
+         glVertexAttribPointer(a, 2, GL_FLOAT, GL_FALSE, instance_stride, (const void*)(offset + (a - 1) * sizeof(glm::vec2)));
+      }
+      glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)batch.indices, GL_UNSIGNED_INT, (const void*)(batch.first_index * sizeof(be::U32)), (GLsizei)batch.instances);
+   }
+
+   for (GLuint a = 0; a <= 3; ++a) {
+      glVertexAttribDivisor(a, 0);
+      glDisableVertexAttribArray(a);
+   }
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   if (wireframe) {
+      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+   }
+   glUseProgram(0);
+   //#bgl unchecked
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShapeBuffers::release_() noexcept {
+   if (shape_buffer_) {
+      //#bgl checked(GL_VERSION_3_3)
+      glDeleteBuffers(1, &shape_buffer_);
+      glDeleteBuffers(1, &index_buffer_);
+      glDeleteBuffers(1, &instance_buffer_);
+      //#bgl unchecked
+      shape_buffer_ = 0;
+      index_buffer_ = 0;
+      instance_buffer_ = 0;
+   }
+}
@@ -0,0 +1,84 @@
+#include "transform.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define KIVIEW_TRANSFORM_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KIVIEW_TRANSFORM_SSE2
+#endif
+
+namespace {
+
+static_assert(sizeof(glm::vec2) == 2 * sizeof(be::F32), "vertices must be tightly packed coordinates");
+
+///////////////////////////////////////////////////////////////////////////////
+// Transforms the points in [begin, end), given as consecutive x and y
+// coordinates, the number of which must be even.
+void transform_points_scalar(const glm::mat3& m, be::F32* begin, be::F32* end) {
+   for (be::F32* p = begin; p < end; p += 2) {
+      be::F32 x = p[0];
+      be::F32 y = p[1];
+      p[0] = m[0][0] * x + m[1][0] * y + m[2][0];
+      p[1] = m[0][1] * x + m[1][1] * y + m[2][1];
+   }
+}
+
+#if defined(KIVIEW_TRANSFORM_AVX)
+
+///////////////////////////////////////////////////////////////////////////////
+// Each (x, y) is multiplied by the diagonal, and its swapped (y, x) by the
+// off diagonal, so the coordinates never need to be deinterleaved.
+void transform_points(const glm::mat3& m, be::F32* begin, be::F32* end) {
+   const __m256 diagonal = _mm256_setr_ps(m[0][0], m[1][1], m[0][0], m[1][1], m[0][0], m[1][1], m[0][0], m[1][1]);
+   const __m256 off_diagonal = _mm256_setr_ps(m[1][0], m[0][1], m[1][0], m[0][1], m[1][0], m[0][1], m[1][0], m[0][1]);
+   const __m256 origin = _mm256_setr_ps(m[2][0], m[2][1], m[2][0], m[2][1], m[2][0], m[2][1], m[2][0], m[2][1]);
+
+   be::F32* p = begin;
+   for (; end - p >= 8; p += 8) {
+      const __m256 v = _mm256_loadu_ps(p);
+      const __m256 swapped = _mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1));
+      _mm256_storeu_ps(p, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v, diagonal), _mm256_mul_ps(swapped, off_diagonal)), origin));
+   }
+   transform_points_scalar(m, p, end);
+}
+
+#elif defined(KIVIEW_TRANSFORM_SSE2)
+
+///////////////////////////////////////////////////////////////////////////////
+// Each (x, y) is multiplied by the diagonal, and its swapped (y, x) by the
+// off diagonal, so the coordinates never need to be deinterleaved.
+void transform_points(const glm::mat3& m, be::F32* begin, be::F32* end) {
+   const __m128 diagonal = _mm_setr_ps(m[0][0], m[1][1], m[0][0], m[1][1]);
+   const __m128 off_diagonal = _mm_setr_ps(m[1][0], m[0][1], m[1][0], m[0][1]);
+   const __m128 origin = _mm_setr_ps(m[2][0], m[2][1], m[2][0], m[2][1]);
+
+   be::F32* p = begin;
+   for (; end - p >= 4; p += 4) {
+      const __m128 v = _mm_loadu_ps(p);
+      const __m128 swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+      _mm_storeu_ps(p, _mm_add_ps(_mm_add_ps(_mm_mul_ps(v, diagonal), _mm_mul_ps(swapped, off_diagonal)), origin));
+   }
+   transform_points_scalar(m, p, end);
+}
+
+#else
+
+///////////////////////////////////////////////////////////////////////////////
+void transform_points(const glm::mat3& m, be::F32* begin, be::F32* end) {
+   transform_points_scalar(m, begin, end);
+}
+
+#endif
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+void transform_vertices(const glm::mat3& transform, std::vector<glm::vec2>& vertices, std::size_t first) {
+   if (first >= vertices.size() || transform == glm::mat3()) {
+      return;
+   }
+
+   be::F32* begin = &vertices[first].x;
+   transform_points(transform, begin, begin + (vertices.size() - first) * 2);
+}
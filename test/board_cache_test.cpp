@@ -0,0 +1,112 @@
+#include "test_board.hpp"
+#include "board_cache.hpp"
+#include "parse_parallel.hpp"
+#include "pcb_helper.hpp"
+#include <be/util/string_interner.hpp>
+#include <catch/catch.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// A board file in the temp directory, removed along with its cache.
+struct TempBoard {
+   be::S path;
+   be::S text;
+
+   explicit TempBoard(be::S board_text)
+      : path((std::filesystem::temp_directory_path() / "kiview_board_cache_test.kicad_pcb").string()),
+        text(std::move(board_text)) {
+      std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+      ofs.write(text.data(), (std::streamsize)text.size());
+   }
+
+   ~TempBoard() {
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+      std::filesystem::remove(BoardCache::path(path), ec);
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+be::S read_file(const be::S& path) {
+   std::ifstream ifs(path, std::ios::binary);
+   return be::S(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void write_file(const be::S& path, const be::S& contents) {
+   std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+   ofs.write(contents.data(), (std::streamsize)contents.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sexprs are stored exactly as they are in memory, so the root can be found
+// by its bytes; nodes before it are at 16 byte steps.
+std::size_t find_root(const be::S& cache, const NodeTree& tree) {
+   be::SV root(reinterpret_cast<const char*>(&tree.root()), sizeof(Node));
+   std::size_t pos = be::SV(cache).rfind(root);
+   REQUIRE(pos != be::SV::npos);
+   return pos;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("BoardCache round trips parsed boards", "[cache]") {
+   TempBoard board(make_test_board(8000, 8));
+   be::util::StringInterner si;
+   BoardCache::Key key = BoardCache::key(board.path, board.text);
+
+   NodeTree parsed = parse_parallel(board.text, si, true, classify_node);
+   BoardCache::write(board.path, key, parsed);
+
+   BoardCache cache;
+   REQUIRE(cache.open(board.path, key));
+   NodeTree cached = cache.tree();
+   REQUIRE(cached.size() == parsed.size());
+   REQUIRE(equivalent(parsed.root(), cached.root()));
+
+   BoardCache::Key other = key;
+   ++other.hash;
+   REQUIRE(!cache.open(board.path, other));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("BoardCache rejects nodes which refer outside the cache", "[cache]") {
+   TempBoard board(make_test_board(200, 9));
+   be::util::StringInterner si;
+   BoardCache::Key key = BoardCache::key(board.path, board.text);
+   NodeTree parsed = parse(board.text, si, true, classify_node);
+   BoardCache::write(board.path, key, parsed);
+
+   be::S cache_path = BoardCache::path(board.path);
+   const be::S good = read_file(cache_path);
+   std::size_t root = find_root(good, parsed);
+
+   // the offset to a sexpr's children or a text node's characters comes first
+   auto corrupt = [&](std::size_t node, std::ptrdiff_t offset) {
+      be::S bad = good;
+      std::memcpy(&bad[node], &offset, sizeof(offset));
+      write_file(cache_path, bad);
+      BoardCache cache;
+      return !cache.open(board.path, key);
+   };
+
+   const Node& pcb = parsed.root()[0];
+   std::size_t pcb_node = root - (std::size_t)(&parsed.root() - &pcb) * sizeof(Node);
+   std::size_t atom_node = root - (std::size_t)(&parsed.root() - &pcb[0]) * sizeof(Node);
+
+   REQUIRE(corrupt(root, 1));                                       // children after the sexpr
+   REQUIRE(corrupt(root, -(std::ptrdiff_t)parsed.size()));          // before the arena
+   REQUIRE(corrupt(pcb_node, 0));                                   // its own child
+   REQUIRE(corrupt(atom_node, (std::ptrdiff_t)good.size()));        // text past the end
+   REQUIRE(corrupt(atom_node, -(std::ptrdiff_t)sizeof(Node)));      // text inside the arena
+
+   write_file(cache_path, good);
+   BoardCache cache;
+   REQUIRE(cache.open(board.path, key));
+}
@@ -0,0 +1,202 @@
+#include "test_board.hpp"
+#include "board_model.hpp"
+#include "parse_parallel.hpp"
+#include "pcb_helper.hpp"
+#include "sexpr_scan.hpp"
+#include <be/util/string_interner.hpp>
+#include <catch/catch.hpp>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// The text of each sexpr inside the board's top-level sexpr.
+std::vector<be::S> board_items(be::SV text) {
+   std::vector<be::S> items;
+   std::size_t open = 0;
+   scan_sexpr(text, [&](sexpr_event event, std::size_t pos, std::size_t depth) {
+      if (depth == 1) {
+         if (event == sexpr_event::open) {
+            open = pos;
+         } else if (event == sexpr_event::close) {
+            items.emplace_back(text.substr(open, pos + 1 - open));
+         }
+      }
+      return true;
+   });
+   return items;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+be::S board_text(const std::vector<be::S>& items) {
+   be::S text = "(kicad_pcb";
+   for (const be::S& item : items) {
+      text.append("\n  ");
+      text.append(item);
+   }
+   text.append(")\n");
+   return text;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool defer_modules_and_zones(be::U8 keyword) {
+   return defer_node(keyword) || keyword == (be::U8)node_type::n_module || keyword == (be::U8)node_type::n_zone;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+bool same(const std::vector<T>& a, const std::vector<T>& b) {
+   return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct TestBoard {
+   be::S text;
+   be::util::StringInterner si;
+   NodeTree tree;
+   const Node* pcb = nullptr;
+
+   TestBoard(be::S board_text, LazyPredicate defer = nullptr)
+      : text(std::move(board_text)),
+        tree(parse_parallel(text, si, true, classify_node, defer)) {
+      Node::const_iterator it = find(tree.root(), "kicad_pcb"sv);
+      REQUIRE(it != tree.root().end());
+      pcb = &*it;
+   }
+};
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("build_board_model() copying unchanged items matches reading them", "[model]") {
+   std::vector<be::S> old_items = board_items(make_test_board(6000, 3));
+   std::vector<be::S> other_items = board_items(make_test_board(600, 4));
+
+   // drop some items, add others, and move a run of them to the end
+   std::vector<be::S> new_items;
+   for (std::size_t i = 0; i < old_items.size(); ++i) {
+      if (i % 7 == 3) {
+         continue;
+      }
+      new_items.push_back(old_items[i]);
+      if (i % 11 == 5 && i / 11 < other_items.size()) {
+         new_items.push_back(other_items[i / 11]);
+      }
+   }
+   std::rotate(new_items.begin() + 100, new_items.begin() + 400, new_items.end());
+
+   TestBoard old_board(board_text(old_items));
+   TestBoard new_board(board_text(new_items), defer_modules_and_zones);
+   BoardModel old_model = build_board_model(*old_board.pcb);
+   BoardModel fresh = build_board_model(*new_board.pcb);
+
+   std::unordered_map<be::S, std::vector<be::U32>> unmatched;
+   for (std::size_t i = old_items.size(); i-- > 0; ) {
+      unmatched[old_items[i]].push_back((be::U32)i);
+   }
+   // board item 0 is the kicad_pcb atom
+   std::vector<be::U32> reused(new_items.size() + 1, BoardModel::none);
+   std::size_t n_reused = 0;
+   for (std::size_t j = 0; j < new_items.size(); ++j) {
+      std::vector<be::U32>& candidates = unmatched[new_items[j]];
+      if (!candidates.empty()) {
+         reused[j + 1] = candidates.back() + 1;
+         candidates.pop_back();
+         ++n_reused;
+      }
+   }
+   REQUIRE(n_reused > new_items.size() / 2);
+   REQUIRE(n_reused < new_items.size());
+
+   BoardModel copied = build_board_model(*new_board.pcb, old_model, reused);
+
+   REQUIRE(same(copied.modules.node, fresh.modules.node));
+   REQUIRE(same(copied.modules.item, fresh.modules.item));
+   REQUIRE(same(copied.modules.at, fresh.modules.at));
+   REQUIRE(same(copied.modules.transform, fresh.modules.transform));
+   REQUIRE(same(copied.modules.layers, fresh.modules.layers));
+   REQUIRE(same(copied.modules.footprint, fresh.modules.footprint));
+   REQUIRE(copied.modules.name == fresh.modules.name);
+   REQUIRE(copied.modules.reference == fresh.modules.reference);
+   REQUIRE(copied.modules.value == fresh.modules.value);
+   REQUIRE(same(copied.footprints.hash, fresh.footprints.hash));
+   REQUIRE(same(copied.footprints.count, fresh.footprints.count));
+
+   REQUIRE(same(copied.graphics.item, fresh.graphics.item));
+   REQUIRE(same(copied.graphics.module, fresh.graphics.module));
+   REQUIRE(same(copied.graphics.shape, fresh.graphics.shape));
+   REQUIRE(same(copied.graphics.start, fresh.graphics.start));
+   REQUIRE(same(copied.graphics.end, fresh.graphics.end));
+   REQUIRE(same(copied.graphics.angle, fresh.graphics.angle));
+   REQUIRE(same(copied.graphics.width, fresh.graphics.width));
+   REQUIRE(same(copied.graphics.layers, fresh.graphics.layers));
+
+   REQUIRE(same(copied.pads.item, fresh.pads.item));
+   REQUIRE(same(copied.pads.module, fresh.pads.module));
+   REQUIRE(same(copied.pads.shape, fresh.pads.shape));
+   REQUIRE(same(copied.pads.transform, fresh.pads.transform));
+   REQUIRE(same(copied.pads.local_transform, fresh.pads.local_transform));
+   REQUIRE(same(copied.pads.size, fresh.pads.size));
+   REQUIRE(same(copied.pads.rect_delta, fresh.pads.rect_delta));
+   REQUIRE(same(copied.pads.drill, fresh.pads.drill));
+   REQUIRE(same(copied.pads.net, fresh.pads.net));
+   REQUIRE(same(copied.pads.layers, fresh.pads.layers));
+
+   REQUIRE(same(copied.segments.node, fresh.segments.node));
+   REQUIRE(same(copied.segments.item, fresh.segments.item));
+   REQUIRE(same(copied.segments.start, fresh.segments.start));
+   REQUIRE(same(copied.segments.end, fresh.segments.end));
+   REQUIRE(same(copied.segments.width, fresh.segments.width));
+   REQUIRE(same(copied.segments.layers, fresh.segments.layers));
+   REQUIRE(same(copied.segments.net, fresh.segments.net));
+
+   REQUIRE(same(copied.vias.node, fresh.vias.node));
+   REQUIRE(same(copied.vias.item, fresh.vias.item));
+   REQUIRE(same(copied.vias.at, fresh.vias.at));
+   REQUIRE(same(copied.vias.size, fresh.vias.size));
+   REQUIRE(same(copied.vias.drill, fresh.vias.drill));
+   REQUIRE(same(copied.vias.net, fresh.vias.net));
+   REQUIRE(same(copied.vias.layers, fresh.vias.layers));
+
+   REQUIRE(same(copied.zones.node, fresh.zones.node));
+   REQUIRE(same(copied.zones.item, fresh.zones.item));
+   REQUIRE(same(copied.zones.width, fresh.zones.width));
+   REQUIRE(same(copied.zones.net, fresh.zones.net));
+   REQUIRE(same(copied.zones.layers, fresh.zones.layers));
+   REQUIRE(same(copied.zones.polygons, fresh.zones.polygons));
+   REQUIRE(same(copied.polygons, fresh.polygons));
+   REQUIRE(same(copied.points, fresh.points));
+
+   REQUIRE(same(copied.nets.number, fresh.nets.number));
+   REQUIRE(copied.nets.name == fresh.nets.name);
+   REQUIRE(same(copied.nets.segments, fresh.nets.segments));
+   REQUIRE(same(copied.nets.vias, fresh.nets.vias));
+   REQUIRE(same(copied.nets.pads, fresh.nets.pads));
+   REQUIRE(same(copied.nets.zones, fresh.nets.zones));
+   REQUIRE(same(copied.net_members, fresh.net_members));
+
+   REQUIRE(same(copied.items, fresh.items));
+   REQUIRE(same(copied.item_bounds, fresh.item_bounds));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("build_board_model() copies module text out of the tree", "[model]") {
+   TestBoard board(make_test_board(200, 5));
+   BoardModel model = build_board_model(*board.pcb);
+   const BoardModel::Modules& modules = model.modules;
+   REQUIRE(modules.node.size() > 2);
+
+   board.text.assign(board.text.size(), ' ');
+   for (std::size_t i = 0, n = modules.node.size(); i < n; ++i) {
+      REQUIRE(modules.name[i] == "Resistor_SMD:R_0603_1608Metric");
+      REQUIRE(modules.reference[i].size() > 1);
+      REQUIRE(modules.reference[i][0] == 'R');
+      REQUIRE((modules.value[i] == "10k" || modules.value[i] == "100"));
+      REQUIRE(model.find_module(modules.node[i]) == i);
+   }
+   REQUIRE(model.find_module(board.pcb) == BoardModel::none);
+}
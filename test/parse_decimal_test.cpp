@@ -0,0 +1,79 @@
+#include "parse_decimal.hpp"
+#include <catch/catch.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// True if parse_decimal() and std::strtod() produce the same bits.
+bool matches_strtod(const be::S& text) {
+   be::F64 expected = std::strtod(text.c_str(), nullptr);
+   be::F64 actual = parse_decimal(text.data(), text.data() + text.size());
+   return std::memcmp(&expected, &actual, sizeof(be::F64)) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// significant digits, the first nonzero, with the point placed so that there
+// are fraction_digits after it; leading zeros are added where needed.
+be::S make_decimal(std::mt19937& rng, std::size_t significant, std::size_t fraction_digits, bool negative) {
+   std::uniform_int_distribution<int> digit(0, 9);
+   be::S digits(1, (char)('1' + digit(rng) % 9));
+   while (digits.size() < significant) {
+      digits.push_back((char)('0' + digit(rng)));
+   }
+
+   be::S text = negative ? "-" : "";
+   if (fraction_digits >= digits.size()) {
+      text.append("0.");
+      text.append(fraction_digits - digits.size(), '0');
+      text.append(digits);
+   } else {
+      text.append(digits, 0, digits.size() - fraction_digits);
+      if (fraction_digits > 0) {
+         text.push_back('.');
+         text.append(digits, digits.size() - fraction_digits, be::S::npos);
+      }
+   }
+   return text;
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_decimal() matches strtod() on edge cases", "[parse]") {
+   const char* const cases[] = {
+      "0", "-0", "+0", "-0.0", "-.0", "0.", ".0", "-", "+", ".", "-.",
+      "1", "-1", "+1.5", ".5", "5.", "007", "-0.000",
+      "9007199254740992", "9007199254740993", "9007199254740994", "9007199254740995",
+      "900719925474099.3", "90071992547409.93", "0.9007199254740993",
+      "18446744073709551615", "18446744073709551616", "99999999999999999999",
+      "0.1", "0.2", "0.3", "1.1", "2.675", "1.005", "0.000001",
+      "1234567890123456.7", "123456789012345.67", "12345678901234567.8",
+      "0.0000000000000000000001", "0.00000000000000000000001", "0.000000000000000000000001",
+      "1.0000000000000000000001", "10000000000000000000000", "100000000000000000000000",
+      "4.9406564584124654", "2.2250738585072014", "1.7976931348623157",
+      "3.14159265358979323846264338327950288419716939937510582097494459",
+      "0.30000000000000000000000000000000000000000000000000000000000001",
+   };
+
+   for (const char* text : cases) {
+      INFO(text);
+      REQUIRE(matches_strtod(text));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_decimal() matches strtod() on random decimals", "[parse]") {
+   std::mt19937 rng(4);
+   for (std::size_t significant : { 1, 7, 15, 16, 17, 18, 19, 20, 25, 40 }) {
+      for (std::size_t fraction_digits = 0; fraction_digits <= 45; ++fraction_digits) {
+         for (int i = 0; i < 200; ++i) {
+            be::S text = make_decimal(rng, significant, fraction_digits, i % 2 == 1);
+            INFO(text);
+            REQUIRE(matches_strtod(text));
+         }
+      }
+   }
+}
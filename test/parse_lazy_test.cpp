@@ -0,0 +1,39 @@
+#include "parse_lazy.hpp"
+#include "pcb_helper.hpp"
+#include <be/util/string_interner.hpp>
+#include <catch/catch.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_lazy() parses deferred subtrees on first access", "[parse]") {
+   be::S text = "(kicad_pcb (setup (last_trace_width 0.25) (grid_origin 0 0)) (net 0 \"\"))";
+   be::util::StringInterner si;
+
+   NodeTree serial = parse(text, si, true, classify_node);
+   NodeTree lazy = parse_lazy(text, si, classify_node, defer_node);
+   Node& setup = lazy.root()[0][1];
+   REQUIRE(setup.car() == "setup");
+   REQUIRE(setup.size() == 3);
+   REQUIRE(equivalent(serial.root(), lazy.root()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("A deferred subtree which fails to parse is left empty", "[parse]") {
+   be::util::StringInterner si;
+   auto context = std::make_shared<LazyContext>(si, classify_node);
+
+   // the outer parser only defers bracketed text, so build the tree by hand
+   NodeTreeBuilder builder(classify_node);
+   builder.set_lazy(context, defer_node);
+   builder.open();
+   builder.add("kicad_pcb");
+   builder.open();
+   REQUIRE(builder.should_defer("setup"));
+   builder.defer(") (", "setup");
+   NodeTree tree = builder.finish();
+
+   Node& setup = tree.root()[0][1];
+   REQUIRE(setup.car() == "setup");
+   REQUIRE(setup.size() == 0);
+   REQUIRE(setup.begin() == setup.end());
+   REQUIRE(setup.empty());
+}
@@ -0,0 +1,59 @@
+#include "test_board.hpp"
+#include "parse_parallel.hpp"
+#include "pcb_helper.hpp"
+#include <be/util/string_interner.hpp>
+#include <catch/catch.hpp>
+
+namespace {
+
+// large enough to be split into several chunks
+constexpr std::size_t large_board_items = 8000;
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_parallel() falls back to parse() for small boards", "[parse]") {
+   be::S text = make_test_board(50);
+   be::util::StringInterner si;
+
+   NodeTree serial = parse(text, si, true, classify_node);
+   NodeTree parallel = parse_parallel(text, si, true, classify_node);
+   REQUIRE(equivalent(serial.root(), parallel.root()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_parallel() builds the same tree as parse()", "[parse]") {
+   for (be::U32 seed : { 1, 2, 3, 4 }) {
+      be::S text = make_test_board(large_board_items + seed * 1000, seed);
+      be::util::StringInterner si;
+
+      NodeTree serial = parse(text, si, true, classify_node);
+      NodeTree parallel = parse_parallel(text, si, true, classify_node);
+      REQUIRE(serial.size() == parallel.size());
+      REQUIRE(equivalent(serial.root(), parallel.root()));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_parallel() copies text when it doesn't outlive the tree", "[parse]") {
+   be::S text = make_test_board(large_board_items, 5);
+   be::util::StringInterner serial_si;
+   be::util::StringInterner parallel_si;
+
+   NodeTree serial = parse(text, serial_si, false, classify_node);
+   NodeTree parallel = parse_parallel(text, parallel_si, false, classify_node);
+   text.assign(text.size(), ' ');
+   REQUIRE(equivalent(serial.root(), parallel.root()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_parallel() with deferred subtrees builds the same tree as parse()", "[parse]") {
+   for (be::U32 seed : { 6, 7 }) {
+      be::S text = make_test_board(large_board_items, seed);
+      be::util::StringInterner si;
+
+      NodeTree serial = parse(text, si, true, classify_node);
+      NodeTree lazy = parse_parallel(text, si, true, classify_node, defer_node);
+      REQUIRE(equivalent(serial.root(), lazy.root()));
+   }
+}
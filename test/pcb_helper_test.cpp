@@ -0,0 +1,29 @@
+#include "pcb_helper.hpp"
+#include <catch/catch.hpp>
+
+using namespace std::string_view_literals;
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("parse_layer_mask() expands copper wildcards to every copper layer", "[layers]") {
+   layer_mask inner = copper_layers & ~(layer_bit(layer_id::f_cu) | layer_bit(layer_id::b_cu));
+   REQUIRE(parse_layer_mask("*.Cu"sv) == copper_layers);
+   REQUIRE(parse_layer_mask("F&B.Cu"sv) == copper_layers);
+   REQUIRE((parse_layer_mask("*.Cu"sv) & layer_bit(layer_id::in1_cu)) != 0);
+   REQUIRE((parse_layer_mask("*.Cu"sv) & layer_bit(layer_id::in30_cu)) != 0);
+   REQUIRE(parse_layer_mask("In7.Cu"sv) == layer_bit(layer_id::in7_cu));
+   REQUIRE(parse_layer_mask("*.Mask"sv) == (layer_bit(layer_id::f_mask) | layer_bit(layer_id::b_mask)));
+
+   // drawing still only takes the outer layers
+   REQUIRE((layer_query_mask(face_type::f_front, layer_type::l_copper) & inner) == 0);
+   REQUIRE(check_layer(parse_layer_mask("*.Cu"sv), face_type::f_back, layer_type::l_copper));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("copper_span() fills in the copper layers a via goes through", "[layers]") {
+   REQUIRE(copper_span(layer_bit(layer_id::f_cu) | layer_bit(layer_id::b_cu)) == copper_layers);
+
+   layer_mask blind = copper_span(layer_bit(layer_id::f_cu) | layer_bit(layer_id::in2_cu));
+   REQUIRE(blind == (layer_bit(layer_id::f_cu) | layer_bit(layer_id::in1_cu) | layer_bit(layer_id::in2_cu)));
+
+   REQUIRE(copper_span(layer_bit(layer_id::f_silks)) == layer_bit(layer_id::f_silks));
+}
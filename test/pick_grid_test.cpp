@@ -0,0 +1,63 @@
+#include "test_board.hpp"
+#include "pick_grid.hpp"
+#include "parse_parallel.hpp"
+#include "pcb_helper.hpp"
+#include <be/util/string_interner.hpp>
+#include <catch/catch.hpp>
+#include <random>
+
+using namespace std::string_view_literals;
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("PickGrid finds the same items as checking every item", "[pick]") {
+   be::S text = make_test_board(3000, 10);
+   be::util::StringInterner si;
+   NodeTree tree = parse(text, si, true, classify_node);
+   Node::const_iterator pcb = find(tree.root(), "kicad_pcb"sv);
+   REQUIRE(pcb != tree.root().end());
+   BoardModel model = build_board_model(*pcb);
+   PickGrid grid(model);
+   REQUIRE(grid.size() > 0);
+
+   BoardModel::Bounds bounds;
+   for (const BoardModel::Bounds& item : model.item_bounds) {
+      if (item.lo.x <= item.hi.x) {
+         bounds.add(item.lo);
+         bounds.add(item.hi);
+      }
+   }
+
+   // some points beyond the board, where the grid's border cells are used
+   glm::vec2 margin = (bounds.hi - bounds.lo) * 0.1f;
+   std::mt19937 rng(10);
+   std::uniform_real_distribution<be::F32> x(bounds.lo.x - margin.x, bounds.hi.x + margin.x);
+   std::uniform_real_distribution<be::F32> y(bounds.lo.y - margin.y, bounds.hi.y + margin.y);
+
+   std::set<be::U32> no_nets;
+   std::set<be::U32> skip_nets { 1, 2, 3 };
+
+   for (int i = 0; i < 2000; ++i) {
+      glm::vec2 target(x(rng), y(rng));
+      be::F32 radius = i % 3 == 0 ? 0.5f : i % 3 == 1 ? 3.f : 20.f;
+
+      for (face_type face : { face_type::f_front, face_type::f_back }) {
+         be::F32 grid_distance = radius;
+         be::F32 linear_distance = radius;
+         const Node* grid_module = find_closest_module(model, &grid, target, grid_distance, face);
+         const Node* linear_module = find_closest_module(model, nullptr, target, linear_distance, face);
+         REQUIRE(grid_module == linear_module);
+         REQUIRE(grid_distance == linear_distance);
+
+         for (bool include_pads : { false, true }) {
+            for (const std::set<be::U32>* skip : { &no_nets, &skip_nets }) {
+               grid_distance = radius;
+               linear_distance = radius;
+               be::U32 grid_net = find_closest_copper(model, &grid, target, grid_distance, face, *skip, include_pads);
+               be::U32 linear_net = find_closest_copper(model, nullptr, target, linear_distance, face, *skip, include_pads);
+               REQUIRE(grid_net == linear_net);
+               REQUIRE(grid_distance == linear_distance);
+            }
+         }
+      }
+   }
+}
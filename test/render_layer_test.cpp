@@ -0,0 +1,142 @@
+#include "test_board.hpp"
+#include "render_layer.hpp"
+#include "layer_config.hpp"
+#include "parse_parallel.hpp"
+#include "pcb_helper.hpp"
+#include <be/util/string_interner.hpp>
+#include <catch/catch.hpp>
+#include <cstring>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+struct TestMesh {
+   IndexedMesh mesh;
+   InstancedShapes shapes;
+   std::vector<be::U32> item_ends;
+   std::vector<be::U32> instance_ends;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Renders the layers kiview draws for both faces in a single pass.
+std::vector<TestMesh> render_test_layers(const BoardModel& model, bool parallel, const SegmentDensities& densities,
+                                         const BoardModel::Bounds& region = BoardModel::Bounds::everything()) {
+   std::vector<RenderItemPredicate> preds;
+   for (face_type face : { face_type::f_front, face_type::f_back }) {
+      preds.push_back(CopperConfig { face, false, true });
+      preds.push_back(ModuleConfig { face, false, nullptr });
+      preds.push_back(StandardConfig { face, layer_type::l_silk });
+   }
+   preds.push_back(HoleConfig());
+   preds.push_back(StandardConfig { face_type::any, layer_type::l_cuts });
+
+   std::vector<TestMesh> meshes(preds.size());
+   LayerBuckets buckets(densities, region);
+   for (std::size_t m = 0; m < meshes.size(); ++m) {
+      TestMesh& mesh = meshes[m];
+      buckets.add(std::move(preds[m]), mesh.mesh, &mesh.shapes, &mesh.item_ends, &mesh.instance_ends);
+   }
+   render_layers(model, buckets, parallel);
+   return meshes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+bool same(const std::vector<T>& a, const std::vector<T>& b) {
+   return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void require_same(const std::vector<TestMesh>& serial, const std::vector<TestMesh>& parallel) {
+   REQUIRE(serial.size() == parallel.size());
+   for (std::size_t m = 0; m < serial.size(); ++m) {
+      const TestMesh& a = serial[m];
+      const TestMesh& b = parallel[m];
+      REQUIRE(same(a.mesh.vertices, b.mesh.vertices));
+      REQUIRE(same(a.mesh.indices, b.mesh.indices));
+      REQUIRE(same(a.item_ends, b.item_ends));
+      REQUIRE(same(a.instance_ends, b.instance_ends));
+      REQUIRE(same(a.shapes.mesh().vertices, b.shapes.mesh().vertices));
+      REQUIRE(same(a.shapes.mesh().indices, b.shapes.mesh().indices));
+      REQUIRE(same(a.shapes.shape_starts(), b.shapes.shape_starts()));
+      REQUIRE(same(a.shapes.vertex_starts(), b.shapes.vertex_starts()));
+      REQUIRE(same(a.shapes.instances(), b.shapes.instances()));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct TestModel {
+   be::S text;
+   be::util::StringInterner si;
+   NodeTree tree;
+   BoardModel model;
+
+   explicit TestModel(be::S board_text)
+      : text(std::move(board_text)),
+        tree(parse_parallel(text, si, true, classify_node)) {
+      Node::const_iterator it = find(tree.root(), "kicad_pcb"sv);
+      REQUIRE(it != tree.root().end());
+      model = build_board_model(*it);
+   }
+
+   explicit TestModel(std::size_t n_items, be::U32 seed = 1)
+      : TestModel(make_test_board(n_items, seed)) { }
+};
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("render_layers() in parallel matches rendering in order", "[render]") {
+   TestModel board(6000);
+   SegmentDensities densities = segment_densities();
+
+   std::vector<TestMesh> serial = render_test_layers(board.model, false, densities);
+   std::vector<TestMesh> parallel = render_test_layers(board.model, true, densities);
+   REQUIRE(serial.front().item_ends.size() == board.model.size());
+   require_same(serial, parallel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("render_layers() in parallel matches rendering in order with a level of detail and region", "[render]") {
+   TestModel board(6000, 2);
+   SegmentDensities densities = segment_densities();
+   densities.max_error = 0.05f;
+   BoardModel::Bounds region;
+   region.add(glm::vec2(-40.f, -20.f));
+   region.add(glm::vec2(30.f, 50.f));
+
+   std::vector<TestMesh> serial = render_test_layers(board.model, false, densities, region);
+   std::vector<TestMesh> parallel = render_test_layers(board.model, true, densities, region);
+   require_same(serial, parallel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("render_layer() adds each vertex of a fan or strip once", "[render]") {
+   TestModel board("(kicad_pcb\n"
+                   "  (via (at 1 2) (size 0.8) (drill 0.4) (layers F.Cu B.Cu) (net 0))\n"
+                   "  (gr_circle (center 0 0) (end 2 0) (layer Edge.Cuts) (width 0.1)))\n");
+   REQUIRE(board.model.vias.at.size() == 1);
+   REQUIRE(board.model.graphics.shape.size() == 1);
+
+   be::U32 pads = pad_segment_density();
+   be::U32 arcs = arc_segment_density();
+   auto only = [](model_item only_type) {
+      return [=](const BoardModel&, model_item type, std::size_t) { return type == only_type; };
+   };
+
+   IndexedMesh via = render_layer(board.model, only(model_item::via));
+   REQUIRE(via.vertices.size() == pads);
+   REQUIRE(via.triangles() == pads - 2);
+
+   IndexedMesh circle = render_layer(board.model, only(model_item::graphic));
+   REQUIRE(circle.vertices.size() == 2 * arcs);
+   REQUIRE(circle.triangles() == 2 * arcs);
+
+   for (const IndexedMesh* mesh : { &via, &circle }) {
+      for (be::U32 i : mesh->indices) {
+         REQUIRE(i < mesh->vertices.size());
+      }
+   }
+}
@@ -0,0 +1,77 @@
+#include "sexpr_index.hpp"
+#include <catch/catch.hpp>
+#include <random>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+struct Index {
+   std::vector<be::U32> positions;
+   bool irregular;
+
+   bool operator==(const Index& other) const {
+      return positions == other.positions && irregular == other.irregular;
+   }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+Index index_text(be::SV text, bool force_scalar) {
+   SexprIndexer indexer(text, force_scalar);
+   Index index;
+   while (indexer.next(index.positions)) { }
+   index.irregular = indexer.irregular();
+   return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool same_as_scalar(be::SV text) {
+   return index_text(text, false) == index_text(text, true);
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE("SexprIndexer finds the same positions with SIMD and scalar classifiers", "[parse]") {
+   if (!SexprIndexer::simd()) {
+      return; // nothing to compare
+   }
+
+   // quoted strings, escaped quotes and parens placed across the 16 and 32
+   // byte lanes the SIMD classifiers load, and the 64 byte blocks
+   const char* const tokens[] = { "(", ")", ")(", "\"", "\"a b\"", "\"\"", "\"x\"\"y\"", "\"(\"", "a\"b", "\t\r\n", "12.5" };
+   for (std::size_t boundary : { 16, 32, 48, 64, 80, 96, 128, 192 }) {
+      for (std::size_t shift = 0; shift < 8; ++shift) {
+         for (const char* token : tokens) {
+            be::S text(boundary + shift - 4, 'x');
+            for (std::size_t i = 5; i < text.size(); i += 6) {
+               text[i] = ' ';
+            }
+            text.append(token);
+            text.append(" (at 1 2) \"tail\" end)");
+            INFO(text);
+            REQUIRE(same_as_scalar(text));
+         }
+      }
+   }
+
+   std::mt19937 rng(3);
+   const char alphabet[] = "()\"\" \t\r\nab01.-\\";
+   std::uniform_int_distribution<std::size_t> pick(0, sizeof(alphabet) - 2);
+   std::uniform_int_distribution<std::size_t> length(1, 300);
+   for (int i = 0; i < 5000; ++i) {
+      be::S text(length(rng), ' ');
+      for (char& c : text) {
+         c = alphabet[pick(rng)];
+      }
+      INFO(text);
+      REQUIRE(same_as_scalar(text));
+   }
+
+   // across chunks, with a quoted string left open at the end of the first
+   be::S text(SexprIndexer::chunk_size - 3, ' ');
+   for (std::size_t i = 0; i + 8 < text.size(); i += 8) {
+      text.replace(i, 8, i % 24 == 0 ? "(a \"b\") " : "\"q \"\" ) ");
+   }
+   text.append("\"x)\" (y))");
+   REQUIRE(same_as_scalar(text));
+}
@@ -0,0 +1,158 @@
+#include "test_board.hpp"
+#include <random>
+#include <sstream>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+class BoardWriter final {
+public:
+   explicit BoardWriter(be::U32 seed)
+      : rng_(seed) { }
+
+   // a number in [-range, range], usually written the way pcbnew would
+   be::S num(be::F64 range = 100) {
+      std::ostringstream oss;
+      be::F64 value = (chance() * 2 - 1) * range;
+      be::F64 r = chance();
+      if (r < 0.1) {
+         oss << (int)value;
+      } else if (r < 0.12) {
+         oss << "-0";
+      } else if (r < 0.14) {
+         oss << "+" << (int)std::abs(value) << ".25";
+      } else if (r < 0.16) {
+         oss << ".5";
+      } else {
+         oss.precision(6);
+         oss << std::fixed << value;
+      }
+      return oss.str();
+   }
+
+   be::F64 chance() {
+      return std::uniform_real_distribution<be::F64>()(rng_);
+   }
+
+   std::size_t pick(std::size_t n) {
+      return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+   }
+
+   template <std::size_t N>
+   const char* pick(const char* const (&options)[N]) {
+      return options[pick(N)];
+   }
+
+private:
+   std::mt19937 rng_;
+};
+
+constexpr std::size_t n_nets = 32;
+
+///////////////////////////////////////////////////////////////////////////////
+void write_module(BoardWriter& w, std::ostream& os, std::size_t index) {
+   static const char* const pad_shapes[] = { "rect", "circle", "oval", "trapezoid", "roundrect" };
+   static const char* const rotations[] = { "", " 90", " 180", " 270", " 45" };
+   const char* side = w.chance() < 0.7 ? "F" : "B";
+
+   os << "  (module Resistor_SMD:R_0603_1608Metric (layer " << side << ".Cu) (tedit 5B301BBD) (tstamp 5C8B2A1F)\n"
+      << "    (at " << w.num() << ' ' << w.num() << w.pick(rotations) << ")\n"
+      << "    (descr \"Resistor SMD 0603, \"\"reflow\"\" (IPC-7351)\")\n"
+      << "    (fp_text reference R" << index << " (at 0 -1.43) (layer " << side << ".SilkS)\n"
+      << "      (effects (font (size 1 1) (thickness 0.15))))\n"
+      << "    (fp_text value " << (index % 2 ? "10k" : "100") << " (at 0 1.43) (layer " << side << ".Fab)\n"
+      << "      (effects (font (size 1 1) (thickness 0.15))))\n"
+      << "    (fp_line (start " << w.num(2) << ' ' << w.num(2) << ") (end " << w.num(2) << ' ' << w.num(2) << ") (layer " << side << ".SilkS) (width 0.12))\n"
+      << "    (fp_arc (start 0 0) (end " << w.num(2) << " 0) (angle " << w.num(360) << ") (layer " << side << ".SilkS) (width 0.12))\n"
+      << "    (fp_circle (center 0 0) (end 1 0) (layer " << side << ".CrtYd) (width 0.05))\n";
+
+   for (std::size_t p = 0, n = 1 + w.pick(6); p < n; ++p) {
+      bool thru = w.chance() < 0.3;
+      os << "    (pad " << p + 1 << (thru ? " thru_hole " : " smd ") << w.pick(pad_shapes)
+         << " (at " << w.num(3) << ' ' << w.num(3) << w.pick(rotations) << ") (size 1.2 0.9)";
+      if (w.chance() < 0.2) {
+         os << " (rect_delta 0 0.3)";
+      }
+      if (thru) {
+         os << (w.chance() < 0.5 ? " (drill 0.6)" : " (drill oval 0.6 0.4)") << " (layers *.Cu *.Mask)";
+      } else {
+         os << " (layers " << side << ".Cu " << side << ".Paste " << side << ".Mask)";
+      }
+      std::size_t net = w.pick(n_nets);
+      os << " (net " << net << " \"Net-(R" << net << "-Pad1)\"))\n";
+   }
+
+   os << "    (model ${KISYS3DMOD}/Resistor_SMD.3dshapes/R_0603_1608Metric.wrl\n"
+      << "      (at (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0))))\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void write_zone(BoardWriter& w, std::ostream& os) {
+   std::ostringstream pts;
+   for (std::size_t i = 0, n = 3 + w.pick(6); i < n; ++i) {
+      pts << " (xy " << w.num() << ' ' << w.num() << ')';
+   }
+
+   os << "  (zone (net 1) (net_name GND) (layer " << (w.chance() < 0.5 ? "F.Cu" : "B.Cu") << ") (tstamp 0) (hatch edge 0.508)\n"
+      << "    (connect_pads (clearance 0.508))\n"
+      << "    (min_thickness 0.254)\n"
+      << "    (fill yes (arc_segments 16) (thermal_gap 0.508) (thermal_bridge_width 0.508))\n"
+      << "    (polygon (pts" << pts.str() << "))\n"
+      << "    (filled_polygon (pts" << pts.str() << ")))\n";
+}
+
+} // ::()
+
+///////////////////////////////////////////////////////////////////////////////
+be::S make_test_board(std::size_t n_items, be::U32 seed) {
+   static const char* const copper[] = { "F.Cu", "B.Cu", "In1.Cu" };
+   BoardWriter w(seed);
+   std::ostringstream os;
+
+   os << "(kicad_pcb (version 20171130) (host pcbnew \"5.1.5-52549c5~84~ubuntu18.04.1\")\n"
+      << "  (general (thickness 1.6) (drawings 4) (area -100 -100 100 100))\n"
+      << "  (page A4)\n"
+      << "  (title_block (title \"Test \"\"quoted\"\" board\") (rev 1))\n"
+      << "  (layers (0 F.Cu signal) (31 B.Cu signal) (44 Edge.Cuts user))\n";
+
+   os << "  (net 0 \"\")\n  (net 1 GND)\n";
+   for (std::size_t i = 2; i < n_nets; ++i) {
+      os << "  (net " << i << " \"Net-(R" << i << "-Pad1)\")\n";
+   }
+
+   for (std::size_t i = 0; i < n_items; ++i) {
+      be::F64 r = w.chance();
+      if (r < 0.4) {
+         os << "  (segment (start " << w.num() << ' ' << w.num() << ") (end " << w.num() << ' ' << w.num()
+            << ") (width 0.25) (layer " << w.pick(copper) << ") (net " << w.pick(n_nets) << ") (tstamp 5C8B2A1F))\n";
+      } else if (r < 0.5) {
+         os << "  (via (at " << w.num() << ' ' << w.num() << ") (size 0.8) (drill 0.4) (layers F.Cu B.Cu) (net " << w.pick(n_nets) << "))\n";
+      } else if (r < 0.8) {
+         write_module(w, os, i);
+      } else if (r < 0.87) {
+         os << "  (gr_line (start " << w.num() << ' ' << w.num() << ") (end " << w.num() << ' ' << w.num() << ") (layer Edge.Cuts) (width 0.05))\n";
+      } else if (r < 0.9) {
+         os << "  (gr_arc (start " << w.num() << ' ' << w.num() << ") (end " << w.num() << ' ' << w.num() << ") (angle " << w.num(360)
+            << ") (layer " << (w.chance() < 0.5 ? "Edge.Cuts" : "F.SilkS") << ") (width 0.15))\n";
+      } else if (r < 0.92) {
+         os << "  (gr_circle (center " << w.num() << ' ' << w.num() << ") (end " << w.num() << ' ' << w.num() << ") (layer B.SilkS) (width 0.15))\n";
+      } else {
+         write_zone(w, os);
+      }
+   }
+   os << ")\n";
+
+   be::S text = os.str();
+   if (seed % 2 == 0) {
+      be::S crlf;
+      crlf.reserve(text.size() + text.size() / 32);
+      for (char c : text) {
+         if (c == '\n') {
+            crlf.push_back('\r');
+         }
+         crlf.push_back(c);
+      }
+      text = std::move(crlf);
+   }
+   return text;
+}
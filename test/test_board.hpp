@@ -0,0 +1,15 @@
+#pragma once
+#ifndef KIVIEW_TEST_BOARD_HPP_
+#define KIVIEW_TEST_BOARD_HPP_
+
+#include <be/core/be.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+// Generates the text of a board file with roughly n_items top-level items:
+// nets, tracks, vias, zones, board outline graphics and modules holding pads
+// of every shape.  The same seed always produces the same text.  Odd
+// numbers, quoted strings with escapes and CRLF line endings are mixed in
+// so that parsers see more than the happy path.
+be::S make_test_board(std::size_t n_items, be::U32 seed = 1);
+
+#endif